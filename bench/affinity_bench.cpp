@@ -0,0 +1,262 @@
+// 线程绑定基准
+// 模拟网关的反应器→工作线程交接：反应器写入一条请求（并触碰自己的连接状态工作集），经 eventfd 唤醒工作线程，
+// 工作线程读请求、触碰自己的工作集后经 eventfd 回报，反应器测一次往返。另起若干噪声线程持续占用 CPU 并刷缓存，
+// 模拟日志、管理端点与系统上其他进程的干扰。
+// 对比两种放置：
+//  - unpinned：全部线程由调度器自由迁移
+//  - pinned：经 ThreadTopology 把反应器、工作线程各绑到一个核心（默认取大核），噪声线程绑到其余核心
+//    （核心不足时与工作线程共用），可选实时调度
+// 结果以 JSON 输出：往返延迟百分位，以及反应器线程被迁移的次数（sched_getcpu 变化）。
+//
+// 用法: affinity_bench [--mode pinned|unpinned|both] [--iterations 200000] [--noise 2] [--working-set-kb 256]
+//                      [--reactor-cpus big] [--worker-cpus big] [--policy default|fifo|rr] [--priority 50]
+// 例：affinity_bench --mode both --noise 4 --reactor-cpus 4-7 --worker-cpus 4-7 --policy fifo
+#include "utils/thread_topology.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <sched.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+struct BenchOptions {
+    std::string mode = "both";
+    int iterations = 200000;
+    int noise = 2;
+    int working_set_kb = 256;
+    std::string reactor_cpus = "big";
+    std::string worker_cpus = "big";
+    std::string policy = "default";
+    int priority = 50;
+};
+
+struct ModeResult {
+    std::vector<uint32_t> rtt_ns;
+    uint64_t migrations;
+    int reactor_cpu;   // 最后一次观察到的核心
+    int worker_cpu;
+};
+
+static long long now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 按 64 字节步长读改写工作集的一段，模拟处理一个请求时触碰的连接状态
+static uint64_t touch(std::vector<uint8_t>& ws, size_t& cursor, size_t bytes) {
+    uint64_t sum = 0;
+    for (size_t n = 0; n < bytes; n += 64) {
+        uint8_t& b = ws[cursor];
+        sum += b;
+        b = (uint8_t)(b + 1);
+        cursor += 64;
+        if (cursor >= ws.size()) cursor = 0;
+    }
+    return sum;
+}
+
+static void signal_fd(int fd) {
+    uint64_t one = 1;
+    while (write(fd, &one, sizeof(one)) < 0) {
+    }
+}
+
+static void wait_fd(int fd) {
+    uint64_t v;
+    while (read(fd, &v, sizeof(v)) < 0) {
+    }
+}
+
+static int nth_cpu(const cpu_set_t& set, int index) {
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if (CPU_ISSET(c, &set) && index-- == 0) return c;
+    }
+    return 0;
+}
+
+// 为 pinned 模式配置反应器、工作线程与噪声线程的放置
+static bool configure_pinned(const BenchOptions& opt) {
+    using namespace ThreadTopology;
+    Placement reactor{}, worker{}, noise{};
+    if (!parseCpus(opt.reactor_cpus.c_str(), reactor) || !parseCpus(opt.worker_cpus.c_str(), worker)) {
+        fprintf(stderr, "invalid cpu list\n");
+        return false;
+    }
+    if (!parsePolicy(opt.policy.c_str(), reactor.policy)) {
+        fprintf(stderr, "invalid policy %s\n", opt.policy.c_str());
+        return false;
+    }
+    worker.policy = reactor.policy;
+    reactor.priority = worker.priority = reactor.policy == Policy::DEFAULT ? 0 : opt.priority;
+    // 反应器用集合中的第 0 个核心，工作线程用第 1 个（集合只有一个核心时与反应器共用）；噪声线程用其余核心
+    Placement r0 = reactor, w1 = worker;
+    CPU_ZERO(&r0.cpus);
+    CPU_ZERO(&w1.cpus);
+    CPU_SET(nth_cpu(reactor.cpus, 0), &r0.cpus);
+    CPU_SET(nth_cpu(worker.cpus, CPU_COUNT(&worker.cpus) > 1 ? 1 : 0), &w1.cpus);
+    parseCpus("all", noise);
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if (CPU_ISSET(c, &r0.cpus) || CPU_ISSET(c, &w1.cpus)) CPU_CLR(c, &noise.cpus);
+    }
+    if (CPU_COUNT(&noise.cpus) == 0) noise.cpus = w1.cpus;  // 核心不足：噪声与工作线程共用，反应器独占
+    configure(Role::REACTOR, r0);
+    configure(Role::TASK_DISPATCH, w1);
+    configure(Role::LOGGER, noise);
+    return true;
+}
+
+static void configure_unpinned() {
+    using namespace ThreadTopology;
+    Placement none{};
+    parseCpus("", none);
+    none.policy = Policy::DEFAULT;
+    none.priority = 0;
+    for (int i = 0; i < NUM_ROLES; ++i) configure(static_cast<Role>(i), none);
+}
+
+static bool run_mode(const std::string& mode, const BenchOptions& opt, ModeResult& out) {
+    using ThreadTopology::Role;
+    if (mode == "pinned") {
+        if (!configure_pinned(opt)) return false;
+    } else {
+        configure_unpinned();
+    }
+    size_t ws_bytes = (size_t)opt.working_set_kb * 1024;
+    int req_fd = eventfd(0, EFD_CLOEXEC);
+    int resp_fd = eventfd(0, EFD_CLOEXEC);
+    if (req_fd < 0 || resp_fd < 0) return false;
+    std::atomic<bool> noise_running(true);
+    std::atomic<int> worker_cpu(-1);
+    std::atomic<bool> rt_failed(false);
+
+    // 噪声线程（以日志线程的角色放置）：持续刷一段大于末级缓存份额的内存
+    std::vector<std::thread> noise;
+    for (int i = 0; i < opt.noise; ++i) {
+        noise.emplace_back([&noise_running]() {
+            ThreadTopology::apply(Role::LOGGER);
+            std::vector<uint8_t> junk(8 << 20, 1);
+            size_t cur = 0;
+            volatile uint64_t sink = 0;
+            while (noise_running.load(std::memory_order_relaxed)) sink += touch(junk, cur, 64 * 1024);
+        });
+    }
+
+    // 工作线程在绑核后再分配工作集，内存按首次触碰落在本地节点
+    std::thread worker([&]() {
+        if (!ThreadTopology::apply(Role::TASK_DISPATCH)) rt_failed = true;
+        std::vector<uint8_t> ws(ws_bytes, 0);
+        size_t cur = 0;
+        volatile uint64_t sink = 0;
+        for (int i = 0; i < opt.iterations; ++i) {
+            wait_fd(req_fd);
+            sink += touch(ws, cur, 4096);
+            signal_fd(resp_fd);
+        }
+        worker_cpu = sched_getcpu();
+    });
+
+    if (!ThreadTopology::apply(Role::REACTOR)) rt_failed = true;
+    std::vector<uint8_t> ws(ws_bytes, 0);
+    size_t cur = 0;
+    volatile uint64_t sink = 0;
+    out.rtt_ns.assign(opt.iterations, 0);
+    out.migrations = 0;
+    int cpu = sched_getcpu();
+    for (int i = 0; i < opt.iterations; ++i) {
+        long long t0 = now_ns();
+        sink += touch(ws, cur, 4096);
+        signal_fd(req_fd);
+        wait_fd(resp_fd);
+        long long dt = now_ns() - t0;
+        out.rtt_ns[i] = dt > 0xffffffffLL ? 0xffffffffu : (uint32_t)dt;
+        int c = sched_getcpu();
+        if (c != cpu) {
+            ++out.migrations;
+            cpu = c;
+        }
+    }
+    worker.join();
+    noise_running = false;
+    for (auto& t : noise) t.join();
+    close(req_fd);
+    close(resp_fd);
+    out.reactor_cpu = cpu;
+    out.worker_cpu = worker_cpu.load();
+    // 主线程恢复为不绑定，下一个模式从同样的起点开始
+    configure_unpinned();
+    ThreadTopology::apply(Role::REACTOR);
+    if (rt_failed && mode == "pinned" && opt.policy != "default") {
+        fprintf(stderr, "%s: real-time scheduling not permitted (needs CAP_SYS_NICE)\n", mode.c_str());
+    }
+    return true;
+}
+
+static double pct_us(const std::vector<uint32_t>& sorted, double p) {
+    size_t idx = (size_t)(p * (sorted.size() - 1));
+    return sorted[idx] / 1000.0;
+}
+
+static void print_result(const std::string& mode, ModeResult& r, bool last) {
+    std::sort(r.rtt_ns.begin(), r.rtt_ns.end());
+    double sum = 0;
+    for (uint32_t v : r.rtt_ns) sum += v;
+    printf("    {\"mode\": \"%s\", \"rtt_us_mean\": %.2f, \"rtt_us_p50\": %.2f, \"rtt_us_p99\": %.2f, "
+           "\"rtt_us_p999\": %.2f, \"rtt_us_max\": %.2f, \"reactor_migrations\": %llu, "
+           "\"reactor_cpu\": %d, \"worker_cpu\": %d}%s\n",
+           mode.c_str(), sum / r.rtt_ns.size() / 1000.0, pct_us(r.rtt_ns, 0.50), pct_us(r.rtt_ns, 0.99),
+           pct_us(r.rtt_ns, 0.999), r.rtt_ns.back() / 1000.0, (unsigned long long)r.migrations, r.reactor_cpu,
+           r.worker_cpu, last ? "" : ",");
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string k = argv[i];
+        const char* v = argv[i + 1];
+        if (k == "--mode") opt.mode = v;
+        else if (k == "--iterations") opt.iterations = atoi(v);
+        else if (k == "--noise") opt.noise = atoi(v);
+        else if (k == "--working-set-kb") opt.working_set_kb = atoi(v);
+        else if (k == "--reactor-cpus") opt.reactor_cpus = v;
+        else if (k == "--worker-cpus") opt.worker_cpus = v;
+        else if (k == "--policy") opt.policy = v;
+        else if (k == "--priority") opt.priority = atoi(v);
+        else {
+            fprintf(stderr, "unknown option %s\n", k.c_str());
+            return 1;
+        }
+    }
+    if (opt.iterations <= 0 || opt.noise < 0 || opt.working_set_kb < 4 || opt.priority < 1 || opt.priority > 99) {
+        fprintf(stderr, "invalid options\n");
+        return 1;
+    }
+    ThreadTopology::init();
+
+    std::vector<std::string> modes;
+    if (opt.mode == "both") modes = {"unpinned", "pinned"};
+    else modes.push_back(opt.mode);
+
+    ThreadTopology::Placement all{};
+    ThreadTopology::parseCpus("all", all);
+    ThreadTopology::Placement big{};
+    big.pinned = true;
+    big.cpus = ThreadTopology::bigCores();
+    printf("{\n  \"iterations\": %d, \"noise_threads\": %d, \"working_set_kb\": %d, \"cpus\": \"%s\", "
+           "\"big_cores\": \"%s\", \"policy\": \"%s\",\n  \"results\": [\n",
+           opt.iterations, opt.noise, opt.working_set_kb, ThreadTopology::formatCpus(all).c_str(),
+           ThreadTopology::formatCpus(big).c_str(), opt.policy.c_str());
+    for (size_t i = 0; i < modes.size(); ++i) {
+        ModeResult r;
+        if (!run_mode(modes[i], opt, r)) return 1;
+        print_result(modes[i], r, i + 1 == modes.size());
+    }
+    printf("  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,364 @@
+// 连接风暴基准
+// 子进程中的多个线程同时向服务端发起 N 个连接，测量服务端把 N 个连接全部接受并完成注册所需的时间。
+// 对比三种接受方式：
+//  - legacy：select 每次唤醒只 accept 一个，随后 getpeername + fcntl（原实现）
+//  - epoll / uring：io_engine 批量接受（accept4 SOCK_NONBLOCK|SOCK_CLOEXEC 直到 EAGAIN / 多发 accept），
+//    连接状态取自预分配槽表
+// 指定 --hold-ms 时，接受完成后保持全部连接（引擎模式），期间每 10ms 向 --stream-pct 比例的连接
+// 轮流发一个 token，模拟大量基本空闲的流式客户端，并统计每连接的用户态内存与内核 TCP 内存。
+// 只覆盖 io_engine 一层：不经过 client_manager（连接槽表、请求映射表、时间轮）与 TaskManager，
+// 因此测得的每连接内存不代表网关整体，网关的连接表大小见 /stats 的 connections.table_bytes。
+// 结果以 JSON 输出，"scope" 字段标明为 io_engine。
+//
+// 用法: connect_bench [--mode legacy|epoll|uring|all] [--conns 512] [--rounds 5] [--threads 8]
+//                     [--hold-ms 0] [--stream-pct 1]
+// 例：connect_bench --mode uring --conns 10000 --rounds 1 --hold-ms 2000
+#include "core/io_engine.h"
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+struct BenchOptions {
+    std::string mode = "all";
+    int conns = 512;
+    int rounds = 5;
+    int threads = 8;
+    int hold_ms = 0;
+    int stream_pct = 1;
+};
+
+struct RoundResult {
+    double accept_ms;   // 第一个 connect 发起到最后一个连接注册完成
+    uint64_t wakeups;   // 服务端事件循环轮数
+    uint64_t syscalls;  // 服务端接受路径上的系统调用数
+    int accepted;
+    long rss_kb;        // 保持阶段结束时相对接受前的常驻内存增量（不含启动时一次性分配的引擎表）
+    long tcp_mem_kb;    // 同期内核 TCP 内存增量（全局统计，含客户端一侧的 socket）
+    uint64_t tokens;    // 保持阶段发出的 token 数
+};
+
+static long long now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static long rss_kb() {
+    long pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(f);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// /proc/net/sockstat 中 "TCP: ... mem N"（页）
+static long tcp_mem_kb() {
+    FILE* f = fopen("/proc/net/sockstat", "r");
+    if (!f) return 0;
+    char line[256];
+    long pages = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "TCP:", 4) != 0) continue;
+        const char* m = strstr(line, " mem ");
+        if (m) pages = atol(m + 5);
+    }
+    fclose(f);
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static bool raise_fd_limit(int want) {
+    rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return false;
+    if (rl.rlim_cur >= (rlim_t)want) return true;
+    if (rl.rlim_max != RLIM_INFINITY && rl.rlim_max < (rlim_t)want) return false;
+    rl.rlim_cur = want;
+    return setrlimit(RLIMIT_NOFILE, &rl) == 0;
+}
+
+static int open_listener(int backlog, int* port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+        close(fd);
+        return -1;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    *port = ntohs(addr.sin_port);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+// 与网关一致的预分配槽表：fd 直接索引，空闲槽用栈管理
+struct SlotTable {
+    std::vector<int> slot_of_fd;
+    std::vector<int> free_slots;
+    std::vector<int> fds;
+
+    explicit SlotTable(int n) : slot_of_fd(io_engine_max_fds(), -1), fds(n, -1) {
+        for (int i = n - 1; i >= 0; --i) free_slots.push_back(i);
+    }
+    bool add(int fd) {
+        if (fd >= (int)slot_of_fd.size() || free_slots.empty()) return false;
+        int slot = free_slots.back();
+        free_slots.pop_back();
+        slot_of_fd[fd] = slot;
+        fds[slot] = fd;
+        return true;
+    }
+};
+
+// 原实现：select 唤醒一次只接受一个连接，再补 getpeername 与 fcntl
+static void serve_legacy(int listen_fd, int target, RoundResult& r, std::vector<int>& accepted) {
+    while ((int)accepted.size() < target) {
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(listen_fd, &rfds);
+        timeval tv = {1, 0};
+        r.wakeups++;
+        r.syscalls++;
+        if (select(listen_fd + 1, &rfds, nullptr, nullptr, &tv) <= 0) continue;
+        sockaddr_in cli_addr{};
+        socklen_t cli_len = sizeof(cli_addr);
+        r.syscalls++;
+        int cfd = accept(listen_fd, (sockaddr*)&cli_addr, &cli_len);
+        if (cfd < 0) continue;
+        r.syscalls += 2;
+        getpeername(cfd, (sockaddr*)&cli_addr, &cli_len);
+        fcntl(cfd, F_SETFL, O_NONBLOCK);
+        accepted.push_back(cfd);
+    }
+}
+
+// 保持阶段：连接基本空闲，每 10ms 向一小部分连接轮流发一个 token
+static void hold_engine(const BenchOptions& opt, RoundResult& r, const std::vector<int>& conns) {
+    static const char token[] = "{\"id\":\"bench\",\"token\":\"xxxxxxxxxxxxxxxx\",\"finished\":false}\n";
+    IoEvent events[IO_ENGINE_MAX_EVENTS];
+    size_t per_tick = conns.size() * opt.stream_pct / 100;
+    size_t next = 0;
+    long long tick = now_ns();
+    long long end = tick + (long long)opt.hold_ms * 1000000;
+    while (now_ns() < end) {
+        io_engine_wait(events, IO_ENGINE_MAX_EVENTS, 10);
+        if (now_ns() < tick) continue;
+        tick += 10000000;
+        for (size_t k = 0; k < per_tick && !conns.empty(); ++k) {
+            if (io_engine_send(conns[next], token, sizeof(token) - 1)) r.tokens++;
+            next = (next + 1) % conns.size();
+        }
+    }
+}
+
+// 新实现：io_engine 批量接受，每个连接占槽并注册到引擎
+static void serve_engine(int listen_fd, int target, RoundResult& r, std::vector<int>& accepted) {
+    IoEngineStats before = io_engine_stats();
+    SlotTable slots(target);
+    IoEvent events[IO_ENGINE_MAX_EVENTS];
+    while ((int)accepted.size() < target) {
+        r.wakeups++;
+        int n = io_engine_wait(events, IO_ENGINE_MAX_EVENTS, 1000);
+        for (int i = 0; i < n; ++i) {
+            if (events[i].type != IoEventType::ACCEPT) continue;
+            int cfd = events[i].fd;
+            if (!slots.add(cfd) || !io_engine_add(cfd, IoOwner::CLIENT)) {
+                close(cfd);
+                continue;
+            }
+            accepted.push_back(cfd);
+        }
+    }
+    // io_engine_add 在 epoll 后端各有一次 epoll_ctl，计入接受路径
+    r.syscalls = io_engine_stats().syscalls - before.syscalls;
+    (void)listen_fd;
+}
+
+static void connect_range(int port, int count, std::vector<int>& out) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    for (int i = 0; i < count; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) break;
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            close(fd);
+            continue;
+        }
+        out.push_back(fd);
+    }
+}
+
+// 客户端进程：多线程并发发起连接，之后保持连接直到父进程关闭控制管道
+// 线程先全部就绪，收到父进程的开始信号后同时发起，计时不含进程与线程的创建
+static void run_connectors(int port, const BenchOptions& opt, int go_fd, int ctl_fd) {
+    std::vector<std::vector<int>> client_fds(opt.threads);
+    std::vector<std::thread> connectors;
+    std::atomic<bool> go(false);
+    for (int t = 0; t < opt.threads; ++t) {
+        int count = opt.conns / opt.threads + (t < opt.conns % opt.threads ? 1 : 0);
+        connectors.emplace_back([&, t, count] {
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            connect_range(port, count, client_fds[t]);
+        });
+    }
+    char c;
+    if (read(go_fd, &c, 1) != 1) _exit(1);
+    go.store(true, std::memory_order_release);
+    for (auto& t : connectors) t.join();
+    while (read(ctl_fd, &c, 1) > 0) {}
+    _exit(0);
+}
+
+static RoundResult run_round(const std::string& mode, const BenchOptions& opt) {
+    RoundResult r = {};
+    int port = 0;
+    int listen_fd = open_listener(opt.conns, &port);
+    if (listen_fd < 0) {
+        perror("listen");
+        return r;
+    }
+    bool legacy = mode == "legacy";
+    if (!legacy) {
+        io_engine_init(mode == "uring" ? IoBackend::URING : IoBackend::EPOLL, opt.conns + 64);
+        io_engine_add(listen_fd, IoOwner::LISTENER);
+    }
+    std::vector<int> accepted;
+    accepted.reserve(opt.conns);
+    long rss_before = rss_kb();
+    long tcp_before = tcp_mem_kb();
+
+    // 客户端放在子进程中，服务端的 fd 数与内存统计只含服务端一侧
+    int go[2], ctl[2];
+    if (pipe(go) != 0 || pipe(ctl) != 0) {
+        perror("pipe");
+        return r;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(go[1]);
+        close(ctl[1]);
+        run_connectors(port, opt, go[0], ctl[0]);
+    }
+    close(go[0]);
+    close(ctl[0]);
+    usleep(20000);  // 等子进程的线程就绪
+    long long start = now_ns();
+    if (write(go[1], "g", 1) != 1) perror("write");
+    close(go[1]);
+    if (legacy) serve_legacy(listen_fd, opt.conns, r, accepted);
+    else serve_engine(listen_fd, opt.conns, r, accepted);
+    r.accept_ms = (now_ns() - start) / 1e6;
+    r.accepted = (int)accepted.size();
+    if (!legacy && opt.hold_ms > 0) {
+        hold_engine(opt, r, accepted);
+        r.rss_kb = rss_kb() - rss_before;
+        r.tcp_mem_kb = tcp_mem_kb() - tcp_before;
+    }
+
+    for (int fd : accepted) {
+        if (!legacy) io_engine_remove(fd);
+        close(fd);
+    }
+    close(ctl[1]);
+    waitpid(pid, nullptr, 0);
+    if (!legacy) {
+        io_engine_remove(listen_fd);
+        io_engine_shutdown();
+    }
+    close(listen_fd);
+    return r;
+}
+
+static void run_mode(const std::string& mode, const BenchOptions& opt, bool last) {
+    std::vector<double> ms;
+    uint64_t wakeups = 0, syscalls = 0, tokens = 0;
+    long rss = 0, tcp = 0;
+    const char* backend = mode.c_str();
+    for (int i = 0; i < opt.rounds; ++i) {
+        RoundResult r = run_round(mode, opt);
+        if (r.accepted != opt.conns) {
+            fprintf(stderr, "%s: accepted %d of %d\n", mode.c_str(), r.accepted, opt.conns);
+        }
+        ms.push_back(r.accept_ms);
+        wakeups += r.wakeups;
+        syscalls += r.syscalls;
+        tokens += r.tokens;
+        if (r.rss_kb > rss) rss = r.rss_kb;
+        if (r.tcp_mem_kb > tcp) tcp = r.tcp_mem_kb;
+    }
+    if (mode != "legacy") {
+        // want=URING 但内核不支持时引擎会退回 epoll，按实际后端输出
+        io_engine_init(mode == "uring" ? IoBackend::URING : IoBackend::EPOLL);
+        backend = io_engine_backend_name();
+        io_engine_shutdown();
+    }
+    std::sort(ms.begin(), ms.end());
+    double rounds = opt.rounds > 0 ? (double)opt.rounds : 1.0;
+    printf("    {\"mode\": \"%s\", \"backend\": \"%s\", \"accept_ms_p50\": %.3f, \"accept_ms_max\": %.3f, "
+           "\"wakeups_per_round\": %.1f, \"syscalls_per_conn\": %.2f",
+           mode.c_str(), backend, ms[ms.size() / 2], ms.back(), wakeups / rounds,
+           syscalls / rounds / opt.conns);
+    if (opt.hold_ms > 0 && mode != "legacy") {
+        // 内核 TCP 内存为全局统计，含客户端一侧的 socket
+        printf(", \"hold_tokens\": %llu, \"engine_rss_bytes_per_conn\": %.0f, \"tcp_mem_bytes_per_conn\": %.0f",
+               (unsigned long long)tokens, rss * 1024.0 / opt.conns, tcp * 1024.0 / opt.conns);
+    }
+    printf("}%s\n", last ? "" : ",");
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string k = argv[i];
+        const char* v = argv[i + 1];
+        if (k == "--mode") opt.mode = v;
+        else if (k == "--conns") opt.conns = atoi(v);
+        else if (k == "--rounds") opt.rounds = atoi(v);
+        else if (k == "--threads") opt.threads = atoi(v);
+        else if (k == "--hold-ms") opt.hold_ms = atoi(v);
+        else if (k == "--stream-pct") opt.stream_pct = atoi(v);
+        else {
+            fprintf(stderr, "unknown option %s\n", k.c_str());
+            return 1;
+        }
+    }
+    if (opt.conns <= 0 || opt.rounds <= 0 || opt.threads <= 0 || opt.stream_pct < 0 || opt.stream_pct > 100) {
+        fprintf(stderr, "invalid options\n");
+        return 1;
+    }
+    // 子进程继承同样的上限
+    if (!raise_fd_limit(opt.conns + 64)) {
+        fprintf(stderr, "RLIMIT_NOFILE too low for %d connections\n", opt.conns);
+        return 1;
+    }
+
+    std::vector<std::string> modes;
+    if (opt.mode == "all") modes = {"legacy", "epoll", "uring"};
+    else modes.push_back(opt.mode);
+
+    printf("{\n  \"scope\": \"io_engine\", \"conns\": %d, \"rounds\": %d, \"threads\": %d,\n  \"results\": [\n",
+           opt.conns, opt.rounds, opt.threads);
+    for (size_t i = 0; i < modes.size(); ++i) run_mode(modes[i], opt, i + 1 == modes.size());
+    printf("  ]\n}\n");
+    return 0;
+}
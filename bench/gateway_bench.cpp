@@ -0,0 +1,450 @@
+// 网关端到端压测工具
+// 启动一组 mock NPU 节点（可配置 token 速率与抖动）和 N 个模拟客户端，
+// 按目标 QPS 开环发送请求，统计吞吐、首 token 延迟（TTFT）、token 间隔（ITL）
+// 以及端到端延迟 p50/p99/p999，结果以 JSON 输出。
+//
+// 用法: gateway_bench [--host 127.0.0.1] [--port 9000] [--clients 64] [--qps 100]
+//                     [--duration 10] [--drain 5] [--max-tokens 32] [--prompt-bytes 64]
+//                     [--npu-nodes 2] [--npu-port 10000] [--token-rate 50] [--ttft-ms 20]
+//                     [--jitter 10] [--poisson] [--mode all|npu|client] [--out file]
+//
+// mode=npu 只运行 mock NPU 节点（供网关通过 npu_add_node 连接），
+// mode=client 只运行客户端压测，mode=all 两者同时运行。
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <memory>
+#include <nlohmann/json.hpp>
+
+typedef std::chrono::steady_clock bench_clock;
+
+static long long now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        bench_clock::now().time_since_epoch()).count();
+}
+
+struct BenchOptions {
+    std::string host = "127.0.0.1";
+    int port = 9000;
+    int clients = 64;
+    double qps = 100;
+    int duration_s = 10;
+    int drain_s = 5;
+    int max_tokens = 32;
+    int prompt_bytes = 64;
+    int npu_nodes = 2;
+    int npu_port = 10000;
+    int token_rate = 50;
+    int ttft_ms = 20;
+    int jitter_pct = 10;
+    bool poisson = false;
+    std::string mode = "all";
+    std::string out;
+};
+
+static std::atomic<bool> g_stop(false);
+
+// 发送完整数据，失败返回 false
+static bool send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 从接收缓冲中取出以 '\n' 结尾的消息
+template<typename Handler>
+static void drain_lines(std::string& pending, Handler on_line) {
+    size_t start = 0, nl;
+    while ((nl = pending.find('\n', start)) != std::string::npos) {
+        if (nl > start) on_line(pending.data() + start, nl - start);
+        start = nl + 1;
+    }
+    pending.erase(0, start);
+}
+
+// ===================== mock NPU 节点 =====================
+
+struct NpuConn {
+    int fd;
+    std::mutex send_mutex;
+    explicit NpuConn(int f) : fd(f) {}
+    ~NpuConn() { close(fd); }
+};
+
+// 按配置速率为一个任务生成 token
+static void npu_generate(std::shared_ptr<NpuConn> conn, std::string id, int client_socket,
+                         int max_tokens, bool stream, const BenchOptions& opt) {
+    thread_local std::mt19937 rng(std::random_device{}());
+    std::uniform_int_distribution<int> jitter(-opt.jitter_pct, opt.jitter_pct);
+    long long interval_us = opt.token_rate > 0 ? 1000000LL / opt.token_rate : 0;
+    auto next = bench_clock::now() + std::chrono::milliseconds(opt.ttft_ms);
+    int tokens = max_tokens > 0 ? max_tokens : 16;
+    std::string result;
+
+    for (int i = 0; i < tokens && !g_stop.load(); ++i) {
+        std::this_thread::sleep_until(next);
+        char token[32];
+        snprintf(token, sizeof(token), "tok%d ", i);
+        result += token;
+        if (stream) {
+            nlohmann::json j;
+            j["type"] = "response";
+            j["id"] = id;
+            j["client_socket"] = client_socket;
+            j["token"] = token;
+            j["finished"] = false;
+            std::string frame = j.dump() + "\n";
+            std::lock_guard<std::mutex> lock(conn->send_mutex);
+            if (!send_all(conn->fd, frame.data(), frame.size())) return;
+        }
+        long long step = interval_us + interval_us * jitter(rng) / 100;
+        next += std::chrono::microseconds(step > 0 ? step : 0);
+    }
+
+    nlohmann::json j;
+    j["type"] = "response";
+    j["id"] = id;
+    j["client_socket"] = client_socket;
+    j["result"] = result;
+    j["finished"] = true;
+    std::string frame = j.dump() + "\n";
+    std::lock_guard<std::mutex> lock(conn->send_mutex);
+    send_all(conn->fd, frame.data(), frame.size());
+}
+
+// 处理网关到 mock NPU 的连接：每个任务单独线程生成
+static void npu_serve_conn(int fd, const BenchOptions& opt) {
+    auto conn = std::make_shared<NpuConn>(fd);
+    std::string pending;
+    char buf[4096];
+    while (!g_stop.load()) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        pending.append(buf, n);
+        auto on_task = [&](const char* data, size_t len) {
+            auto j = nlohmann::json::parse(data, data + len, nullptr, false);
+            if (j.is_discarded() || !j.is_object()) return;
+            std::string type = j.value("type", "");
+            if (type != "task" && type != "request") return;
+            std::thread(npu_generate, conn, j.value("id", ""), j.value("client_socket", -1),
+                        j.value("max_tokens", opt.max_tokens), j.value("stream", true),
+                        std::cref(opt)).detach();
+        };
+        drain_lines(pending, on_task);
+        // 兼容不分帧的单条任务
+        if (!pending.empty() && nlohmann::json::accept(pending)) {
+            on_task(pending.data(), pending.size());
+            pending.clear();
+        }
+    }
+}
+
+static void npu_listen(int port, const BenchOptions& opt) {
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if (bind(lfd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(lfd, 16) < 0) {
+        perror("npu listen");
+        close(lfd);
+        return;
+    }
+    fprintf(stderr, "[BENCH] mock NPU listening on %d\n", port);
+    while (!g_stop.load()) {
+        int fd = accept(lfd, nullptr, nullptr);
+        if (fd < 0) continue;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        std::thread(npu_serve_conn, fd, std::cref(opt)).detach();
+    }
+    close(lfd);
+}
+
+// ===================== 模拟客户端 =====================
+
+// 单个请求的时间线（纳秒）
+struct RequestRecord {
+    long long intended_ns;  // 开环计划发送时间，用于避免协同遗漏
+    long long first_token_ns;
+    long long last_token_ns;
+    long long done_ns;
+    int tokens;
+    bool error;
+};
+
+struct ClientStats {
+    std::vector<RequestRecord> records;
+    std::vector<long long> itl_ns;
+    std::atomic<long long> sent;
+    std::atomic<long long> send_failed;
+    ClientStats() : sent(0), send_failed(0) {}
+};
+
+static int connect_gateway(const BenchOptions& opt) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+// 请求 id 形如 bench-<seq>
+static long long parse_seq(const std::string& id) {
+    if (id.compare(0, 6, "bench-") != 0) return -1;
+    return atoll(id.c_str() + 6);
+}
+
+// 接收线程：epoll 监听所有客户端连接，记录每个 token 的到达时间
+static void client_receiver(const std::vector<int>& fds, ClientStats& stats, std::atomic<long long>& completed) {
+    int ep = epoll_create1(0);
+    std::vector<std::string> pending(fds.size());
+    for (size_t i = 0; i < fds.size(); ++i) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, fds[i], &ev);
+    }
+    epoll_event events[64];
+    char buf[8192];
+    while (!g_stop.load()) {
+        int n = epoll_wait(ep, events, 64, 100);
+        for (int e = 0; e < n; ++e) {
+            size_t idx = events[e].data.u64;
+            ssize_t r = recv(fds[idx], buf, sizeof(buf), 0);
+            if (r <= 0) {
+                epoll_ctl(ep, EPOLL_CTL_DEL, fds[idx], nullptr);
+                continue;
+            }
+            long long t = now_ns();
+            pending[idx].append(buf, r);
+            drain_lines(pending[idx], [&](const char* data, size_t len) {
+                auto j = nlohmann::json::parse(data, data + len, nullptr, false);
+                if (j.is_discarded() || !j.is_object()) return;
+                long long seq = parse_seq(j.value("id", ""));
+                if (seq < 0 || seq >= (long long)stats.records.size()) return;
+                RequestRecord& rec = stats.records[seq];
+                if (rec.done_ns) return;
+                if (j.value("type", "") == "error") {
+                    rec.error = true;
+                    rec.done_ns = t;
+                    completed++;
+                    return;
+                }
+                if (j.contains("token") && j["token"].is_string() && !j["token"].get<std::string>().empty()) {
+                    if (!rec.first_token_ns) rec.first_token_ns = t;
+                    else stats.itl_ns.push_back(t - rec.last_token_ns);
+                    rec.last_token_ns = t;
+                    rec.tokens++;
+                }
+                if (j.value("finished", false)) {
+                    rec.done_ns = t;
+                    completed++;
+                }
+            });
+        }
+    }
+    close(ep);
+}
+
+// 开环发送：按计划时间发送，不等待前一个请求完成
+static void client_sender(const std::vector<int>& fds, ClientStats& stats, const BenchOptions& opt,
+                          long long start_ns, long long total) {
+    std::mt19937_64 rng(12345);
+    std::exponential_distribution<double> exp_dist(opt.qps);
+    std::string prompt(opt.prompt_bytes, 'x');
+    double t_s = 0;
+    for (long long seq = 0; seq < total && !g_stop.load(); ++seq) {
+        t_s += opt.poisson ? exp_dist(rng) : 1.0 / opt.qps;
+        long long intended = start_ns + (long long)(t_s * 1e9);
+        std::this_thread::sleep_until(bench_clock::time_point(std::chrono::nanoseconds(intended)));
+        stats.records[seq].intended_ns = intended;
+
+        nlohmann::json j;
+        j["type"] = "request";
+        j["id"] = "bench-" + std::to_string(seq);
+        j["model"] = "bench-model";
+        j["prompt"] = prompt;
+        j["max_tokens"] = opt.max_tokens;
+        j["stream"] = true;
+        std::string frame = j.dump() + "\n";
+        int fd = fds[seq % fds.size()];
+        if (send_all(fd, frame.data(), frame.size())) stats.sent++;
+        else stats.send_failed++;
+    }
+}
+
+// 百分位（最近秩法），单位毫秒
+static double percentile_ms(std::vector<long long>& v, double p) {
+    if (v.empty()) return 0;
+    size_t rank = (size_t)(p / 100.0 * v.size());
+    if (rank >= v.size()) rank = v.size() - 1;
+    return v[rank] / 1e6;
+}
+
+static nlohmann::json latency_summary(std::vector<long long>& v) {
+    std::sort(v.begin(), v.end());
+    double sum = 0;
+    for (long long x : v) sum += x;
+    nlohmann::json j;
+    j["count"] = v.size();
+    j["mean_ms"] = v.empty() ? 0.0 : sum / v.size() / 1e6;
+    j["p50_ms"] = percentile_ms(v, 50);
+    j["p99_ms"] = percentile_ms(v, 99);
+    j["p999_ms"] = percentile_ms(v, 99.9);
+    j["max_ms"] = v.empty() ? 0.0 : v.back() / 1e6;
+    return j;
+}
+
+static int run_clients(const BenchOptions& opt) {
+    std::vector<int> fds;
+    for (int i = 0; i < opt.clients; ++i) {
+        int fd = connect_gateway(opt);
+        if (fd < 0) {
+            fprintf(stderr, "[BENCH] failed to connect gateway %s:%d\n", opt.host.c_str(), opt.port);
+            for (int f : fds) close(f);
+            return 1;
+        }
+        fds.push_back(fd);
+    }
+
+    long long total = (long long)(opt.qps * opt.duration_s);
+    ClientStats stats;
+    stats.records.assign(total, RequestRecord{0, 0, 0, 0, 0, false});
+    std::atomic<long long> completed(0);
+
+    std::thread receiver(client_receiver, std::cref(fds), std::ref(stats), std::ref(completed));
+    long long start_ns = now_ns() + 100000000LL;  // 100ms 后开始，留出线程启动时间
+    client_sender(fds, stats, opt, start_ns, total);
+
+    // 等待在途请求完成
+    long long drain_deadline = now_ns() + (long long)opt.drain_s * 1000000000LL;
+    while (completed.load() < stats.sent.load() && now_ns() < drain_deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    long long end_ns = now_ns();
+    g_stop.store(true);
+    receiver.join();
+    for (int f : fds) close(f);
+
+    std::vector<long long> ttft, e2e;
+    long long tokens = 0, ok = 0, errors = 0, last_done = start_ns;
+    for (auto& rec : stats.records) {
+        if (!rec.intended_ns) continue;
+        if (rec.error) { errors++; continue; }
+        if (!rec.done_ns) continue;
+        ok++;
+        tokens += rec.tokens;
+        if (rec.first_token_ns) ttft.push_back(rec.first_token_ns - rec.intended_ns);
+        e2e.push_back(rec.done_ns - rec.intended_ns);
+        if (rec.done_ns > last_done) last_done = rec.done_ns;
+    }
+    double elapsed_s = (std::max(last_done, end_ns) - start_ns) / 1e9;
+    double active_s = (last_done - start_ns) / 1e9;
+    if (active_s <= 0) active_s = elapsed_s;
+
+    nlohmann::json report;
+    report["config"] = {
+        {"clients", opt.clients}, {"target_qps", opt.qps}, {"duration_s", opt.duration_s},
+        {"max_tokens", opt.max_tokens}, {"prompt_bytes", opt.prompt_bytes},
+        {"npu_nodes", opt.mode == "client" ? 0 : opt.npu_nodes}, {"token_rate", opt.token_rate},
+        {"ttft_ms", opt.ttft_ms}, {"jitter_pct", opt.jitter_pct}, {"poisson", opt.poisson}};
+    report["requests"] = {
+        {"scheduled", total}, {"sent", stats.sent.load()}, {"send_failed", stats.send_failed.load()},
+        {"completed", ok}, {"errors", errors}, {"timed_out", stats.sent.load() - ok - errors}};
+    report["throughput"] = {
+        {"requests_per_s", ok / active_s}, {"tokens_per_s", tokens / active_s}};
+    report["ttft"] = latency_summary(ttft);
+    report["itl"] = latency_summary(stats.itl_ns);
+    report["e2e"] = latency_summary(e2e);
+
+    std::string text = report.dump(2);
+    printf("%s\n", text.c_str());
+    if (!opt.out.empty()) {
+        FILE* fp = fopen(opt.out.c_str(), "w");
+        if (fp) {
+            fprintf(fp, "%s\n", text.c_str());
+            fclose(fp);
+        }
+    }
+    return 0;
+}
+
+static bool parse_args(int argc, char* argv[], BenchOptions& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string key = argv[i];
+        if (key == "--poisson") { opt.poisson = true; continue; }
+        if (i + 1 >= argc) return false;
+        const char* val = argv[++i];
+        if (key == "--host") opt.host = val;
+        else if (key == "--port") opt.port = atoi(val);
+        else if (key == "--clients") opt.clients = atoi(val);
+        else if (key == "--qps") opt.qps = atof(val);
+        else if (key == "--duration") opt.duration_s = atoi(val);
+        else if (key == "--drain") opt.drain_s = atoi(val);
+        else if (key == "--max-tokens") opt.max_tokens = atoi(val);
+        else if (key == "--prompt-bytes") opt.prompt_bytes = atoi(val);
+        else if (key == "--npu-nodes") opt.npu_nodes = atoi(val);
+        else if (key == "--npu-port") opt.npu_port = atoi(val);
+        else if (key == "--token-rate") opt.token_rate = atoi(val);
+        else if (key == "--ttft-ms") opt.ttft_ms = atoi(val);
+        else if (key == "--jitter") opt.jitter_pct = atoi(val);
+        else if (key == "--mode") opt.mode = val;
+        else if (key == "--out") opt.out = val;
+        else return false;
+    }
+    return opt.clients > 0 && opt.qps > 0 && opt.duration_s > 0 &&
+           (opt.mode == "all" || opt.mode == "npu" || opt.mode == "client");
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions opt;
+    if (!parse_args(argc, argv, opt)) {
+        printf("Usage: %s [--host ip] [--port n] [--clients n] [--qps n] [--duration s] [--drain s]\n"
+               "          [--max-tokens n] [--prompt-bytes n] [--npu-nodes n] [--npu-port n]\n"
+               "          [--token-rate n] [--ttft-ms n] [--jitter pct] [--poisson]\n"
+               "          [--mode all|npu|client] [--out file]\n", argv[0]);
+        return 1;
+    }
+
+    if (opt.mode != "client") {
+        for (int i = 0; i < opt.npu_nodes; ++i) {
+            std::thread(npu_listen, opt.npu_port + i, std::cref(opt)).detach();
+        }
+    }
+    if (opt.mode == "npu") {
+        while (true) std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    if (opt.mode == "all") {
+        // 等待网关连上 mock NPU 节点
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    return run_clients(opt);
+}
@@ -0,0 +1,208 @@
+// I/O 引擎后端对比基准
+// 服务端线程用 io_engine（epoll 或 io_uring）接受连接，每收到一行请求就逐帧发送 N 个 token，
+// 与网关每个 token 一帧的发送方式一致；客户端线程阻塞收发。
+// 统计 token 吞吐与每 token 系统调用数，结果以 JSON 输出。
+//
+// 用法: io_bench [--backend epoll|uring|both] [--conns 32] [--requests 200]
+//                [--tokens 32] [--token-bytes 48]
+#include "core/io_engine.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+struct BenchOptions {
+    std::string backend = "both";
+    int conns = 32;
+    int requests = 200;
+    int tokens = 32;
+    int token_bytes = 48;
+};
+
+struct BenchResult {
+    const char* backend;
+    double seconds;
+    uint64_t tokens;
+    IoEngineStats stats;
+};
+
+static long long now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int open_listener(int* port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 1024) < 0) {
+        close(fd);
+        return -1;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    *port = ntohs(addr.sin_port);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+// 服务端：事件循环线程，收到请求行后按 token 逐帧回送
+static void run_server(IoBackend backend, int listen_fd, const BenchOptions& opt, const std::string& frame,
+                       std::atomic<bool>& ready, std::atomic<bool>& stop, BenchResult& result) {
+    io_engine_init(backend);
+    result.backend = io_engine_backend_name();
+    io_engine_add(listen_fd, IoOwner::LISTENER);
+    ready = true;
+
+    std::vector<int> owed(IO_ENGINE_MAX_FDS, 0);  // 每个连接尚未发出的 token 数
+    std::vector<int> busy;
+    std::vector<int> conns;
+    IoEvent events[IO_ENGINE_MAX_EVENTS];
+    while (!stop.load(std::memory_order_relaxed)) {
+        int n = io_engine_wait(events, IO_ENGINE_MAX_EVENTS, busy.empty() ? 50 : 1);
+        for (int i = 0; i < n; ++i) {
+            IoEvent& ev = events[i];
+            if (ev.type == IoEventType::ACCEPT) {
+                int one = 1;
+                setsockopt(ev.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                io_engine_add(ev.fd, IoOwner::CLIENT);
+                conns.push_back(ev.fd);
+            } else if (ev.type == IoEventType::DATA) {
+                for (int k = 0; k < ev.len; ++k) {
+                    if (ev.data[k] == '\n') owed[ev.fd] += opt.tokens;
+                }
+                if (owed[ev.fd] > 0) busy.push_back(ev.fd);
+            } else {
+                io_engine_remove(ev.fd);
+                owed[ev.fd] = 0;
+            }
+        }
+        // 每个 token 一次发送调用；窗口满时留待下一轮
+        size_t keep = 0;
+        for (size_t k = 0; k < busy.size(); ++k) {
+            int fd = busy[k];
+            while (owed[fd] > 0 && io_engine_send(fd, frame.data(), frame.size())) owed[fd]--;
+            if (owed[fd] > 0) busy[keep++] = fd;
+        }
+        busy.resize(keep);
+    }
+    result.stats = io_engine_stats();
+    for (int fd : conns) {
+        io_engine_remove(fd);
+        close(fd);
+    }
+    io_engine_remove(listen_fd);
+    io_engine_shutdown();
+}
+
+static void run_client(int port, const BenchOptions& opt, size_t frame_len, std::atomic<uint64_t>& tokens) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    std::vector<char> buf(64 * 1024);
+    size_t expect = frame_len * opt.tokens;
+    for (int r = 0; r < opt.requests; ++r) {
+        if (send(fd, "req\n", 4, MSG_NOSIGNAL) != 4) break;
+        size_t got = 0;
+        while (got < expect) {
+            ssize_t n = recv(fd, buf.data(), buf.size(), 0);
+            if (n <= 0) {
+                close(fd);
+                return;
+            }
+            got += (size_t)n;
+        }
+        tokens.fetch_add(opt.tokens, std::memory_order_relaxed);
+    }
+    close(fd);
+}
+
+static BenchResult run_backend(IoBackend backend, const BenchOptions& opt) {
+    std::string frame = "{\"id\":\"bench\",\"token\":\"";
+    frame.append(opt.token_bytes, 'x');
+    frame += "\"}\n";
+
+    BenchResult result = {};
+    int port = 0;
+    int listen_fd = open_listener(&port);
+    if (listen_fd < 0) {
+        perror("listen");
+        return result;
+    }
+    std::atomic<bool> ready(false), stop(false);
+    std::thread server(run_server, backend, listen_fd, std::cref(opt), std::cref(frame),
+                       std::ref(ready), std::ref(stop), std::ref(result));
+    while (!ready) std::this_thread::yield();
+
+    std::atomic<uint64_t> tokens(0);
+    long long start = now_ns();
+    std::vector<std::thread> clients;
+    for (int i = 0; i < opt.conns; ++i) {
+        clients.emplace_back(run_client, port, std::cref(opt), frame.size(), std::ref(tokens));
+    }
+    for (auto& t : clients) t.join();
+    result.seconds = (now_ns() - start) / 1e9;
+    result.tokens = tokens.load();
+    stop = true;
+    server.join();
+    close(listen_fd);
+    return result;
+}
+
+static void print_result(const BenchResult& r, bool last) {
+    double tokens = r.tokens ? (double)r.tokens : 1.0;
+    printf("    {\"backend\": \"%s\", \"tokens\": %llu, \"seconds\": %.3f, \"tokens_per_sec\": %.0f, "
+           "\"syscalls\": %llu, \"syscalls_per_token\": %.3f, \"waits\": %llu, \"sends_deferred\": %llu}%s\n",
+           r.backend, (unsigned long long)r.tokens, r.seconds, r.tokens / (r.seconds > 0 ? r.seconds : 1),
+           (unsigned long long)r.stats.syscalls, r.stats.syscalls / tokens,
+           (unsigned long long)r.stats.waits, (unsigned long long)r.stats.sends_deferred, last ? "" : ",");
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string k = argv[i];
+        const char* v = argv[i + 1];
+        if (k == "--backend") opt.backend = v;
+        else if (k == "--conns") opt.conns = atoi(v);
+        else if (k == "--requests") opt.requests = atoi(v);
+        else if (k == "--tokens") opt.tokens = atoi(v);
+        else if (k == "--token-bytes") opt.token_bytes = atoi(v);
+        else {
+            fprintf(stderr, "unknown option %s\n", k.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    if (opt.backend == "epoll" || opt.backend == "both") results.push_back(run_backend(IoBackend::EPOLL, opt));
+    if (opt.backend == "uring" || opt.backend == "both") results.push_back(run_backend(IoBackend::URING, opt));
+
+    printf("{\n  \"conns\": %d, \"requests\": %d, \"tokens\": %d, \"token_bytes\": %d,\n  \"results\": [\n",
+           opt.conns, opt.requests, opt.tokens, opt.token_bytes);
+    for (size_t i = 0; i < results.size(); ++i) print_result(results[i], i + 1 == results.size());
+    printf("  ]\n}\n");
+    return 0;
+}
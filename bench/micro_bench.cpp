@@ -0,0 +1,293 @@
+// 热点基础组件微基准
+// 覆盖 JSON 解析/序列化、SimpleQueue、TaskQueue、TaskCache、TokenList 与时钟，
+// 结果可保存为基线并与基线比较，性能回退以数字体现。
+//
+// 用法: micro_bench [--filter substr] [--min-ms n] [--json]
+//                   [--save file] [--compare file] [--threshold pct]
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <nlohmann/json.hpp>
+#include "common/data_structures.h"
+#include "core/json_utils.h"
+#include "core/message_handler.h"
+#include "core/task_queue.h"
+#include "core/task_cache.h"
+#include "core/task_manager.h"
+#include "utils/clock.h"
+#include "utils/request_id.h"
+
+// 阻止编译器优化掉被测结果
+template<typename T>
+static inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchResult {
+    std::string name;
+    long long iterations;
+    double ns_per_op;
+};
+
+struct MicroOptions {
+    std::string filter;
+    int min_ms = 200;
+    bool json = false;
+    std::string save;
+    std::string compare;
+    double threshold_pct = 10.0;
+};
+
+static MicroOptions g_opt;
+static std::vector<BenchResult> g_results;
+
+// 自动确定批量大小：批量翻倍直到单批耗时超过 min_ms/5，再重复 5 批取中位数
+template<typename Fn>
+static void run_bench(const char* name, Fn fn) {
+    if (!g_opt.filter.empty() && strstr(name, g_opt.filter.c_str()) == nullptr) return;
+    typedef std::chrono::steady_clock clock;
+    long long batch = 1;
+    double batch_ns = 0;
+    while (true) {
+        auto t0 = clock::now();
+        for (long long i = 0; i < batch; ++i) fn();
+        batch_ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+        if (batch_ns >= g_opt.min_ms * 1e6 / 5 || batch >= (1LL << 30)) break;
+        batch *= 2;
+    }
+    std::vector<double> samples;
+    for (int r = 0; r < 5; ++r) {
+        auto t0 = clock::now();
+        for (long long i = 0; i < batch; ++i) fn();
+        samples.push_back(std::chrono::duration<double, std::nano>(clock::now() - t0).count() / batch);
+    }
+    std::sort(samples.begin(), samples.end());
+    g_results.push_back({name, batch * 5, samples[2]});
+}
+
+static void bench_json() {
+    const std::string request_str = MessageHandler::build_request(
+        "req_1234567890", "llama2-7b", "你好，请介绍一下人工智能，并给出三个应用场景", 1000, true);
+
+    run_bench("json/parse_json_request", [&]() {
+        nlohmann::json j;
+        parse_json(request_str, j);
+        do_not_optimize(j);
+    });
+
+    nlohmann::json parsed;
+    parse_json(request_str, parsed);
+    run_bench("json/message_from_json", [&]() {
+        RequestMessage msg;
+        msg.from_json(parsed);
+        do_not_optimize(msg);
+    });
+
+    run_bench("json/parse_request_message", [&]() {
+        RequestMessage msg;
+        parse_request_message(request_str, msg);
+        do_not_optimize(msg);
+    });
+
+    // 模拟接收路径：旧做法先把缓冲拷成 std::string 再解析，新做法直接在缓冲上解析
+    const char* recv_data = request_str.data();
+    size_t recv_len = request_str.size();
+    run_bench("json/parse_request_copy", [&]() {
+        RequestMessage msg;
+        parse_request_message(std::string(recv_data, recv_len), msg);
+        do_not_optimize(msg);
+    });
+
+    run_bench("json/parse_request_inplace", [&]() {
+        RequestMessage msg;
+        parse_request_message(recv_data, recv_len, msg);
+        do_not_optimize(msg);
+    });
+
+    run_bench("json/build_stream_response", [&]() {
+        std::string s = MessageHandler::build_stream_response("req_1234567890", 42, "人工", false);
+        do_not_optimize(s);
+    });
+}
+
+static void bench_queues() {
+    SimpleQueue<int, 1024> simple;
+    run_bench("queue/simple_queue_push_pop", [&]() {
+        int v = 0;
+        simple.push(1);
+        simple.pop(v);
+        do_not_optimize(v);
+    });
+
+    TaskQueue task_queue;
+    TaskContext tasks[16];
+    run_bench("queue/task_queue_add_next", [&]() {
+        task_queue.addToPendingQueue(&tasks[0]);
+        TaskContext* t = task_queue.getNextPendingTask();
+        do_not_optimize(t);
+    });
+
+    // 从16个任务中间移除一个：removeFromQueue 需要整体搬移
+    run_bench("queue/task_queue_remove_16", [&]() {
+        for (auto& t : tasks) task_queue.addToPendingQueue(&t);
+        task_queue.removeFromPendingQueue(&tasks[8]);
+        while (task_queue.getNextPendingTask()) {}
+    });
+}
+
+static void bench_cache() {
+    TaskCache cache;
+    RequestMessage request;
+    std::vector<std::string> ids;
+    for (int i = 0; i < 1024; ++i) ids.push_back("req-" + std::to_string(i));
+    size_t k = 0;
+    run_bench("cache/task_cache_create_complete", [&]() {
+        const std::string& id = ids[k++ & 1023];
+        TaskContext* t = cache.createTask(id, 1, request);
+        do_not_optimize(t);
+        cache.completeTask(id);
+    });
+
+    for (int i = 0; i < 256; ++i) cache.createTask(ids[i], 1, request);
+    run_bench("cache/task_cache_get_256", [&]() {
+        TaskContext* t = cache.getTask(ids[k++ & 255]);
+        do_not_optimize(t);
+    });
+}
+
+static void bench_tokens() {
+    run_bench("token/token_list_add_iterate_64", [&]() {
+        TokenList list;
+        for (int i = 0; i < 64; ++i) list.addToken("tok ");
+        list.markFinished();
+        const char* t;
+        while ((t = list.getNextToken()) != nullptr) do_not_optimize(t);
+    });
+}
+
+static void bench_clock() {
+    run_bench("clock/system_clock_now", [&]() {
+        auto t = std::chrono::system_clock::now();
+        do_not_optimize(t);
+    });
+    run_bench("clock/clock_gettime_monotonic", [&]() {
+        int64_t t = Clock::monotonicSyscallNs();
+        do_not_optimize(t);
+    });
+    run_bench("clock/fine_now_ns", [&]() {
+        int64_t t = Clock::nowNs();
+        do_not_optimize(t);
+    });
+    run_bench("clock/coarse_ms", [&]() {
+        int64_t t = Clock::coarseMs();
+        do_not_optimize(t);
+    });
+}
+
+static void bench_ids() {
+    run_bench("id/request_id_next", [&]() {
+        uint64_t id = RequestId::next();
+        do_not_optimize(id);
+    });
+    run_bench("id/request_id_format", [&]() {
+        char buf[RequestId::TEXT_SIZE];
+        RequestId::format(RequestId::next(), buf);
+        do_not_optimize(buf);
+    });
+}
+
+static bool parse_args(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string key = argv[i];
+        if (key == "--json") { g_opt.json = true; continue; }
+        if (i + 1 >= argc) return false;
+        const char* val = argv[++i];
+        if (key == "--filter") g_opt.filter = val;
+        else if (key == "--min-ms") g_opt.min_ms = atoi(val);
+        else if (key == "--save") g_opt.save = val;
+        else if (key == "--compare") g_opt.compare = val;
+        else if (key == "--threshold") g_opt.threshold_pct = atof(val);
+        else return false;
+    }
+    return g_opt.min_ms > 0;
+}
+
+static nlohmann::json results_to_json() {
+    nlohmann::json j = nlohmann::json::object();
+    for (auto& r : g_results) {
+        j[r.name] = {{"ns_per_op", r.ns_per_op}, {"iterations", r.iterations}};
+    }
+    return j;
+}
+
+static bool load_json(const std::string& path, nlohmann::json& out) {
+    FILE* fp = fopen(path.c_str(), "r");
+    if (!fp) return false;
+    std::string text;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) text.append(buf, n);
+    fclose(fp);
+    return parse_json(text, out);
+}
+
+int main(int argc, char* argv[]) {
+    if (!parse_args(argc, argv)) {
+        printf("Usage: %s [--filter substr] [--min-ms n] [--json] [--save file] [--compare file] [--threshold pct]\n", argv[0]);
+        return 1;
+    }
+    Clock::init();
+
+    bench_json();
+    bench_queues();
+    bench_cache();
+    bench_tokens();
+    bench_clock();
+    bench_ids();
+
+    nlohmann::json baseline;
+    bool has_baseline = !g_opt.compare.empty() && load_json(g_opt.compare, baseline);
+    if (!g_opt.compare.empty() && !has_baseline) {
+        fprintf(stderr, "[BENCH] cannot read baseline %s\n", g_opt.compare.c_str());
+        return 1;
+    }
+
+    int regressions = 0;
+    if (g_opt.json) {
+        printf("%s\n", results_to_json().dump(2).c_str());
+    } else {
+        printf("%-36s %14s %12s %10s\n", "benchmark", "iterations", "ns/op", "vs base");
+    }
+    for (auto& r : g_results) {
+        double delta = 0;
+        bool compared = has_baseline && baseline.contains(r.name);
+        if (compared) {
+            double base = baseline[r.name].value("ns_per_op", 0.0);
+            if (base > 0) delta = (r.ns_per_op - base) / base * 100.0;
+            if (delta > g_opt.threshold_pct) regressions++;
+        }
+        if (!g_opt.json) {
+            if (compared) printf("%-36s %14lld %12.1f %+9.1f%%\n", r.name.c_str(), r.iterations, r.ns_per_op, delta);
+            else printf("%-36s %14lld %12.1f %10s\n", r.name.c_str(), r.iterations, r.ns_per_op, "-");
+        }
+    }
+
+    if (!g_opt.save.empty()) {
+        FILE* fp = fopen(g_opt.save.c_str(), "w");
+        if (!fp) {
+            fprintf(stderr, "[BENCH] cannot write %s\n", g_opt.save.c_str());
+            return 1;
+        }
+        fprintf(fp, "%s\n", results_to_json().dump(2).c_str());
+        fclose(fp);
+    }
+    if (regressions > 0) {
+        fprintf(stderr, "[BENCH] %d benchmark(s) regressed more than %.1f%%\n", regressions, g_opt.threshold_pct);
+        return 2;
+    }
+    return 0;
+}
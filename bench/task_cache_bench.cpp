@@ -0,0 +1,119 @@
+// TaskCache 锁竞争基准测试
+// 模拟多个客户端 reactor 线程创建/查询任务，多个 NPU 节点线程按 token 查询并完成任务，
+// 对比不同分片数下的吞吐。
+//
+// 用法: task_cache_bench [reactors] [nodes] [tasks_per_reactor] [lookups_per_task] [shards]
+//       不指定 shards 时依次测试 1/4/16/64 个分片
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "core/task_cache.h"
+
+struct BenchConfig {
+    int reactors;
+    int nodes;
+    int tasks_per_reactor;
+    int lookups_per_task;
+};
+
+static double run_once(const BenchConfig& cfg, size_t shards) {
+    // 容量设为在途任务的一小部分，逼近真实的满载情况
+    size_t capacity = (size_t)cfg.reactors * 256;
+    TaskCache cache(capacity, shards);
+    
+    // 预生成 request_id，避免把字符串格式化计入测量
+    std::vector<std::vector<std::string>> ids(cfg.reactors);
+    for (int r = 0; r < cfg.reactors; ++r) {
+        ids[r].reserve(cfg.tasks_per_reactor);
+        for (int i = 0; i < cfg.tasks_per_reactor; ++i) {
+            char buf[64];
+            snprintf(buf, sizeof(buf), "r%d-%d", r, i);
+            ids[r].push_back(buf);
+        }
+    }
+    
+    // 每个 reactor 已发布的任务数
+    std::vector<std::atomic<int>> published(cfg.reactors);
+    for (auto& p : published) p.store(0);
+    std::atomic<bool> go(false);
+    RequestMessage request;
+    
+    std::vector<std::thread> threads;
+    for (int r = 0; r < cfg.reactors; ++r) {
+        threads.emplace_back([&, r]() {
+            while (!go.load(std::memory_order_acquire)) {}
+            for (int i = 0; i < cfg.tasks_per_reactor; ++i) {
+                while (!cache.createTask(ids[r][i], r, request)) {
+                    std::this_thread::yield();  // 缓存满，等待节点线程释放
+                }
+                cache.getTask(ids[r][i]);
+                published[r].store(i + 1, std::memory_order_release);
+            }
+        });
+    }
+    for (int n = 0; n < cfg.nodes; ++n) {
+        threads.emplace_back([&, n]() {
+            while (!go.load(std::memory_order_acquire)) {}
+            std::vector<int> consumed(cfg.reactors, 0);
+            bool done = false;
+            while (!done) {
+                done = true;
+                for (int r = n; r < cfg.reactors; r += cfg.nodes) {
+                    int avail = published[r].load(std::memory_order_acquire);
+                    while (consumed[r] < avail) {
+                        const std::string& id = ids[r][consumed[r]];
+                        cache.updateTaskStatus(id, TaskStatus::PROCESSING);
+                        for (int k = 0; k < cfg.lookups_per_task; ++k) {
+                            cache.getTask(id);  // 每个 token 查一次任务
+                        }
+                        cache.completeTask(id);
+                        consumed[r]++;
+                    }
+                    if (consumed[r] < cfg.tasks_per_reactor) done = false;
+                }
+            }
+        });
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) t.join();
+    auto end = std::chrono::steady_clock::now();
+    
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig cfg;
+    cfg.reactors = argc > 1 ? atoi(argv[1]) : 4;
+    cfg.nodes = argc > 2 ? atoi(argv[2]) : 4;
+    cfg.tasks_per_reactor = argc > 3 ? atoi(argv[3]) : 50000;
+    cfg.lookups_per_task = argc > 4 ? atoi(argv[4]) : 16;
+    if (cfg.reactors <= 0 || cfg.nodes <= 0 || cfg.tasks_per_reactor <= 0 || cfg.lookups_per_task < 0) {
+        printf("Usage: %s [reactors] [nodes] [tasks_per_reactor] [lookups_per_task] [shards]\n", argv[0]);
+        return 1;
+    }
+    
+    std::vector<size_t> shard_list;
+    if (argc > 5) {
+        shard_list.push_back((size_t)atoi(argv[5]));
+    } else {
+        shard_list = {1, 4, 16, 64};
+    }
+    
+    long long ops_per_task = 2 + 1 + cfg.lookups_per_task + 1;  // create+get, update, lookups, complete
+    long long total_ops = ops_per_task * cfg.reactors * cfg.tasks_per_reactor;
+    
+    printf("reactors=%d nodes=%d tasks/reactor=%d lookups/task=%d\n",
+           cfg.reactors, cfg.nodes, cfg.tasks_per_reactor, cfg.lookups_per_task);
+    printf("%-8s %-12s %-14s\n", "shards", "elapsed_s", "ops_per_s");
+    for (size_t shards : shard_list) {
+        double secs = run_once(cfg, shards);
+        printf("%-8zu %-12.3f %-14.0f\n", shards, secs, total_ops / secs);
+    }
+    return 0;
+}
@@ -6,6 +6,8 @@
 #include <unistd.h>
 #include <thread>
 #include <chrono>
+#include <vector>
+#include <sstream>
 #include "../src/core/message_handler.h"
 
 class NPUNodeExample {
@@ -14,11 +16,12 @@ private:
     std::string gateway_ip;
     int gateway_port;
     std::string node_id;
+    std::vector<std::string> models;  // 已加载的模型，在 status 中通告给网关用于路由
     bool running;
     
 public:
-    NPUNodeExample(const std::string& ip, int port, const std::string& id) 
-        : gateway_ip(ip), gateway_port(port), node_id(id), running(false), sock_fd(-1) {}
+    NPUNodeExample(const std::string& ip, int port, const std::string& id, const std::vector<std::string>& loaded = {})
+        : gateway_ip(ip), gateway_port(port), node_id(id), models(loaded), running(false), sock_fd(-1) {}
     
     ~NPUNodeExample() {
         if (sock_fd >= 0) {
@@ -67,7 +70,7 @@ public:
     
 private:
     void send_status() {
-        std::string status_msg = MessageHandler::build_status(node_id, true, 0.5f);
+        std::string status_msg = MessageHandler::build_status(node_id, true, 0.5f, models, 4) + "\n";
         send(sock_fd, status_msg.c_str(), status_msg.length(), 0);
     }
     
@@ -132,7 +135,7 @@ private:
                 std::string token = result.substr(i, 2);
                 std::string response = MessageHandler::build_stream_response(
                     msg.id, msg.client_socket, token, (i + 2 >= result.length())
-                );
+                ) + "\n";
                 
                 send(sock_fd, response.c_str(), response.length(), 0);
                 std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -140,23 +143,31 @@ private:
         } else {
             // 非流式输出
             std::string result = "你好！人工智能是计算机科学的一个分支，它致力于创建能够执行通常需要人类智能的任务的机器。";
-            std::string response = MessageHandler::build_response(msg.id, result, true);
+            std::string response = MessageHandler::build_response(msg.id, result, true) + "\n";
             send(sock_fd, response.c_str(), response.length(), 0);
         }
     }
 };
 
 int main(int argc, char* argv[]) {
-    if (argc != 4) {
-        std::cout << "Usage: " << argv[0] << " <gateway_ip> <gateway_port> <node_id>" << std::endl;
+    if (argc != 4 && argc != 5) {
+        std::cout << "Usage: " << argv[0] << " <gateway_ip> <gateway_port> <node_id> [model1,model2,...]" << std::endl;
         return 1;
     }
     
     std::string gateway_ip = argv[1];
     int gateway_port = std::stoi(argv[2]);
     std::string node_id = argv[3];
+    std::vector<std::string> models;
+    if (argc == 5) {
+        std::stringstream ss(argv[4]);
+        std::string name;
+        while (std::getline(ss, name, ',')) {
+            if (!name.empty()) models.push_back(name);
+        }
+    }
     
-    NPUNodeExample node(gateway_ip, gateway_port, node_id);
+    NPUNodeExample node(gateway_ip, gateway_port, node_id, models);
     
     if (!node.connect()) {
         return 1;
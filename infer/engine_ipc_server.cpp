@@ -1,13 +1,138 @@
 #include "engine_ipc_server.h"
 #include "infer_utils.h"
 #include "infer_engine_api.h"
+#include "infer_shm_ring.h"
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
+#include <sched.h>
 #include <cstdio>
 #include <cstring>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <thread>
 
-void engine_ipc_server_run(const char* sock_path) {
+// 引擎侧长连接：共享内存通道或 socket（'\n' 分帧）
+struct EngineConn {
+    int fd;
+    bool use_shm;
+    ShmChannel ch;
+    std::mutex send_mutex;      // 多个 worker 可能同时向同一连接写响应
+    std::atomic<bool> closed;
+
+    explicit EngineConn(int sock) : fd(sock), use_shm(false), closed(false) {}
+    ~EngineConn() {
+        if (use_shm) shm_channel_close(ch);
+        close(fd);
+    }
+};
+
+// 待执行的推理请求
+struct EngineJob {
+    std::shared_ptr<EngineConn> conn;
+    InferRequest req;
+};
+
+static std::queue<EngineJob> g_jobs;
+static std::mutex g_jobs_mutex;
+static std::condition_variable g_jobs_cv;   // 有新任务
+static std::condition_variable g_space_cv;  // 队列有空位
+
+// 向连接写一条响应，连接已关闭返回 false
+static bool conn_send(EngineConn& conn, const std::string& json) {
+    if (conn.closed.load()) return false;
+    std::lock_guard<std::mutex> lock(conn.send_mutex);
+    if (conn.use_shm) {
+        while (!shm_ring_write(conn.ch.resp, json.c_str(), json.size())) {
+            if (conn.closed.load()) return false;
+            sched_yield(); // 响应环满，等待代理消费
+        }
+        return true;
+    }
+    if (infer_send_frame(conn.fd, json.data(), json.size()) < 0) {
+        conn.closed.store(true);
+        return false;
+    }
+    return true;
+}
+
+// 投递任务，队列满时阻塞读线程形成背压
+static void push_job(EngineJob&& job) {
+    std::unique_lock<std::mutex> lock(g_jobs_mutex);
+    g_space_cv.wait(lock, [] { return g_jobs.size() < ENGINE_MAX_PENDING_JOBS; });
+    g_jobs.push(std::move(job));
+    g_jobs_cv.notify_one();
+}
+
+// 执行推理：stream=true 时逐 token 返回 finished=false，最后返回完整结果 finished=true
+static void run_job(EngineJob& job) {
+    InferResponse resp;
+    resp.id = job.req.id;
+    resp.finished = false;
+    const bool stream = job.req.stream;
+    std::string full = mock_infer_stream(job.req.prompt, job.req.max_tokens, [&](const std::string& token) {
+        if (!stream) return !job.conn->closed.load();
+        resp.token = token;
+        return conn_send(*job.conn, dump_infer_response(resp));
+    });
+    resp.token.clear();
+    resp.result = full;
+    resp.finished = true;
+    conn_send(*job.conn, dump_infer_response(resp));
+}
+
+static void worker_loop() {
+    while (1) {
+        EngineJob job;
+        {
+            std::unique_lock<std::mutex> lock(g_jobs_mutex);
+            g_jobs_cv.wait(lock, [] { return !g_jobs.empty(); });
+            job = std::move(g_jobs.front());
+            g_jobs.pop();
+            g_space_cv.notify_one();
+        }
+        if (!job.conn->closed.load()) run_job(job);
+    }
+}
+
+// 解析一条请求并投递
+static void dispatch_request(const std::shared_ptr<EngineConn>& conn, const char* data, size_t len) {
+    EngineJob job;
+    job.conn = conn;
+    if (parse_infer_request(data, len, job.req)) {
+        push_job(std::move(job));
+    }
+}
+
+// 每个连接一个读线程：负责建立通道、读取请求并投递给 worker
+static void conn_reader(std::shared_ptr<EngineConn> conn) {
+    char buf[INFER_MAX_JSON_SIZE+1];
+    int n = shm_channel_accept(conn->fd, conn->ch, conn->use_shm, buf, INFER_MAX_JSON_SIZE);
+    if (n > 0 && conn->use_shm) {
+        // 共享内存模式：socket 只用于建立通道和检测对端退出
+        printf("[ENGINE] Shared-memory channel established (fd=%d)\n", conn->fd);
+        while (shm_ring_wait(conn->ch.req)) {
+            const char* data;
+            uint32_t len;
+            while (shm_ring_peek(conn->ch.req, data, len)) {
+                dispatch_request(conn, data, len);
+                shm_ring_consume(conn->ch.req);
+            }
+        }
+    } else if (n > 0) {
+        std::string pending(buf, n);
+        std::string req_json;
+        while (infer_recv_frame(conn->fd, pending, req_json) >= 0) {
+            dispatch_request(conn, req_json.data(), req_json.size());
+        }
+    }
+    conn->closed.store(true);
+}
+
+void engine_ipc_server_run(const char* sock_path, int worker_threads) {
     int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
     if (listen_fd < 0) { perror("socket"); return; }
     sockaddr_un addr{};
@@ -15,26 +140,17 @@ void engine_ipc_server_run(const char* sock_path) {
     strncpy(addr.sun_path, sock_path, sizeof(addr.sun_path)-1);
     unlink(sock_path); // 确保不会冲突
     if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0) { perror("bind"); close(listen_fd); return; }
-    if (listen(listen_fd, 1) < 0) { perror("listen"); close(listen_fd); return; }
-    printf("[ENGINE] Listening on %s\n", sock_path);
+    if (listen(listen_fd, ENGINE_LISTEN_BACKLOG) < 0) { perror("listen"); close(listen_fd); return; }
+
+    if (worker_threads <= 0) worker_threads = ENGINE_WORKER_THREADS;
+    for (int i = 0; i < worker_threads; ++i) {
+        std::thread(worker_loop).detach();
+    }
+    printf("[ENGINE] Listening on %s (%d workers)\n", sock_path, worker_threads);
     while (1) {
         int cli_fd = accept(listen_fd, nullptr, nullptr);
         if (cli_fd < 0) continue;
-        char buf[INFER_MAX_JSON_SIZE+1];
-        int n = recv(cli_fd, buf, INFER_MAX_JSON_SIZE, 0);
-        if (n > 0) {
-            buf[n] = 0;
-            InferRequest req;
-            if (parse_infer_request(std::string(buf), req)) {
-                InferResponse resp;
-                resp.id = req.id;
-                resp.result = mock_infer(req.prompt);
-                resp.finished = true;
-                std::string resp_json = dump_infer_response(resp);
-                send(cli_fd, resp_json.c_str(), resp_json.size(), 0);
-            }
-        }
-        close(cli_fd);
+        std::thread(conn_reader, std::make_shared<EngineConn>(cli_fd)).detach();
     }
     close(listen_fd);
-} 
\ No newline at end of file
+}
@@ -2,4 +2,6 @@
 #include <string>
 
 // 启动 UNIX domain socket 服务端，阻塞处理推理请求
-void engine_ipc_server_run(const char* sock_path); 
\ No newline at end of file
+// 连接为长连接，请求分发到 worker 线程池，token 以 finished=false 增量返回
+// worker_threads <= 0 时使用 ENGINE_WORKER_THREADS
+void engine_ipc_server_run(const char* sock_path, int worker_threads = 0);
@@ -1,9 +1,22 @@
 #include "engine_ipc_server.h"
+#include "infer_engine_api.h"
 #include "infer_utils.h"
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
-int main() {
-    printf("[ENGINE] Starting mock inference engine...\n");
-    engine_ipc_server_run(INFER_ENGINE_SOCK_PATH);
+// 用法: infer_engine [tokens_per_sec] [first_token_delay_ms] [jitter_pct] [workers] [fill] [sock_path]
+int main(int argc, char* argv[]) {
+    MockTokenConfig& cfg = mock_token_config();
+    if (argc > 1) cfg.tokens_per_sec = atoi(argv[1]);
+    if (argc > 2) cfg.first_token_delay_ms = atoi(argv[2]);
+    if (argc > 3) cfg.jitter_pct = atoi(argv[3]);
+    int workers = argc > 4 ? atoi(argv[4]) : 0;
+    if (argc > 5) cfg.fill_to_max_tokens = strcmp(argv[5], "fill") == 0;
+    const char* sock_path = argc > 6 ? argv[6] : INFER_ENGINE_SOCK_PATH;
+
+    printf("[ENGINE] Starting mock inference engine (%d tok/s, ttft %d ms, jitter %d%%)...\n",
+           cfg.tokens_per_sec, cfg.first_token_delay_ms, cfg.jitter_pct);
+    engine_ipc_server_run(sock_path, workers);
     return 0;
-} 
\ No newline at end of file
+}
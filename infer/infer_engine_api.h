@@ -1,7 +1,67 @@
 #pragma once
 #include <string>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <cstdio>
 
 // mock 推理 API，输入 prompt，返回 result
 inline std::string mock_infer(const std::string& prompt) {
     return "[MOCK_RESULT] " + prompt;
-} 
\ No newline at end of file
+}
+
+// mock token 生成参数，用于在单机上压测首 token 延迟和流式吞吐
+struct MockTokenConfig {
+    int tokens_per_sec;        // 生成速率，<=0 表示不限速
+    int first_token_delay_ms;  // 首 token 延迟（模拟 prefill）
+    int jitter_pct;            // 每个 token 间隔的随机抖动百分比
+    bool fill_to_max_tokens;   // mock 结果不足 max_tokens 时用填充 token 补齐
+};
+
+inline MockTokenConfig& mock_token_config() {
+    static MockTokenConfig cfg = {20, 50, 0, false};
+    return cfg;
+}
+
+// mock 流式推理 API：按空格切分 mock 结果，按配置速率逐个回调 on_token(const std::string&)
+// 回调返回 false 时提前停止（如连接已断开）。max_tokens <= 0 表示不限制；返回已生成的完整结果
+template<typename TokenCallback>
+inline std::string mock_infer_stream(const std::string& prompt, int max_tokens, TokenCallback on_token) {
+    const MockTokenConfig cfg = mock_token_config();
+    std::string full = mock_infer(prompt);
+    std::string result;
+    thread_local std::mt19937 rng(std::random_device{}());
+    std::uniform_int_distribution<int> jitter(-cfg.jitter_pct, cfg.jitter_pct);
+
+    // 按绝对时间表发放 token，避免 sleep 误差累积
+    auto next = std::chrono::steady_clock::now() + std::chrono::milliseconds(cfg.first_token_delay_ms);
+    long long interval_us = cfg.tokens_per_sec > 0 ? 1000000LL / cfg.tokens_per_sec : 0;
+
+    int count = 0;
+    size_t pos = 0;
+    while (max_tokens <= 0 || count < max_tokens) {
+        std::string token;
+        if (pos < full.size()) {
+            size_t end = full.find(' ', pos);
+            end = (end == std::string::npos) ? full.size() : end + 1;
+            token = full.substr(pos, end - pos);
+            pos = end;
+        } else if (cfg.fill_to_max_tokens && max_tokens > 0) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "tok%d ", count);
+            token = buf;
+        } else {
+            break;
+        }
+
+        std::this_thread::sleep_until(next);
+        if (!on_token(token)) break;
+        result += token;
+        count++;
+
+        long long step = interval_us;
+        if (cfg.jitter_pct > 0) step += interval_us * jitter(rng) / 100;
+        next += std::chrono::microseconds(step > 0 ? step : 0);
+    }
+    return result;
+}
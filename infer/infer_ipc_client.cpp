@@ -1,8 +1,16 @@
 #include "infer_ipc_client.h"
+#include "infer_utils.h"
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include <cstring>
+#include <sched.h>
+#include <map>
+#include <mutex>
+
+// 每个 socket 已收到但未取走的数据（同一 socket 只应有一个读线程）
+static std::map<ipc_socket_t, std::string> g_recv_pending;
+static std::mutex g_recv_mutex;
 
 ipc_socket_t infer_ipc_connect(const char* sock_path) {
     int sock = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -18,20 +26,47 @@ ipc_socket_t infer_ipc_connect(const char* sock_path) {
 }
 
 int infer_ipc_send(ipc_socket_t sock, const std::string& json_str) {
-    return send(sock, json_str.c_str(), json_str.size(), 0);
+    return infer_send_frame(sock, json_str.data(), json_str.size());
 }
 
 int infer_ipc_recv(ipc_socket_t sock, std::string& json_str) {
-    char buf[INFER_MAX_JSON_SIZE+1];
-    int n = recv(sock, buf, INFER_MAX_JSON_SIZE, 0);
-    if (n > 0) {
-        buf[n] = 0;
-        json_str.assign(buf, n);
-        return n;
+    std::string* pending;
+    {
+        std::lock_guard<std::mutex> lock(g_recv_mutex);
+        pending = &g_recv_pending[sock];
     }
-    return -1;
+    return infer_recv_frame(sock, *pending, json_str);
 }
 
 void infer_ipc_close(ipc_socket_t sock) {
-    if (sock >= 0) close(sock);
-} 
\ No newline at end of file
+    if (sock < 0) return;
+    {
+        std::lock_guard<std::mutex> lock(g_recv_mutex);
+        g_recv_pending.erase(sock);
+    }
+    close(sock);
+}
+
+bool infer_ipc_open_shm(ipc_socket_t sock, ShmChannel& ch) {
+    if (!shm_channel_create(ch)) return false;
+    if (!shm_channel_send_setup(sock, ch)) {
+        shm_channel_close(ch);
+        return false;
+    }
+    return true;
+}
+
+bool infer_ipc_shm_send(ShmChannel& ch, const std::string& json_str) {
+    while (!shm_ring_write(ch.req, json_str.c_str(), json_str.size())) {
+        if (json_str.size() > ch.req.capacity / 2) return false;
+        sched_yield(); // 请求环满，等待引擎消费
+    }
+    return true;
+}
+
+bool infer_ipc_shm_recv(ShmChannel& ch, const char*& data, uint32_t& len) {
+    while (!shm_ring_peek(ch.resp, data, len)) {
+        if (!shm_ring_wait(ch.resp)) return false;
+    }
+    return true;
+}
@@ -1,15 +1,25 @@
 #pragma once
 #include <string>
+#include "infer_shm_ring.h"
 
 // 建立 UNIX domain socket 连接，返回 fd，失败返回 -1
 typedef int ipc_socket_t;
 ipc_socket_t infer_ipc_connect(const char* sock_path);
 
-// 发送 JSON 字符串到推理引擎，返回发送字节数
+// 发送 JSON 字符串到推理引擎（以 '\n' 分帧），返回发送字节数
 int infer_ipc_send(ipc_socket_t sock, const std::string& json_str);
 
-// 接收 JSON 字符串，阻塞直到收到，返回实际长度，失败返回-1
+// 接收一条 JSON 消息（一行），阻塞直到收到，返回实际长度，失败返回-1
 int infer_ipc_recv(ipc_socket_t sock, std::string& json_str);
 
 // 关闭 socket
-void infer_ipc_close(ipc_socket_t sock); 
\ No newline at end of file
+void infer_ipc_close(ipc_socket_t sock);
+
+// 在已连接的 socket 上建立共享内存通道，之后请求/响应走共享内存环
+bool infer_ipc_open_shm(ipc_socket_t sock, ShmChannel& ch);
+
+// 通过共享内存通道发送请求，队列满时等待
+bool infer_ipc_shm_send(ShmChannel& ch, const std::string& json_str);
+
+// 等待共享内存通道上的下一条响应，data 直接指向共享内存，用完需 shm_ring_consume(ch.resp)
+bool infer_ipc_shm_recv(ShmChannel& ch, const char*& data, uint32_t& len);
@@ -1,33 +1,67 @@
 #include "infer_net_client.h"
 #include "infer_ipc_client.h"
 #include "infer_utils.h"
+#include <sys/socket.h>
 #include <cstdio>
 #include <cstdlib>
+#include <thread>
 
-int main() {
-    printf("[INFER] Connecting to server %s:%d...\n", SERVER_IP, SERVER_PORT);
-    socket_t server_sock = infer_net_connect(SERVER_IP, SERVER_PORT);
+// 响应方向：引擎产生的每个 token 到达后立即转发给服务端
+static void forward_responses(socket_t server_sock, ipc_socket_t engine_sock, ShmChannel* shm) {
+    while (1) {
+        if (shm) {
+            const char* data;
+            uint32_t len;
+            if (!infer_ipc_shm_recv(*shm, data, len)) break;
+            // 响应直接从共享内存发往服务端，不经过中间拷贝
+            int sent = infer_net_send(server_sock, data, len);
+            shm_ring_consume(shm->resp);
+            if (sent < 0) break;
+        } else {
+            std::string resp_json;
+            if (infer_ipc_recv(engine_sock, resp_json) <= 0) break;
+            if (infer_net_send(server_sock, resp_json) < 0) break;
+        }
+    }
+    printf("[INFER] Response stream closed.\n");
+}
+
+// 用法: infer_agent [server_ip] [server_port] [engine_sock]，缺省时取 infer_utils.h 中的默认值
+int main(int argc, char* argv[]) {
+    const char* server_ip = argc > 1 ? argv[1] : SERVER_IP;
+    int server_port = argc > 2 ? atoi(argv[2]) : SERVER_PORT;
+    const char* engine_path = argc > 3 ? argv[3] : INFER_ENGINE_SOCK_PATH;
+    printf("[INFER] Connecting to server %s:%d...\n", server_ip, server_port);
+    socket_t server_sock = infer_net_connect(server_ip, server_port);
     if (server_sock < 0) { printf("[INFER] Failed to connect server!\n"); return 1; }
 
-    printf("[INFER] Connecting to inference engine at %s...\n", INFER_ENGINE_SOCK_PATH);
-    ipc_socket_t engine_sock = infer_ipc_connect(INFER_ENGINE_SOCK_PATH);
+    printf("[INFER] Connecting to inference engine at %s...\n", engine_path);
+    ipc_socket_t engine_sock = infer_ipc_connect(engine_path);
     if (engine_sock < 0) { printf("[INFER] Failed to connect engine!\n"); infer_net_close(server_sock); return 1; }
 
+    // 优先使用共享内存通道，失败时退回 socket 转发
+    ShmChannel shm;
+    bool use_shm = infer_ipc_open_shm(engine_sock, shm);
+    printf("[INFER] Engine transport: %s\n", use_shm ? "shared memory" : "unix socket");
+
+    // 请求与响应分两个方向并行转发，多个请求可同时在引擎中生成
+    std::thread resp_thread(forward_responses, server_sock, engine_sock, use_shm ? &shm : nullptr);
+
     while (1) {
         std::string req_json;
         int n = infer_net_recv(server_sock, req_json);
         if (n <= 0) { printf("[INFER] Server closed or error.\n"); break; }
         // 直接转发给推理引擎
-        infer_ipc_send(engine_sock, req_json);
-        std::string resp_json;
-        int m = infer_ipc_recv(engine_sock, resp_json);
-        if (m > 0) {
-            infer_net_send(server_sock, resp_json);
-        } else {
-            printf("[INFER] Engine error.\n");
-        }
+        bool ok = use_shm ? infer_ipc_shm_send(shm, req_json) : infer_ipc_send(engine_sock, req_json) > 0;
+        if (!ok) { printf("[INFER] Engine error.\n"); break; }
     }
+
+    // 关闭引擎连接以唤醒响应线程
+    shutdown(engine_sock, SHUT_RDWR);
+    shutdown(server_sock, SHUT_RDWR);
+    resp_thread.join();
+    if (use_shm) shm_channel_close(shm);
     infer_ipc_close(engine_sock);
     infer_net_close(server_sock);
     return 0;
-} 
\ No newline at end of file
+}
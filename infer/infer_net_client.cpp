@@ -1,8 +1,15 @@
 #include "infer_net_client.h"
+#include "infer_utils.h"
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <cstring>
+#include <map>
+#include <mutex>
+
+// 每个 socket 已收到但未取走的数据（同一 socket 只应有一个读线程）
+static std::map<socket_t, std::string> g_recv_pending;
+static std::mutex g_recv_mutex;
 
 socket_t infer_net_connect(const char* ip, int port) {
     int sock = socket(AF_INET, SOCK_STREAM, 0);
@@ -22,20 +29,27 @@ socket_t infer_net_connect(const char* ip, int port) {
 }
 
 int infer_net_send(socket_t sock, const std::string& json_str) {
-    return send(sock, json_str.c_str(), json_str.size(), 0);
+    return infer_send_frame(sock, json_str.data(), json_str.size());
+}
+
+int infer_net_send(socket_t sock, const char* data, size_t len) {
+    return infer_send_frame(sock, data, len);
 }
 
 int infer_net_recv(socket_t sock, std::string& json_str) {
-    char buf[INFER_MAX_JSON_SIZE+1];
-    int n = recv(sock, buf, INFER_MAX_JSON_SIZE, 0);
-    if (n > 0) {
-        buf[n] = 0;
-        json_str.assign(buf, n);
-        return n;
+    std::string* pending;
+    {
+        std::lock_guard<std::mutex> lock(g_recv_mutex);
+        pending = &g_recv_pending[sock];
     }
-    return -1;
+    return infer_recv_frame(sock, *pending, json_str);
 }
 
 void infer_net_close(socket_t sock) {
-    if (sock >= 0) close(sock);
-} 
\ No newline at end of file
+    if (sock < 0) return;
+    {
+        std::lock_guard<std::mutex> lock(g_recv_mutex);
+        g_recv_pending.erase(sock);
+    }
+    close(sock);
+}
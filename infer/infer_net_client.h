@@ -5,10 +5,11 @@
 typedef int socket_t;
 socket_t infer_net_connect(const char* ip, int port);
 
-// 发送 JSON 字符串到 server，返回发送字节数
+// 发送 JSON 字符串到 server（以 '\n' 分帧），返回发送字节数
 int infer_net_send(socket_t sock, const std::string& json_str);
+int infer_net_send(socket_t sock, const char* data, size_t len);
 
-// 接收 JSON 字符串，阻塞直到收到，返回实际长度，失败返回-1
+// 接收一条 JSON 消息，阻塞直到收到，返回实际长度，失败返回-1
 int infer_net_recv(socket_t sock, std::string& json_str);
 
 // 关闭 socket
@@ -0,0 +1,238 @@
+#include "infer_shm_ring.h"
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+#include <new>
+
+#define SHM_SETUP_MAGIC 0x53484d52u  // "SHMR"
+#define SHM_WRAP_MARKER 0xffffffffu  // 剩余空间不足，跳到环首
+
+// 建立通道时随 fd 一起发送的描述
+struct ShmSetupMsg {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t ring_bytes;
+};
+
+static inline uint64_t align8(uint64_t n) { return (n + 7) & ~(uint64_t)7; }
+
+static inline size_t ctl_size() { return (sizeof(ShmRingCtl) + 63) & ~(size_t)63; }
+
+// 共享内存布局：[req ctl][resp ctl][req data][resp data]
+static void map_rings(ShmChannel& ch, uint64_t ring_bytes, int req_efd, int resp_efd) {
+    char* p = static_cast<char*>(ch.base);
+    ch.req.ctl = reinterpret_cast<ShmRingCtl*>(p);
+    ch.resp.ctl = reinterpret_cast<ShmRingCtl*>(p + ctl_size());
+    ch.req.data = p + 2 * ctl_size();
+    ch.resp.data = ch.req.data + ring_bytes;
+    ch.req.capacity = ch.resp.capacity = ring_bytes;
+    ch.req.doorbell_fd = req_efd;
+    ch.resp.doorbell_fd = resp_efd;
+}
+
+static void reset_channel(ShmChannel& ch) {
+    memset(&ch, 0, sizeof(ch));
+    ch.mem_fd = -1;
+    ch.base = MAP_FAILED;
+    ch.req.doorbell_fd = ch.resp.doorbell_fd = -1;
+    ch.req.peer_fd = ch.resp.peer_fd = -1;
+}
+
+bool shm_channel_create(ShmChannel& ch, size_t ring_bytes) {
+    reset_channel(ch);
+    uint64_t n = 4096;
+    while (n < ring_bytes) n <<= 1;
+    ch.map_size = 2 * ctl_size() + 2 * n;
+
+    ch.mem_fd = memfd_create("infer_shm_ring", MFD_CLOEXEC);
+    if (ch.mem_fd < 0) { perror("memfd_create"); return false; }
+    if (ftruncate(ch.mem_fd, ch.map_size) < 0) { perror("ftruncate"); shm_channel_close(ch); return false; }
+    ch.base = mmap(nullptr, ch.map_size, PROT_READ | PROT_WRITE, MAP_SHARED, ch.mem_fd, 0);
+    if (ch.base == MAP_FAILED) { perror("mmap"); shm_channel_close(ch); return false; }
+
+    int req_efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    int resp_efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (req_efd < 0 || resp_efd < 0) {
+        perror("eventfd");
+        if (req_efd >= 0) close(req_efd);
+        if (resp_efd >= 0) close(resp_efd);
+        shm_channel_close(ch);
+        return false;
+    }
+    map_rings(ch, n, req_efd, resp_efd);
+    new (ch.req.ctl) ShmRingCtl();
+    new (ch.resp.ctl) ShmRingCtl();
+    return true;
+}
+
+bool shm_channel_send_setup(int sock, ShmChannel& ch) {
+    ShmSetupMsg msg{SHM_SETUP_MAGIC, 0, ch.req.capacity};
+    iovec iov{&msg, sizeof(msg)};
+    int fds[3] = {ch.mem_fd, ch.req.doorbell_fd, ch.resp.doorbell_fd};
+    char ctrl[CMSG_SPACE(sizeof(fds))];
+    memset(ctrl, 0, sizeof(ctrl));
+
+    msghdr mh{};
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctrl;
+    mh.msg_controllen = sizeof(ctrl);
+    cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+
+    if (sendmsg(sock, &mh, 0) != (ssize_t)sizeof(msg)) { perror("sendmsg"); return false; }
+    ch.req.peer_fd = ch.resp.peer_fd = sock;
+    return true;
+}
+
+int shm_channel_accept(int sock, ShmChannel& ch, bool& shm_ready, char* buf, int buf_len) {
+    reset_channel(ch);
+    shm_ready = false;
+    int fds[3] = {-1, -1, -1};
+    char ctrl[CMSG_SPACE(sizeof(fds))];
+    iovec iov{buf, (size_t)buf_len};
+    msghdr mh{};
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctrl;
+    mh.msg_controllen = sizeof(ctrl);
+
+    ssize_t n = recvmsg(sock, &mh, MSG_CMSG_CLOEXEC);
+    if (n <= 0) return -1;
+
+    cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+    bool has_fds = cm && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS &&
+                   cm->cmsg_len == CMSG_LEN(sizeof(fds));
+    if (!has_fds) return (int)n;  // 普通数据
+    memcpy(fds, CMSG_DATA(cm), sizeof(fds));
+
+    ShmSetupMsg msg;
+    bool valid = n == (ssize_t)sizeof(msg);
+    if (valid) {
+        memcpy(&msg, buf, sizeof(msg));
+        valid = msg.magic == SHM_SETUP_MAGIC && msg.ring_bytes >= 4096 &&
+                (msg.ring_bytes & (msg.ring_bytes - 1)) == 0;
+    }
+    if (valid) {
+        ch.mem_fd = fds[0];
+        ch.map_size = 2 * ctl_size() + 2 * msg.ring_bytes;
+        ch.base = mmap(nullptr, ch.map_size, PROT_READ | PROT_WRITE, MAP_SHARED, ch.mem_fd, 0);
+        valid = ch.base != MAP_FAILED;
+    }
+    if (!valid) {
+        for (int fd : fds) if (fd >= 0) close(fd);
+        ch.mem_fd = -1;
+        return -1;
+    }
+    map_rings(ch, msg.ring_bytes, fds[1], fds[2]);
+    ch.req.peer_fd = ch.resp.peer_fd = sock;
+    shm_ready = true;
+    return (int)n;
+}
+
+void shm_channel_close(ShmChannel& ch) {
+    if (ch.base != MAP_FAILED && ch.base) munmap(ch.base, ch.map_size);
+    if (ch.mem_fd >= 0) close(ch.mem_fd);
+    if (ch.req.doorbell_fd >= 0) close(ch.req.doorbell_fd);
+    if (ch.resp.doorbell_fd >= 0) close(ch.resp.doorbell_fd);
+    reset_channel(ch);
+}
+
+bool shm_ring_write(ShmRing& ring, const char* data, uint32_t len) {
+    uint64_t need = align8(sizeof(uint32_t) + len);
+    if (len == SHM_WRAP_MARKER || need > ring.capacity / 2) return false;
+
+    uint64_t tail = ring.ctl->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring.ctl->head.load(std::memory_order_acquire);
+    uint64_t idx = tail & (ring.capacity - 1);
+    uint64_t to_end = ring.capacity - idx;
+    uint64_t pad = to_end < need ? to_end : 0;
+    if (ring.capacity - (tail - head) < pad + need) return false;  // 队列满
+
+    if (pad) {
+        uint32_t marker = SHM_WRAP_MARKER;
+        memcpy(ring.data + idx, &marker, sizeof(marker));
+        tail += pad;
+        idx = 0;
+    }
+    memcpy(ring.data + idx, &len, sizeof(len));
+    memcpy(ring.data + idx + sizeof(len), data, len);
+    ring.ctl->tail.store(tail + need, std::memory_order_release);
+
+    // 只有消费者已休眠时才敲门铃，稳态下无系统调用
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ring.ctl->consumer_waiting.load(std::memory_order_relaxed)) {
+        uint64_t one = 1;
+        ssize_t r = write(ring.doorbell_fd, &one, sizeof(one));
+        (void)r;
+    }
+    return true;
+}
+
+bool shm_ring_peek(ShmRing& ring, const char*& data, uint32_t& len) {
+    uint64_t head = ring.ctl->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring.ctl->tail.load(std::memory_order_acquire);
+    if (head == tail) return false;
+
+    uint64_t idx = head & (ring.capacity - 1);
+    uint32_t n;
+    memcpy(&n, ring.data + idx, sizeof(n));
+    if (n == SHM_WRAP_MARKER) {
+        head += ring.capacity - idx;
+        ring.ctl->head.store(head, std::memory_order_release);
+        if (head == tail) return false;
+        idx = 0;
+        memcpy(&n, ring.data, sizeof(n));
+    }
+    data = ring.data + idx + sizeof(n);
+    len = n;
+    return true;
+}
+
+void shm_ring_consume(ShmRing& ring) {
+    const char* data;
+    uint32_t len;
+    if (!shm_ring_peek(ring, data, len)) return;
+    uint64_t head = ring.ctl->head.load(std::memory_order_relaxed);
+    ring.ctl->head.store(head + align8(sizeof(uint32_t) + len), std::memory_order_release);
+}
+
+static inline bool ring_has_data(ShmRing& ring) {
+    return ring.ctl->head.load(std::memory_order_relaxed) != ring.ctl->tail.load(std::memory_order_acquire);
+}
+
+bool shm_ring_wait(ShmRing& ring, int timeout_ms) {
+    for (int i = 0; i < INFER_SHM_SPIN_COUNT; ++i) {
+        if (ring_has_data(ring)) return true;
+    }
+    while (true) {
+        ring.ctl->consumer_waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring_has_data(ring)) {
+            ring.ctl->consumer_waiting.store(0, std::memory_order_relaxed);
+            return true;
+        }
+        pollfd pfds[2];
+        int nfds = 0;
+        pfds[nfds++] = {ring.doorbell_fd, POLLIN, 0};
+        if (ring.peer_fd >= 0) pfds[nfds++] = {ring.peer_fd, POLLRDHUP, 0};
+        int ret = poll(pfds, nfds, timeout_ms);
+        ring.ctl->consumer_waiting.store(0, std::memory_order_relaxed);
+        if (ret < 0) return false;
+        if (ret == 0) return ring_has_data(ring);
+        if (pfds[0].revents & POLLIN) {
+            uint64_t cnt;
+            ssize_t r = read(ring.doorbell_fd, &cnt, sizeof(cnt));
+            (void)r;
+        }
+        if (ring_has_data(ring)) return true;
+        if (nfds > 1 && (pfds[1].revents & (POLLRDHUP | POLLHUP | POLLERR))) return false;
+    }
+}
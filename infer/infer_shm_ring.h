@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// 共享内存环形队列：推理代理与推理引擎之间的零拷贝传输
+// memfd 承载数据，eventfd 作为门铃；UNIX socket 仅用于建立通道时传递 fd
+#define INFER_SHM_RING_BYTES (1 << 20)
+#define INFER_SHM_SPIN_COUNT 2000
+
+// 环形队列控制块（位于共享内存中，读写位置各占独立缓存行）
+struct ShmRingCtl {
+    alignas(64) std::atomic<uint64_t> head;              // 消费者读位置
+    alignas(64) std::atomic<uint64_t> tail;              // 生产者写位置
+    alignas(64) std::atomic<uint32_t> consumer_waiting;  // 消费者已休眠，需要门铃唤醒
+};
+
+// 单向环形队列句柄（单生产者单消费者）
+struct ShmRing {
+    ShmRingCtl* ctl;
+    char* data;
+    uint64_t capacity;  // 2的幂
+    int doorbell_fd;    // eventfd
+    int peer_fd;        // 建立通道用的 UNIX socket，用于检测对端退出
+};
+
+// 共享内存通道：请求环（agent->engine）+ 响应环（engine->agent）
+struct ShmChannel {
+    int mem_fd;
+    void* base;
+    size_t map_size;
+    ShmRing req;
+    ShmRing resp;
+};
+
+// 创建通道（代理端），ring_bytes 向上取整为2的幂
+bool shm_channel_create(ShmChannel& ch, size_t ring_bytes = INFER_SHM_RING_BYTES);
+// 通过已连接的 UNIX socket 把通道 fd 发给对端（SCM_RIGHTS）
+bool shm_channel_send_setup(int sock, ShmChannel& ch);
+// 接收首个消息：对端发来通道建立请求时完成映射并置 shm_ready=true；
+// 否则把普通数据写入 buf。返回接收字节数，失败或对端关闭返回-1
+int shm_channel_accept(int sock, ShmChannel& ch, bool& shm_ready, char* buf, int buf_len);
+// 解除映射并关闭 fd
+void shm_channel_close(ShmChannel& ch);
+
+// 写入一条消息，队列满或消息过大返回 false（不阻塞）
+bool shm_ring_write(ShmRing& ring, const char* data, uint32_t len);
+// 查看队首消息，不拷贝；队列空返回 false
+bool shm_ring_peek(ShmRing& ring, const char*& data, uint32_t& len);
+// 释放队首消息
+void shm_ring_consume(ShmRing& ring);
+// 等待队列非空：先自旋，超过 INFER_SHM_SPIN_COUNT 次再休眠在门铃上
+// 对端退出、超时或出错返回 false；timeout_ms < 0 表示一直等待
+bool shm_ring_wait(ShmRing& ring, int timeout_ms = -1);
@@ -1,5 +1,7 @@
 #pragma once
 #include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <nlohmann/json.hpp>
 
 // 配置选项
@@ -7,6 +9,10 @@
 #define SERVER_PORT 9000
 #define INFER_ENGINE_SOCK_PATH "/tmp/infer_engine.sock"
 #define INFER_MAX_JSON_SIZE 2048
+#define INFER_MAX_PENDING_BYTES (16 * INFER_MAX_JSON_SIZE)
+#define ENGINE_WORKER_THREADS 4
+#define ENGINE_LISTEN_BACKLOG 16
+#define ENGINE_MAX_PENDING_JOBS 64
 
 // 请求/响应结构体（与主项目一致）
 struct InferRequest {
@@ -19,14 +25,15 @@ struct InferRequest {
 
 struct InferResponse {
     std::string id;
+    std::string token;   // 流式输出的单个 token，finished=false 时有效
     std::string result;
     bool finished;
 };
 
 // JSON 序列化/反序列化
-inline bool parse_infer_request(const std::string& str, InferRequest& req) {
+inline bool parse_infer_request(const char* data, size_t len, InferRequest& req) {
     try {
-        auto j = nlohmann::json::parse(str);
+        auto j = nlohmann::json::parse(data, data + len);
         req.id = j.value("id", "");
         req.model = j.value("model", "");
         req.prompt = j.value("prompt", "");
@@ -36,11 +43,82 @@ inline bool parse_infer_request(const std::string& str, InferRequest& req) {
     } catch (...) { return false; }
 }
 
+inline bool parse_infer_request(const std::string& str, InferRequest& req) {
+    return parse_infer_request(str.data(), str.size(), req);
+}
+
 inline std::string dump_infer_response(const InferResponse& resp) {
     nlohmann::json j;
     j["type"] = "response";
     j["id"] = resp.id;
+    if (!resp.token.empty()) j["token"] = resp.token;
     j["result"] = resp.result;
     j["finished"] = resp.finished;
     return j.dump();
-} 
\ No newline at end of file
+}
+
+inline bool parse_infer_response(const char* data, size_t len, InferResponse& resp) {
+    try {
+        auto j = nlohmann::json::parse(data, data + len);
+        resp.id = j.value("id", "");
+        resp.token = j.value("token", "");
+        resp.result = j.value("result", "");
+        resp.finished = j.value("finished", true);
+        return true;
+    } catch (...) { return false; }
+}
+
+// 消息分帧：每条 JSON 以 '\n' 结尾
+// 从接收缓冲中取出一条完整消息，兼容不带分隔符的单条 JSON
+inline bool infer_take_frame(std::string& pending, std::string& out) {
+    size_t nl;
+    while ((nl = pending.find('\n')) == 0) pending.erase(0, 1);
+    if (nl != std::string::npos) {
+        out.assign(pending, 0, nl);
+        pending.erase(0, nl + 1);
+        return true;
+    }
+    if (!pending.empty() && nlohmann::json::accept(pending)) {
+        out.swap(pending);
+        pending.clear();
+        return true;
+    }
+    return false;
+}
+
+// 从 socket 读取一条完整消息，pending 保存已收到但未取走的数据
+// 返回消息长度，失败或对端关闭返回-1
+inline int infer_recv_frame(int sock, std::string& pending, std::string& out) {
+    while (!infer_take_frame(pending, out)) {
+        if (pending.size() > INFER_MAX_PENDING_BYTES) pending.clear(); // 超长无效数据，丢弃
+        char buf[INFER_MAX_JSON_SIZE];
+        ssize_t n = recv(sock, buf, sizeof(buf), 0);
+        if (n <= 0) return -1;
+        pending.append(buf, n);
+    }
+    return (int)out.size();
+}
+
+// 发送一条消息并追加 '\n'，处理部分写，返回消息长度，失败返回-1
+inline int infer_send_frame(int sock, const char* data, size_t len) {
+    char nl = '\n';
+    iovec iov[2] = {{const_cast<char*>(data), len}, {&nl, 1}};
+    msghdr mh{};
+    mh.msg_iov = iov;
+    mh.msg_iovlen = 2;
+    size_t left = len + 1;
+    while (left > 0) {
+        ssize_t n = sendmsg(sock, &mh, MSG_NOSIGNAL);
+        if (n <= 0) return -1;
+        left -= n;
+        // 跳过已发送部分
+        while (n > 0 && mh.msg_iovlen > 0) {
+            size_t step = (size_t)n < mh.msg_iov->iov_len ? (size_t)n : mh.msg_iov->iov_len;
+            mh.msg_iov->iov_base = static_cast<char*>(mh.msg_iov->iov_base) + step;
+            mh.msg_iov->iov_len -= step;
+            n -= step;
+            if (mh.msg_iov->iov_len == 0) { mh.msg_iov++; mh.msg_iovlen--; }
+        }
+    }
+    return (int)len;
+}
@@ -0,0 +1,370 @@
+#include "admin_server.h"
+#include "task_manager.h"
+#include "npu_node_manager.h"
+#include "model_router.h"
+#include "client_manager.h"
+#include "utils/metrics.h"
+#include "utils/trace.h"
+#include "utils/mem_budget.h"
+#include "utils/buf_pool.h"
+#include "utils/thread_topology.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstring>
+#include <cstdio>
+#include <cstdarg>
+#include <atomic>
+#include <thread>
+
+#define ADMIN_REQ_BUF_SIZE 2048
+#define ADMIN_IO_TIMEOUT_MS 1000
+
+static int admin_tcp_fd = -1;
+static int admin_unix_fd = -1;
+static std::string admin_unix_path;
+static TaskManager* admin_task_mgr = nullptr;
+static std::atomic<bool> admin_running(false);
+static std::thread admin_thread;
+
+static void appendf(std::string& out, const char* fmt, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n > 0) out.append(buf, n < (int)sizeof(buf) ? n : (int)sizeof(buf) - 1);
+}
+
+// 任务池/队列等需要访问 TaskManager 的瞬时值
+struct TaskGauges {
+    size_t pending;
+    size_t processing;
+    size_t cached;
+    size_t capacity;
+    size_t token_lists;
+    size_t stream_capacity;
+    size_t inflight_leaders;
+    size_t followers;
+    size_t dispatch_queued;
+    size_t dispatch_workers;
+};
+
+static void collect_task_gauges(TaskManager* task_mgr, TaskGauges& g) {
+    memset(&g, 0, sizeof(g));
+    if (!task_mgr) return;
+    g.pending = task_mgr->getPendingTaskCount();
+    g.processing = task_mgr->getProcessingTaskCount();
+    g.cached = task_mgr->getTotalTaskCount();
+    g.capacity = task_mgr->getTaskCapacity();
+    g.token_lists = task_mgr->getTokenListCount();
+    g.stream_capacity = task_mgr->getStreamCapacity();
+    g.inflight_leaders = task_mgr->getInflightLeaderCount();
+    g.followers = task_mgr->getFollowerCount();
+    g.dispatch_queued = task_mgr->getDispatchQueued();
+    g.dispatch_workers = (size_t)task_mgr->getDispatchWorkers();
+}
+
+std::string admin_render_prometheus(TaskManager* task_mgr) {
+    std::string out;
+    out.reserve(131072);  // 直方图逐桶输出，每个约 300 行
+    for (int i = 0; i < Metrics::NUM_COUNTERS; ++i) {
+        Metrics::Counter c = static_cast<Metrics::Counter>(i);
+        appendf(out, "# TYPE gateway_%s_total counter\n", Metrics::counterName(c));
+        appendf(out, "gateway_%s_total %llu\n", Metrics::counterName(c), (unsigned long long)Metrics::counter(c));
+    }
+    for (int i = 0; i < Metrics::NUM_GAUGES; ++i) {
+        Metrics::Gauge g = static_cast<Metrics::Gauge>(i);
+        appendf(out, "# TYPE gateway_%s gauge\n", Metrics::gaugeName(g));
+        appendf(out, "gateway_%s %lld\n", Metrics::gaugeName(g), (long long)Metrics::gauge(g));
+    }
+
+    TaskGauges tg;
+    collect_task_gauges(task_mgr, tg);
+    const struct { const char* name; size_t value; } task_gauges[] = {
+        {"task_queue_pending", tg.pending},
+        {"task_queue_processing", tg.processing},
+        {"task_pool_used", tg.cached},
+        {"task_pool_capacity", tg.capacity},
+        {"token_lists", tg.token_lists},
+        {"stream_table_capacity", tg.stream_capacity},
+        {"inflight_leaders", tg.inflight_leaders},
+        {"inflight_followers", tg.followers},
+        {"dispatch_queued", tg.dispatch_queued},
+        {"dispatch_workers", tg.dispatch_workers},
+    };
+    for (auto& tgi : task_gauges) {
+        appendf(out, "# TYPE gateway_%s gauge\n", tgi.name);
+        appendf(out, "gateway_%s %zu\n", tgi.name, tgi.value);
+    }
+
+    // 内存预算
+    out += "# TYPE gateway_memory_used_bytes gauge\n";
+    for (int i = 0; i < MemBudget::NUM_CATEGORIES; ++i) {
+        MemBudget::Category c = static_cast<MemBudget::Category>(i);
+        appendf(out, "gateway_memory_used_bytes{category=\"%s\"} %lld\n", MemBudget::categoryName(c), (long long)MemBudget::used(c));
+    }
+    appendf(out, "# TYPE gateway_memory_limit_bytes gauge\ngateway_memory_limit_bytes %zu\n", MemBudget::config().global_limit);
+    appendf(out, "# TYPE gateway_backpressure gauge\ngateway_backpressure %d\n", MemBudget::paused() ? 1 : 0);
+
+    // 节点维度
+    int node_count = npu_get_node_count();
+    out += "# TYPE gateway_npu_node_connected gauge\n";
+    for (int i = 0; i < node_count; ++i) {
+        const NPUNodeStats* st = npu_get_node_stats(i);
+        appendf(out, "gateway_npu_node_connected{node=\"%d\",addr=\"%s\"} %d\n", i, st->addr, st->connected.load() ? 1 : 0);
+    }
+    out += "# TYPE gateway_npu_node_inflight gauge\n";
+    for (int i = 0; i < node_count; ++i) {
+        const NPUNodeStats* st = npu_get_node_stats(i);
+        appendf(out, "gateway_npu_node_inflight{node=\"%d\",addr=\"%s\"} %lld\n", i, st->addr, (long long)st->inflight.load());
+    }
+    out += "# TYPE gateway_npu_node_requests_total counter\n";
+    for (int i = 0; i < node_count; ++i) {
+        const NPUNodeStats* st = npu_get_node_stats(i);
+        appendf(out, "gateway_npu_node_requests_total{node=\"%d\",addr=\"%s\"} %llu\n", i, st->addr, (unsigned long long)st->requests_sent.load());
+    }
+    out += "# TYPE gateway_npu_node_tokens_total counter\n";
+    for (int i = 0; i < node_count; ++i) {
+        const NPUNodeStats* st = npu_get_node_stats(i);
+        appendf(out, "gateway_npu_node_tokens_total{node=\"%d\",addr=\"%s\"} %llu\n", i, st->addr, (unsigned long long)st->tokens_received.load());
+    }
+
+    // 直方图：逐桶输出上界与累计值（空桶也输出，保证 le 序列完整单调），外加 +Inf
+    Metrics::HistogramSnapshot snap;
+    for (int i = 0; i < Metrics::NUM_HISTOGRAMS; ++i) {
+        Metrics::Histogram h = static_cast<Metrics::Histogram>(i);
+        const char* name = Metrics::histogramName(h);
+        Metrics::snapshot(h, snap);
+        appendf(out, "# TYPE gateway_%s histogram\n", name);
+        uint64_t cumulative = 0;
+        for (int b = 0; b < Metrics::NUM_BUCKETS - 1; ++b) {
+            cumulative += snap.buckets[b];
+            appendf(out, "gateway_%s_bucket{le=\"%llu\"} %llu\n", name,
+                    (unsigned long long)(Metrics::bucketLowerBound(b + 1) - 1), (unsigned long long)cumulative);
+        }
+        cumulative += snap.buckets[Metrics::NUM_BUCKETS - 1];
+        appendf(out, "gateway_%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+        appendf(out, "gateway_%s_sum %llu\n", name, (unsigned long long)snap.sum);
+        appendf(out, "gateway_%s_count %llu\n", name, (unsigned long long)cumulative);
+    }
+    return out;
+}
+
+std::string admin_render_json(TaskManager* task_mgr) {
+    std::string out;
+    out.reserve(4096);
+    out += "{\"counters\":{";
+    for (int i = 0; i < Metrics::NUM_COUNTERS; ++i) {
+        Metrics::Counter c = static_cast<Metrics::Counter>(i);
+        appendf(out, "%s\"%s\":%llu", i ? "," : "", Metrics::counterName(c), (unsigned long long)Metrics::counter(c));
+    }
+    out += "},\"gauges\":{";
+    for (int i = 0; i < Metrics::NUM_GAUGES; ++i) {
+        Metrics::Gauge g = static_cast<Metrics::Gauge>(i);
+        appendf(out, "%s\"%s\":%lld", i ? "," : "", Metrics::gaugeName(g), (long long)Metrics::gauge(g));
+    }
+
+    TaskGauges tg;
+    collect_task_gauges(task_mgr, tg);
+    appendf(out, "},\"tasks\":{\"queue_pending\":%zu,\"queue_processing\":%zu,\"pool_used\":%zu,\"pool_capacity\":%zu,"
+                 "\"token_lists\":%zu,\"stream_table_capacity\":%zu,\"inflight_leaders\":%zu,\"inflight_followers\":%zu,"
+                 "\"dispatch_queued\":%zu,\"dispatch_workers\":%zu}",
+            tg.pending, tg.processing, tg.cached, tg.capacity, tg.token_lists, tg.stream_capacity, tg.inflight_leaders,
+            tg.followers, tg.dispatch_queued, tg.dispatch_workers);
+
+    appendf(out, ",\"memory\":{\"used\":%lld,\"limit\":%zu,\"backpressure\":%s",
+            (long long)MemBudget::used(), MemBudget::config().global_limit, MemBudget::paused() ? "true" : "false");
+    for (int i = 0; i < MemBudget::NUM_CATEGORIES; ++i) {
+        MemBudget::Category c = static_cast<MemBudget::Category>(i);
+        appendf(out, ",\"%s\":%lld", MemBudget::categoryName(c), (long long)MemBudget::used(c));
+    }
+    out += "}";
+
+    appendf(out, ",\"prealloc\":{\"active\":%s,\"region_bytes\":%zu,\"huge_pages\":%s,\"locked\":%s,"
+                 "\"token_pool_used\":%zu,\"token_pool_capacity\":%zu,\"token_text_pool_used\":%zu,"
+                 "\"token_text_pool_capacity\":%zu,\"task_pool_used\":%zu,\"task_pool_capacity\":%zu}",
+            Prealloc::active() ? "true" : "false", Prealloc::regionSize(),
+            Prealloc::usingHugePages() ? "true" : "false", Prealloc::memoryLocked() ? "true" : "false",
+            TokenNode::pool().used(), TokenNode::pool().capacity(), TokenNode::textPool().used(),
+            TokenNode::textPool().capacity(), TaskContext::pool().used(), TaskContext::pool().capacity());
+    appendf(out, ",\"recv_buffers\":{\"capacity\":%zu,\"available\":%zu}",
+            BufPool::capacity(), BufPool::available());
+    appendf(out, ",\"connections\":{\"capacity\":%d,\"connected\":%lld,\"table_bytes\":%zu}",
+            client_manager_capacity(), (long long)Metrics::gauge(Metrics::Gauge::CLIENTS_CONNECTED),
+            client_manager_table_bytes());
+
+    out += ",\"npu_nodes\":[";
+    int node_count = npu_get_node_count();
+    for (int i = 0; i < node_count; ++i) {
+        const NPUNodeStats* st = npu_get_node_stats(i);
+        appendf(out, "%s{\"node\":%d,\"addr\":\"%s\",\"connected\":%s,\"inflight\":%lld,\"requests\":%llu,\"messages\":%llu,\"tokens\":%llu",
+                i ? "," : "", i, st->addr, st->connected.load() ? "true" : "false",
+                (long long)st->inflight.load(), (unsigned long long)st->requests_sent.load(),
+                (unsigned long long)st->messages_received.load(), (unsigned long long)st->tokens_received.load());
+        // 节点上报的模型与容量（未发送过 status 的节点没有这些字段）
+        NodeModelStatus ms;
+        if (model_router_node_status(i, ms)) {
+            appendf(out, ",\"available\":%s,\"load\":%.2f,\"capacity\":%d,\"models\":[",
+                    ms.available ? "true" : "false", ms.load, ms.capacity);
+            for (int m = 0; m < ms.model_count; ++m) appendf(out, "%s\"%s\"", m ? "," : "", ms.models[m]);
+            out += "]";
+        }
+        out += "}";
+    }
+
+    out += "],\"histograms\":{";
+    Metrics::HistogramSnapshot snap;
+    for (int i = 0; i < Metrics::NUM_HISTOGRAMS; ++i) {
+        Metrics::Histogram h = static_cast<Metrics::Histogram>(i);
+        Metrics::snapshot(h, snap);
+        appendf(out, "%s\"%s\":{\"count\":%llu,\"mean\":%.1f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}",
+                i ? "," : "", Metrics::histogramName(h), (unsigned long long)snap.count, snap.mean(),
+                (unsigned long long)snap.percentile(50), (unsigned long long)snap.percentile(90),
+                (unsigned long long)snap.percentile(99), (unsigned long long)snap.percentile(99.9),
+                (unsigned long long)snap.max);
+    }
+    out += "}}\n";
+    return out;
+}
+
+static void admin_send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void admin_reply(int fd, const char* status, const char* content_type, const std::string& body) {
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                     status, content_type, body.size());
+    admin_send_all(fd, header, (size_t)n);
+    admin_send_all(fd, body.data(), body.size());
+}
+
+// 处理一个管理连接：读取请求行后回应并关闭
+static void admin_handle_conn(int fd) {
+    timeval tv;
+    tv.tv_sec = ADMIN_IO_TIMEOUT_MS / 1000;
+    tv.tv_usec = (ADMIN_IO_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    char buf[ADMIN_REQ_BUF_SIZE + 1];
+    int len = 0;
+    while (len < ADMIN_REQ_BUF_SIZE) {
+        ssize_t n = recv(fd, buf + len, ADMIN_REQ_BUF_SIZE - len, 0);
+        if (n <= 0) break;
+        len += (int)n;
+        buf[len] = 0;
+        if (strstr(buf, "\r\n\r\n") || strstr(buf, "\n\n")) break;
+    }
+    buf[len] = 0;
+
+    char method[8] = {0};
+    char path[128] = {0};
+    if (sscanf(buf, "%7s %127s", method, path) != 2 || strcmp(method, "GET") != 0) {
+        admin_reply(fd, "400 Bad Request", "text/plain", "bad request\n");
+        return;
+    }
+    char* query = strchr(path, '?');
+    if (query) *query = 0;
+
+    if (strcmp(path, "/metrics") == 0) {
+        admin_reply(fd, "200 OK", "text/plain; version=0.0.4", admin_render_prometheus(admin_task_mgr));
+    } else if (strcmp(path, "/stats") == 0 || strcmp(path, "/metrics.json") == 0) {
+        admin_reply(fd, "200 OK", "application/json", admin_render_json(admin_task_mgr));
+    } else if (strcmp(path, "/trace") == 0) {
+        admin_reply(fd, "200 OK", "application/json", Trace::renderChrome());
+    } else {
+        admin_reply(fd, "404 Not Found", "text/plain", "try /metrics, /stats or /trace\n");
+    }
+}
+
+static void admin_loop() {
+    ThreadTopology::apply(ThreadTopology::Role::ADMIN);
+    pollfd fds[2];
+    while (admin_running.load()) {
+        int nfds = 0;
+        if (admin_tcp_fd >= 0) fds[nfds++] = {admin_tcp_fd, POLLIN, 0};
+        if (admin_unix_fd >= 0) fds[nfds++] = {admin_unix_fd, POLLIN, 0};
+        // 超时用于检查停止标志
+        int ret = poll(fds, nfds, 200);
+        if (ret <= 0) continue;
+        for (int i = 0; i < nfds; ++i) {
+            if (!(fds[i].revents & POLLIN)) continue;
+            int cli_fd = accept4(fds[i].fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (cli_fd < 0) continue;
+            admin_handle_conn(cli_fd);
+            close(cli_fd);
+        }
+    }
+}
+
+static int admin_listen_tcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        perror("admin bind");
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+static int admin_listen_unix(const char* path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        perror("admin bind unix");
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+bool admin_server_start(int port, const char* unix_path, TaskManager* task_mgr) {
+    if (admin_running.load()) return false;
+    admin_task_mgr = task_mgr;
+    if (port > 0) admin_tcp_fd = admin_listen_tcp(port);
+    if (unix_path && unix_path[0]) {
+        admin_unix_fd = admin_listen_unix(unix_path);
+        if (admin_unix_fd >= 0) admin_unix_path = unix_path;
+    }
+    if (admin_tcp_fd < 0 && admin_unix_fd < 0) return false;
+    admin_running = true;
+    admin_thread = std::thread(admin_loop);
+    return true;
+}
+
+void admin_server_stop() {
+    if (!admin_running.exchange(false)) return;
+    if (admin_thread.joinable()) admin_thread.join();
+    if (admin_tcp_fd >= 0) close(admin_tcp_fd);
+    if (admin_unix_fd >= 0) {
+        close(admin_unix_fd);
+        unlink(admin_unix_path.c_str());
+    }
+    admin_tcp_fd = admin_unix_fd = -1;
+    admin_unix_path.clear();
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+
+#define ADMIN_DEFAULT_PORT 9100
+
+class TaskManager; // 前向声明
+
+// 启动管理端点（独立线程，不占用反应器线程）
+// port <= 0 时不监听TCP（仅绑定 127.0.0.1）；unix_path 为空时不监听UNIX socket
+// 支持 HTTP GET：/metrics 输出 Prometheus 文本格式，/stats 输出 JSON，
+// /trace 输出采样请求的 Chrome trace-event JSON
+bool admin_server_start(int port, const char* unix_path, TaskManager* task_mgr);
+// 停止管理端点并等待线程退出
+void admin_server_stop();
+// 生成指标文本
+std::string admin_render_prometheus(TaskManager* task_mgr);
+std::string admin_render_json(TaskManager* task_mgr);
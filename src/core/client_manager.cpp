@@ -1,154 +1,650 @@
 #include "client_manager.h"
 #include "task_manager.h"
+#include "npu_node_manager.h"
+#include "io_engine.h"
+#include "conn_liveness.h"
+#include "model_router.h"
 #include <sys/socket.h>
+#include <sys/mman.h>
 #include <netinet/in.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <cstring>
 #include <cstdio>
+#include <cerrno>
 #include <algorithm>
+#include <new>
 #include "json_utils.h"
 #include "../common/data_structures.h"
+#include "utils/metrics.h"
+#include "utils/trace.h"
+#include "utils/mem_budget.h"
+#include "utils/timer_wheel.h"
+#include "utils/prealloc.h"
+#include "utils/request_id.h"
 
 static int listen_fd = -1;
-static ClientList clients;
-static ClientRequestList client_requests;  // 客户端请求映射列表
+static ClientLimits client_limits = {0, 0, 0};
+static bool reject_requests = false;  // 排空中：已有连接上的新请求直接回错误
+static int max_wait_ms = -1;
 
-void client_manager_init(int listen_port) {
-    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (listen_fd < 0) {
+// 连接槽表：启动时按配置的容量一次性分配（预分配模式下从预分配区域切分），运行中不再分配。
+// 按 fd 直接定位槽位；空闲槽用栈管理，已占用槽另存一张紧凑列表供事件循环遍历，增删均为 O(1)
+static ClientInfo* client_slots = nullptr;
+static int32_t* slot_of_fd = nullptr;  // fd -> 槽号，-1 表示未占用；大小为引擎的 fd 表大小
+static int32_t* free_slots = nullptr;
+static int32_t* live_slots = nullptr;
+static int client_capacity = 0;
+static int fd_capacity = 0;
+static int free_count = 0;
+static int live_count = 0;
+
+// 客户端请求映射：同样一次性分配，按到达顺序存放，清理时原地压缩
+static ClientRequestMapping* client_requests = nullptr;
+static int request_capacity = 0;
+static int request_count = 0;
+
+static void* table_base = nullptr;
+static size_t table_bytes = 0;
+static size_t table_mapped = 0;  // 自行 mmap 的字节数，从预分配区域切分时为 0
+
+static size_t align64(size_t n) {
+    return (n + 63) & ~(size_t)63;
+}
+
+static bool client_tables_alloc(int max_clients, int max_fds) {
+    size_t slots_bytes = align64(sizeof(ClientInfo) * max_clients);
+    size_t fd_bytes = align64(sizeof(int32_t) * max_fds);
+    size_t list_bytes = align64(sizeof(int32_t) * max_clients);
+    size_t req_bytes = align64(sizeof(ClientRequestMapping) * max_clients);
+    size_t bytes = slots_bytes + fd_bytes + 2 * list_bytes + req_bytes;
+    char* mem = (char*)Prealloc::carve(bytes);
+    if (!mem) {
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return false;
+        mem = (char*)p;
+        table_mapped = bytes;
+    }
+    table_base = mem;
+    table_bytes = bytes;
+    client_slots = (ClientInfo*)mem;
+    slot_of_fd = (int32_t*)(mem + slots_bytes);
+    free_slots = (int32_t*)(mem + slots_bytes + fd_bytes);
+    live_slots = (int32_t*)(mem + slots_bytes + fd_bytes + list_bytes);
+    client_requests = (ClientRequestMapping*)(mem + slots_bytes + fd_bytes + 2 * list_bytes);
+    for (int i = 0; i < max_clients; ++i) new (&client_requests[i]) ClientRequestMapping();
+    client_capacity = max_clients;
+    fd_capacity = max_fds;
+    request_capacity = max_clients;
+    request_count = 0;
+    return true;
+}
+
+static void client_tables_free() {
+    for (int i = 0; i < request_capacity; ++i) client_requests[i].~ClientRequestMapping();
+    if (table_mapped) munmap(table_base, table_mapped);
+    table_base = nullptr;
+    table_bytes = table_mapped = 0;
+    client_slots = nullptr;
+    slot_of_fd = free_slots = live_slots = nullptr;
+    client_requests = nullptr;
+    client_capacity = fd_capacity = request_capacity = 0;
+    free_count = live_count = request_count = 0;
+}
+
+// 连接定时器：按槽号挂在时间轮上，100ms 一格、1024 格（约 100 秒一圈）
+#define CLIENT_TIMER_TICK_MS 100
+#define CLIENT_TIMER_SLOTS 1024
+static TimerWheel client_timers;
+
+// 连接的下一个截止时间：发送受阻时为写截止，无在途流时为空闲截止；
+// 在途流等待节点出 token 时不算空闲，按较短的间隔复查。流本身的失败不在这里处理：
+// 节点断开时其上的流由 npu_on_closed 判失败，节点不出 token 时按 stream_idle_ms 在投递时判失败。都关闭时返回 -1
+static int64_t client_deadline(const ClientInfo& c, int64_t now) {
+    const LivenessConfig& cfg = liveness_config();
+    if (c.write_blocked_ms && cfg.client_write_ms) return c.write_blocked_ms + cfg.client_write_ms;
+    if (c.streams == 0 && cfg.client_idle_ms) return c.last_active_ms + cfg.client_idle_ms;
+    uint32_t recheck = cfg.client_idle_ms;
+    if (cfg.client_write_ms && (!recheck || cfg.client_write_ms < recheck)) recheck = cfg.client_write_ms;
+    if (cfg.stream_idle_ms && (!recheck || cfg.stream_idle_ms < recheck)) recheck = cfg.stream_idle_ms;
+    return recheck ? now + recheck : -1;
+}
+
+static void client_schedule(int32_t slot, int64_t now) {
+    int64_t due = client_deadline(client_slots[slot], now);
+    if (due < 0) client_timers.cancel(slot);
+    else client_timers.schedule(slot, due);
+}
+
+// 令牌桶容量：未单独配置 burst 时允许一秒的量
+static float client_rate_cap() {
+    return (float)(client_limits.burst ? client_limits.burst : client_limits.requests_per_sec);
+}
+
+// 请求准入：在途流数与令牌桶都满足时扣一个令牌
+static bool client_admit(ClientInfo& c, int64_t now) {
+    if (client_limits.max_streams > 0 && c.streams >= client_limits.max_streams) return false;
+    if (client_limits.requests_per_sec == 0) return true;
+    float cap = client_rate_cap();
+    c.rate_tokens += (float)(now - c.rate_refill_ms) * client_limits.requests_per_sec / 1000.0f;
+    if (c.rate_tokens > cap) c.rate_tokens = cap;
+    c.rate_refill_ms = now;
+    if (c.rate_tokens < 1.0f) return false;
+    c.rate_tokens -= 1.0f;
+    return true;
+}
+
+static void client_slots_reset() {
+    for (int i = 0; i < live_count; ++i) client_timers.cancel(live_slots[i]);
+    for (int i = 0; i < fd_capacity; ++i) slot_of_fd[i] = -1;
+    for (int i = 0; i < client_capacity; ++i) free_slots[i] = client_capacity - 1 - i;
+    free_count = client_capacity;
+    live_count = 0;
+}
+
+bool client_manager_add(int socket_fd) {
+    if (socket_fd < 0 || socket_fd >= fd_capacity || slot_of_fd[socket_fd] >= 0) return false;
+    if (free_count == 0) return false;
+    int32_t slot = free_slots[--free_count];
+    int64_t now = liveness_now_ms();
+    client_slots[slot] = {socket_fd, true, 0, false, live_count, 0, now, 0, client_rate_cap(), now, false};
+    live_slots[live_count++] = slot;
+    slot_of_fd[socket_fd] = slot;
+    client_schedule(slot, now);
+    return true;
+}
+
+void client_manager_remove(int socket_fd) {
+    if (socket_fd < 0 || socket_fd >= fd_capacity) return;
+    int32_t slot = slot_of_fd[socket_fd];
+    if (slot < 0) return;
+    // 末尾槽补到被删除的位置
+    int pos = client_slots[slot].live_index;
+    int32_t moved = live_slots[--live_count];
+    live_slots[pos] = moved;
+    client_slots[moved].live_index = pos;
+    client_slots[slot].connected = false;
+    client_timers.cancel(slot);
+    slot_of_fd[socket_fd] = -1;
+    free_slots[free_count++] = slot;
+}
+
+int client_manager_count() {
+    return live_count;
+}
+
+ClientInfo* client_manager_at(int index) {
+    return &client_slots[live_slots[index]];
+}
+
+int client_manager_capacity() {
+    return client_capacity;
+}
+
+size_t client_manager_table_bytes() {
+    return table_bytes;
+}
+
+// 新建监听 socket，失败返回 -1
+static int client_listen(int listen_port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
         perror("socket");
-        return;
+        return -1;
     }
     int opt = 1;
-    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY;
     addr.sin_port = htons(listen_port);
-    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
         perror("bind");
-        close(listen_fd);
-        listen_fd = -1;
-        return;
+        close(fd);
+        return -1;
     }
-    if (listen(listen_fd, MAX_CLIENTS) < 0) {
+    // 积压队列与连接容量无关，内核会再按 somaxconn 截断
+    if (listen(fd, CLIENT_LISTEN_BACKLOG) < 0) {
         perror("listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool client_manager_init(int listen_port, int max_clients, int inherited_listen_fd) {
+    // 槽表覆盖引擎 fd 表的全部 fd，引擎需先按预期连接数初始化
+    int max_fds = io_engine_max_fds();
+    if (max_clients <= 0 || max_fds <= 0) return false;
+    if (client_slots) client_tables_free();
+    if (!client_tables_alloc(max_clients, max_fds)) {
+        perror("client tables");
+        return false;
+    }
+    if (!client_timers.init(max_clients, CLIENT_TIMER_TICK_MS, CLIENT_TIMER_SLOTS, liveness_now_ms())) {
+        client_tables_free();
+        return false;
+    }
+    client_slots_reset();
+    // 热重启时监听 socket 由旧进程移交，积压队列中尚未 accept 的连接一并继承
+    listen_fd = inherited_listen_fd >= 0 ? inherited_listen_fd : client_listen(listen_port);
+    if (listen_fd < 0) return false;
+    fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+    // 保活与 TCP_USER_TIMEOUT 设在监听 socket 上，新连接直接继承
+    liveness_apply_socket(listen_fd);
+    if (!io_engine_add(listen_fd, IoOwner::LISTENER)) {
+        fprintf(stderr, "io engine: cannot register listener\n");
+    }
+    return true;
+}
+
+void client_manager_set_limits(const ClientLimits& limits) {
+    client_limits = limits;
+}
+
+const ClientLimits& client_manager_limits() {
+    return client_limits;
+}
+
+void client_manager_reconfigure() {
+    if (listen_fd >= 0) liveness_apply_socket(listen_fd);
+    int64_t now = liveness_now_ms();
+    for (int i = 0; i < live_count; ++i) client_schedule(live_slots[i], now);
+}
+
+void client_manager_stop_accepting() {
+    if (listen_fd < 0) return;
+    io_engine_remove(listen_fd);
+    close(listen_fd);
+    listen_fd = -1;
+}
+
+void client_manager_pause_accepting(bool paused) {
+    if (listen_fd >= 0) io_engine_set_paused(listen_fd, paused);
+}
+
+int client_manager_listen_fd() {
+    return listen_fd;
+}
+
+void client_manager_set_reject_requests(bool reject) {
+    reject_requests = reject;
+}
+
+void client_manager_set_max_wait(int ms) {
+    max_wait_ms = ms;
+}
+
+int client_manager_stream_count() {
+    return request_count;
+}
+
+// 空闲：没有在途流、没有未发出的 token，也没有受阻的发送
+static bool client_idle(const ClientInfo& c) {
+    return c.streams == 0 && c.pending_bytes == 0 && c.write_blocked_ms == 0;
+}
+
+void client_manager_close_all() {
+    if (listen_fd >= 0) {
+        io_engine_remove(listen_fd);
         close(listen_fd);
         listen_fd = -1;
+    }
+    for (int i = 0; i < live_count; ++i) {
+        ClientInfo& c = client_slots[live_slots[i]];
+        io_engine_remove(c.socket_fd);
+        close(c.socket_fd);
+    }
+    client_slots_reset();
+    if (client_slots) client_tables_free();
+}
+
+ClientInfo* client_manager_find(int socket_fd) {
+    if (socket_fd < 0 || socket_fd >= fd_capacity) return nullptr;
+    int32_t slot = slot_of_fd[socket_fd];
+    return slot >= 0 ? &client_slots[slot] : nullptr;
+}
+
+// 引擎交来的连接已是非阻塞（accept4 SOCK_NONBLOCK），这里只占槽并注册，不再额外发起系统调用
+static void client_accept(int cli_fd) {
+    if (!client_manager_add(cli_fd)) {
+        close(cli_fd); // 槽表已满
+        Metrics::add(Metrics::Counter::CLIENT_REJECTED);
         return;
     }
-    fcntl(listen_fd, F_SETFL, O_NONBLOCK);
-    clients.clear();
+    if (!io_engine_add(cli_fd, IoOwner::CLIENT)) {
+        client_manager_remove(cli_fd);
+        close(cli_fd);
+        Metrics::add(Metrics::Counter::CLIENT_REJECTED);
+        return;
+    }
+    Metrics::add(Metrics::Counter::CLIENT_ACCEPTED);
 }
 
-void client_manager_close_all() {
-    if (listen_fd >= 0) close(listen_fd);
-    for (auto& c : clients) {
-        if (c.connected) close(c.socket_fd);
+// 清理已结束的请求映射：保持到达顺序原地压缩，并归还所属连接的在途流计数
+static void client_requests_compact() {
+    int keep = 0;
+    for (int i = 0; i < request_count; ++i) {
+        ClientRequestMapping& req = client_requests[i];
+        if (!req.is_active) {
+            ClientInfo* c = client_manager_find(req.client_socket);
+            if (c && c->streams > 0) c->streams--;
+            continue;
+        }
+        if (keep != i) client_requests[keep] = req;
+        keep++;
     }
-    clients.clear();
+    request_count = keep;
+    Metrics::setGauge(Metrics::Gauge::CLIENT_STREAMS, request_count);
 }
 
-ClientList* client_manager_get_list() {
-    return &clients;
+static void client_close(TaskManager* task_mgr, int fd) {
+    client_manager_remove(fd);
+    Metrics::add(Metrics::Counter::CLIENT_CLOSED);
+    io_engine_remove(fd);
+    close(fd);
+    // 清理对应的请求映射
+    for (int j = 0; j < request_count; ++j) {
+        ClientRequestMapping& req = client_requests[j];
+        if (req.is_active && req.client_socket == fd) {
+            Trace::abort(req.request_id);
+            if (task_mgr) task_mgr->cancelStream(req.request_id);
+            req.is_active = false;
+        }
+    }
+    client_requests_compact();
 }
 
-void client_manager_run(TaskManager* task_mgr) {
-    fd_set readfds;
-    char buf[MAX_JSON_SIZE+1];
-    while (true) {
-        FD_ZERO(&readfds);
-        FD_SET(listen_fd, &readfds);
-        int maxfd = listen_fd;
-        for (auto& c : clients) {
-            if (c.connected) {
-                FD_SET(c.socket_fd, &readfds);
-                if (c.socket_fd > maxfd) maxfd = c.socket_fd;
-            }
+int client_manager_close_idle() {
+    // 倒序遍历：删除时末尾的槽补到当前位置，补上来的槽已检查过
+    for (int i = live_count - 1; i >= 0; --i) {
+        ClientInfo& c = client_slots[live_slots[i]];
+        if (client_idle(c)) client_close(nullptr, c.socket_fd);
+    }
+    return live_count;
+}
+
+int client_manager_take_idle(int* fds, int max) {
+    int n = 0;
+    for (int i = 0; i < live_count && n < max; ++i) {
+        ClientInfo& c = client_slots[live_slots[i]];
+        if (!client_idle(c)) continue;
+        if (!c.handoff) {
+            // 先停止读取；io_uring 的取消在下一轮提交，完成之前可能还有数据送达
+            c.handoff = true;
+            c.paused = true;
+            io_engine_set_paused(c.socket_fd, true);
+            continue;
         }
-        int ret = select(maxfd+1, &readfds, nullptr, nullptr, nullptr);
-        if (ret < 0) continue;
-        // 新连接
-        if (FD_ISSET(listen_fd, &readfds)) {
-            sockaddr_in cli_addr{};
-            socklen_t cli_len = sizeof(cli_addr);
-            int cli_fd = accept(listen_fd, (sockaddr*)&cli_addr, &cli_len);
-            if (cli_fd >= 0 && clients.size() < MAX_CLIENTS) {
-                fcntl(cli_fd, F_SETFL, O_NONBLOCK);
-                clients.push_back({cli_fd, cli_addr, true});
-            } else if (cli_fd >= 0) {
-                close(cli_fd); // 超过最大连接数
-            }
+        if (io_engine_quiesced(c.socket_fd)) fds[n++] = c.socket_fd;
+    }
+    return n;
+}
+
+void client_manager_cancel_handoff() {
+    // 清掉移交标记即可：下一轮按背压状态重新决定是否暂停读取
+    for (int i = 0; i < live_count; ++i) client_slots[live_slots[i]].handoff = false;
+}
+
+void client_manager_detach(int socket_fd) {
+    client_manager_remove(socket_fd);
+    io_engine_remove(socket_fd);
+    close(socket_fd);
+    Metrics::add(Metrics::Counter::CLIENT_HANDED_OFF);
+}
+
+bool client_manager_adopt(int socket_fd) {
+    fcntl(socket_fd, F_SETFL, O_NONBLOCK);
+    client_accept(socket_fd);
+    return client_manager_find(socket_fd) != nullptr;
+}
+
+// 连接定时器到期：按最新的收发时间重新计算截止时间，未到则顺延，到了就断开
+static void client_on_timer(TaskManager* task_mgr, uint32_t slot, int64_t now) {
+    ClientInfo& c = client_slots[slot];
+    int64_t due = client_deadline(c, now);
+    if (due < 0) return;
+    if (due > now) {
+        client_timers.schedule(slot, due);
+        return;
+    }
+    Metrics::add(c.write_blocked_ms ? Metrics::Counter::CLIENT_WRITE_TIMEOUT : Metrics::Counter::CLIENT_IDLE_TIMEOUT);
+    client_close(task_mgr, c.socket_fd);
+}
+
+// 记录一次发送结果：有进展时刷新活跃时间，首次受阻时按写截止时间提前定时器
+static void client_note_send(ClientInfo* c, bool progressed, int64_t now) {
+    if (!c) return;
+    if (progressed) {
+        c->last_active_ms = now;
+        c->write_blocked_ms = 0;
+        return;
+    }
+    if (c->write_blocked_ms) return;
+    c->write_blocked_ms = now;
+    int32_t slot = slot_of_fd[c->socket_fd];
+    int64_t due = client_deadline(*c, now);
+    int64_t cur = client_timers.deadline(slot);
+    if (due >= 0 && (cur < 0 || due < cur)) client_timers.schedule(slot, due);
+}
+
+// 回送给客户端的 id：有客户端自带的 id 时回显它，否则在写帧时渲染网关 id，buf 至少 RequestId::TEXT_SIZE 字节
+static const char* client_frame_id(const ClientRequestMapping& req, char* buf) {
+    if (req.client_id[0]) return req.client_id;
+    RequestId::format(req.request_id, buf);
+    return buf;
+}
+
+// 请求未被受理：回一个错误帧，不登记在途流；客户端未带 id 时回送网关 id 的文本
+static void client_reject(int fd, const char* client_id, uint64_t request_id, const char* message) {
+    char buf[RequestId::TEXT_SIZE];
+    const char* id = client_id;
+    if (!client_id[0]) {
+        RequestId::format(request_id, buf);
+        id = buf;
+    }
+    std::string frame = dump_json(create_client_error(id, message));
+    frame.push_back('\n');
+    io_engine_send(fd, frame.data(), frame.size());
+}
+
+static void client_handle_data(TaskManager* task_mgr, int fd, const char* data, int len, int64_t now) {
+    // 直接解析为RequestMessage
+    RequestMessage req_msg;
+    long long parse_start = Metrics::nowNs();
+    bool parsed = parse_request_message(data, (size_t)len, req_msg);
+    Metrics::recordSince(Metrics::Histogram::PARSE, parse_start);
+    Metrics::add(parsed ? Metrics::Counter::REQUEST_PARSED : Metrics::Counter::REQUEST_PARSE_ERROR);
+    if (!parsed) return;
+    // 每个请求都由网关分配 id，客户端自带的 id 只用于回显，不参与内部索引
+    uint64_t request_id = RequestId::next();
+    const std::string& client_id = req_msg.getId();
+    if (client_id.size() >= CLIENT_ID_SIZE) {
+        client_reject(fd, "", request_id, "request id too long");
+        return;
+    }
+    // 路由表按完整模型名匹配，过长的名称直接拒绝，不截断
+    if (req_msg.getModel().size() >= ROUTER_MODEL_NAME_SIZE) {
+        client_reject(fd, client_id.c_str(), request_id, "model name too long");
+        return;
+    }
+    ClientInfo* c = client_manager_find(fd);
+    if (reject_requests) {
+        client_reject(fd, client_id.c_str(), request_id, "server shutting down");
+        return;
+    }
+    if (c && !client_admit(*c, now)) {
+        client_reject(fd, client_id.c_str(), request_id, "rate limit exceeded");
+        Metrics::add(Metrics::Counter::REQUEST_RATE_LIMITED);
+        return;
+    }
+    if (request_count >= request_capacity || !task_mgr) {
+        client_reject(fd, client_id.c_str(), request_id, "server busy");
+        Metrics::add(Metrics::Counter::TASK_FAILED);
+        return;
+    }
+    // 先在映射表的下一个空位记下回显用的 id，请求随后整体交给 TaskManager
+    ClientRequestMapping& req = client_requests[request_count];
+    req.client_socket = fd;
+    req.request_id = request_id;
+    memcpy(req.client_id, client_id.c_str(), client_id.size() + 1);
+    Trace::begin(request_id, parse_start);
+    // 下发队列或流表已满（未启动）时直接回错误，不登记在途流，客户端不会空等
+    if (!task_mgr->pushRequest(fd, request_id, std::move(req_msg))) {
+        Trace::abort(request_id);
+        client_reject(fd, req.client_id, request_id, "server busy");
+        Metrics::add(Metrics::Counter::TASK_FAILED);
+        return;
+    }
+    // 登记 request_id -> 客户端映射，token 到达后按此回送
+    request_count++;
+    req.is_active = true;
+    req.last_progress_ms = now;
+    if (c) c->streams++;
+    Metrics::setGauge(Metrics::Gauge::CLIENT_STREAMS, request_count);
+}
+
+// 事件循环的一轮：等待网络事件（客户端与NPU节点共用一个 I/O 引擎），处理后投递待发送的 token
+void client_manager_run(TaskManager* task_mgr) {
+    static IoEvent events[IO_ENGINE_MAX_EVENTS];
+    // 背压：全局内存超过高水位时暂停读取所有客户端，单客户端积压超过配额时只暂停该客户端
+    bool global_paused = MemBudget::underPressure();
+    bool need_poll = global_paused;
+    size_t client_limit = MemBudget::config().per_client_limit;
+    for (int i = 0; i < live_count; ++i) {
+        ClientInfo& c = client_slots[live_slots[i]];
+        if (c.handoff) continue;  // 等待移交，保持暂停
+        bool pause = global_paused || c.pending_bytes > client_limit;
+        if (pause != c.paused) {
+            io_engine_set_paused(c.socket_fd, pause);
+            c.paused = pause;
         }
-        // 客户端数据
-        for (int i = (int)clients.size()-1; i >= 0; --i) {
-            auto& c = clients[i];
-            if (c.connected && FD_ISSET(c.socket_fd, &readfds)) {
-                ssize_t n = recv(c.socket_fd, buf, MAX_JSON_SIZE, 0);
-                if (n <= 0) {
-                    close(c.socket_fd);
-                    clients.erase(clients.begin() + i);
-                    // 清理对应的请求映射
-                    for (int j = (int)client_requests.size()-1; j >= 0; --j) {
-                        if (client_requests[j].client_socket == c.socket_fd) {
-                            client_requests.erase(client_requests.begin() + j);
-                        }
-                    }
-                    continue;
-                }
-                buf[n] = 0;
-                // 直接解析为RequestMessage
-                RequestMessage req_msg;
-                if (parse_request_message(std::string(buf), req_msg)) {
-                    // 可选：生成/补充request_id等逻辑
-                    if (task_mgr) {
-                        task_mgr->pushRequest(c.socket_fd, req_msg);
-                    }
-                }
+        if (c.pending_bytes > 0) need_poll = true;
+    }
+    // 有暂停的连接或积压未发完时定时醒来检查，否则睡到最近的连接定时器或节点心跳
+    int64_t now = liveness_now_ms();
+    int timeout = need_poll ? 10 : client_timers.nextTimeoutMs(now);
+    int npu_timeout = npu_next_timer_ms(now);
+    if (npu_timeout >= 0 && (timeout < 0 || npu_timeout < timeout)) timeout = npu_timeout;
+    if (max_wait_ms >= 0 && (timeout < 0 || max_wait_ms < timeout)) timeout = max_wait_ms;
+    int n = io_engine_wait(events, IO_ENGINE_MAX_EVENTS, timeout);
+    Clock::tick(); // 每轮刷新一次粗粒度时钟
+    now = liveness_now_ms();
+    for (int i = 0; i < n; ++i) {
+        const IoEvent& ev = events[i];
+        if (ev.type == IoEventType::ACCEPT) {
+            client_accept(ev.fd);
+        } else if (ev.owner == IoOwner::NPU) {
+            if (ev.type == IoEventType::DATA) npu_on_data(ev.fd, ev.buf, ev.data, ev.len);
+            else npu_on_closed(ev.fd);
+        } else if (ev.type == IoEventType::CLOSED) {
+            client_close(task_mgr, ev.fd);
+        } else {
+            ClientInfo* c = client_manager_find(ev.fd);
+            if (c) {
+                c->last_active_ms = now;
+                c->handoff = false;  // 移交前又收到请求：留在本进程处理完，下一轮恢复读取
             }
-        }
-        // 处理待发送的 token - 基于 requestID 的策略
-        if (task_mgr) {
-            client_manager_process_pending_tokens(task_mgr);
+            client_handle_data(task_mgr, ev.fd, ev.data, ev.len, now);
         }
     }
+    // 连接数每轮更新一次，连接风暴时不必每个 accept 都写
+    Metrics::setGauge(Metrics::Gauge::CLIENTS_CONNECTED, live_count);
+    // 处理待发送的 token - 基于 requestID 的策略
+    if (task_mgr) {
+        client_manager_process_pending_tokens(task_mgr);
+    }
+    // 空闲与写停滞的连接在这里断开，释放槽位
+    client_timers.advance(now, [&](uint32_t slot) { client_on_timer(task_mgr, slot, now); });
 }
 
 // 处理所有待发送的 token - 基于 requestID 的批量策略
 void client_manager_process_pending_tokens(TaskManager* task_mgr) {
+    // 每轮重新统计各客户端的积压
+    for (int i = 0; i < live_count; ++i) client_slots[live_slots[i]].pending_bytes = 0;
+    size_t stream_limit = MemBudget::config().per_stream_limit;
+    uint32_t stream_idle_ms = liveness_config().stream_idle_ms;
+    int64_t now = liveness_now_ms();
     // 遍历所有活跃的客户端请求
-    for (auto& req : client_requests) {
+    for (int r = 0; r < request_count; ++r) {
+        ClientRequestMapping& req = client_requests[r];
         if (!req.is_active) continue;
         
-        TokenList* list = task_mgr->getTokenList(req.request_id);
-        if (!list) {
-            // 如果找不到对应的 TokenList，标记为非活跃
-            req.is_active = false;
-            continue;
-        }
-        
-        // 检查是否有新的 token 需要发送
-        if (list->hasMoreTokens()) {
-            // 发送一个 token 给对应的客户端
-            const char* token = list->getNextToken();
-            if (token) {
-                send(req.client_socket, token, strlen(token), 0);
+        // 链表只在锁内访问（节点断开等失败由其他线程写入）；取消与清理须在锁外进行
+        bool cancel = false, clear = false;
+        char id_buf[RequestId::TEXT_SIZE];
+        task_mgr->withTokenList(req.request_id, [&](TokenList* list) {
+            if (!list || (!list->hasMoreTokens() && !list->isFinished())) {
+                // token 尚未到达，等待下一轮；节点长时间不出 token 时判定该流失败
+                if (stream_idle_ms && now - req.last_progress_ms >= stream_idle_ms) {
+                    std::string frame = dump_json(create_client_error(client_frame_id(req, id_buf), "stream timed out"));
+                    frame.push_back('\n');
+                    io_engine_send(req.client_socket, frame.data(), frame.size());
+                    Metrics::add(Metrics::Counter::STREAM_IDLE_TIMEOUT);
+                    Trace::abort(req.request_id);
+                    cancel = true;
+                    req.is_active = false;
+                }
+                return;
             }
-        }
-        
-        // 检查是否完全结束（已发送完所有token且流已结束）
-        if (list->isCompletelyFinished()) {
-            req.is_active = false;
-            // 清理对应的 TokenList
-            task_mgr->clearTokenList(req.request_id);
-        }
+            req.last_progress_ms = now;
+            const char* id = client_frame_id(req, id_buf);
+
+            // 发送所有已到达的 token，每条为一行 JSON 流式响应；客户端接收窗口满时留待下一轮
+            ClientInfo* c = client_manager_find(req.client_socket);
+            const char* token;
+            long long arrive_ns = 0;
+            bool sent = false, blocked = false;
+            while ((token = list->peekNextToken()) != nullptr) {
+                std::string frame = dump_json(create_stream_response(id, req.client_socket, token, false));
+                frame.push_back('\n');
+                if (!io_engine_send(req.client_socket, frame.data(), frame.size())) {
+                    blocked = true;
+                    break;
+                }
+                sent = true;
+                list->getNextToken(&arrive_ns);
+                Metrics::recordSince(Metrics::Histogram::TOKEN_DELIVERY, arrive_ns);
+                Metrics::add(Metrics::Counter::TOKENS_DELIVERED);
+            }
+            if (sent || blocked) client_note_send(c, sent, now);
+
+            size_t pending = list->getPendingBytes();
+            if (pending > stream_limit) {
+                // 慢客户端：单流积压超过配额，取消该流以保护全局预算
+                std::string frame = dump_json(create_client_error(id, "stream backlog over quota"));
+                frame.push_back('\n');
+                io_engine_send(req.client_socket, frame.data(), frame.size());
+                Metrics::add(Metrics::Counter::STREAMS_OVER_QUOTA);
+                Trace::abort(req.request_id);
+                cancel = true;
+                req.is_active = false;
+                return;
+            }
+            if (pending > 0 && c) c->pending_bytes += pending;
+
+            // 检查是否完全结束（已发送完所有token且流已结束）；失败的流以错误帧结束
+            if (list->isCompletelyFinished()) {
+                bool failed = list->isFailed();
+                std::string frame = dump_json(failed ? create_client_error(id, list->getError())
+                                                     : create_response(id, "", true));
+                frame.push_back('\n');
+                if (!io_engine_send(req.client_socket, frame.data(), frame.size())) return;
+                if (failed) {
+                    Metrics::add(Metrics::Counter::TASK_FAILED);
+                    Trace::abort(req.request_id);
+                } else {
+                    Trace::mark(req.request_id, Trace::Stage::FLUSH);
+                }
+                req.is_active = false;
+                clear = true;
+            }
+        });
+        if (cancel) task_mgr->cancelStream(req.request_id);
+        // 清理对应的 TokenList
+        if (clear) task_mgr->clearTokenList(req.request_id);
     }
     
     // 清理已完成的请求映射
-    for (int i = (int)client_requests.size()-1; i >= 0; --i) {
-        if (!client_requests[i].is_active) {
-            client_requests.erase(client_requests.begin() + i);
-        }
-    }
+    client_requests_compact();
 }
@@ -1,42 +1,96 @@
 #pragma once
-#include <etl/vector.h>
 #include <string>
-#include <netinet/in.h>
+#include <cstddef>
+#include <cstdint>
 
-#define MAX_CLIENTS 512
+#define MAX_CLIENTS 512            // 默认连接容量，实际容量由 client_manager_init 的参数决定
+#define CLIENT_LISTEN_BACKLOG 1024  // 监听积压队列长度
 #define MAX_JSON_SIZE 2048
+#define CLIENT_ID_SIZE 64          // 客户端自带 id 的最大长度（含结尾 0），超长的请求直接回错误
 
 struct ClientInfo {
     int socket_fd;
-    sockaddr_in addr;
     bool connected;
+    size_t pending_bytes;  // 已到达但尚未发给该客户端的 token 字节数，超出配额时暂停读取
+    bool paused;           // 已因背压暂停读取
+    int live_index;        // 在已占用槽列表中的位置
+    int streams;           // 在途请求数（等待 token 下发）
+    int64_t last_active_ms;    // 最近一次收到请求或发出数据（单调时钟）
+    int64_t write_blocked_ms;  // 发送开始受阻的时间，发送有进展时清零
+    float rate_tokens;         // 限速令牌桶余量（见 ClientLimits）
+    int64_t rate_refill_ms;    // 令牌桶上次补充的时间
+    bool handoff;              // 热重启：已暂停读取，等待移交给新进程
+};
+
+// 单客户端请求限制：令牌桶限速（requests_per_sec 为补充速率，burst 为桶容量，0 取速率值）
+// 与在途流上限；为 0 表示不限制。超限的请求直接回错误，不进入任务队列
+struct ClientLimits {
+    uint32_t requests_per_sec;
+    uint32_t burst;
+    int max_streams;
 };
 
 // 客户端请求映射结构
 struct ClientRequestMapping {
     int client_socket;
-    etl::string<64> request_id;
+    uint64_t request_id;             // 网关分配的 id，TaskManager 与节点都按它索引
+    char client_id[CLIENT_ID_SIZE];  // 客户端自带的 id，回送时原样回显；为空时回送 request_id 的文本
     bool is_active;
+    int64_t last_progress_ms;  // 登记或最近一次有 token 到达的时间，超过 stream_idle_ms 判定失败
 };
 
-using ClientList = etl::vector<ClientInfo, MAX_CLIENTS>;
-using ClientRequestList = etl::vector<ClientRequestMapping, MAX_CLIENTS>;
-
 class TaskManager; // 前向声明
 
-// 初始化客户端管理
-void client_manager_init(int listen_port);
-// 添加客户端
-bool client_manager_add(int socket_fd, const sockaddr_in& addr);
-// 移除客户端
+// 初始化客户端管理：按 max_clients 一次性分配连接槽表与请求映射表（总字节数见 client_manager_table_bytes），
+// 并覆盖 I/O 引擎 fd 表的全部 fd，因此需在 io_engine_init 之后调用
+// inherited_listen_fd >= 0 时直接使用继承的监听 socket（热重启），不再 bind/listen
+bool client_manager_init(int listen_port, int max_clients = MAX_CLIENTS, int inherited_listen_fd = -1);
+// 添加客户端：从预分配的连接槽表中取一个槽，槽满或 fd 超出范围时返回 false
+bool client_manager_add(int socket_fd);
+// 移除客户端，归还槽位（不关闭 fd）
 void client_manager_remove(int socket_fd);
-// 查找客户端
+// 查找客户端：按 fd 直接索引，O(1)
 ClientInfo* client_manager_find(int socket_fd);
-// 获取客户端列表
-ClientList* client_manager_get_list();
+// 当前连接数，及按 0..count-1 遍历已占用的槽
+int client_manager_count();
+ClientInfo* client_manager_at(int index);
+// 连接容量与连接表占用的字节数（启动后不变，可在任意线程读取）
+int client_manager_capacity();
+size_t client_manager_table_bytes();
+// 请求限制，运行中可随时调整（仅在反应器线程调用），对已有连接下一个请求起生效
+void client_manager_set_limits(const ClientLimits& limits);
+const ClientLimits& client_manager_limits();
+// 存活配置变更后调用：重新设置监听 socket 的保活选项（只影响之后 accept 的连接），
+// 并按新的超时重排已有连接的定时器
+void client_manager_reconfigure();
+// ---- 排空与热重启 ----
+// 停止 accept 并关闭监听 socket，已有连接不受影响
+void client_manager_stop_accepting();
+// 暂停/恢复 accept，监听 socket 保持打开：热重启移交期间由新进程 accept，移交失败时本进程恢复
+void client_manager_pause_accepting(bool paused);
+int client_manager_listen_fd();
+// 排空期间拒绝已有连接上的新请求（回错误帧），在途流照常投递
+void client_manager_set_reject_requests(bool reject);
+// 限制事件循环单轮的最长等待，排空/移交期间保证主循环按时检查进度；-1 为不限制
+void client_manager_set_max_wait(int ms);
+// 关闭没有在途流、没有积压的连接，返回剩余连接数
+int client_manager_close_idle();
+// 热重启：空闲连接先暂停读取，待引擎中不再有该连接的操作后放入 fds（最多 max 个）供移交；
+// 暂停期间收到数据的连接恢复正常服务，空闲后再重新标记
+int client_manager_take_idle(int* fds, int max);
+// 放弃移交（新进程失败）：等待移交的连接恢复正常服务
+void client_manager_cancel_handoff();
+// 已移交的连接：从连接表和引擎注销并关闭本进程的 fd
+void client_manager_detach(int socket_fd);
+// 接管旧进程移交的连接（等同于一次 accept）
+bool client_manager_adopt(int socket_fd);
+// 在途请求数
+int client_manager_stream_count();
 // 关闭所有客户端和监听socket
 void client_manager_close_all();
-// 事件循环，接收数据并推送到任务管理器
+// 事件循环的一轮：接收客户端与NPU数据并推送到任务管理器，再投递待发送的 token，
+// 最后推进连接定时器回收空闲/写停滞的连接（见 conn_liveness.h）
+// 需先调用 io_engine_init；无事件时阻塞到最近的定时器，被信号打断时返回，由调用方循环调用
 void client_manager_run(TaskManager* task_mgr);
 // 处理所有待发送的 token - 基于 requestID 的批量策略
 void client_manager_process_pending_tokens(TaskManager* task_mgr);
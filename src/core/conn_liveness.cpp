@@ -0,0 +1,39 @@
+#include "conn_liveness.h"
+#include "utils/clock.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+static LivenessConfig g_liveness = {300000, 30000, 10000, 90000, 120000, true, 60, 10, 3, 30000};
+
+void liveness_configure(const LivenessConfig& cfg) {
+    g_liveness = cfg;
+}
+
+const LivenessConfig& liveness_config() {
+    return g_liveness;
+}
+
+bool liveness_apply_socket(int fd) {
+    const LivenessConfig& c = g_liveness;
+    bool ok = true;
+    int on = c.tcp_keepalive ? 1 : 0;
+    ok &= setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) == 0;
+    if (c.tcp_keepalive) {
+        if (c.keepalive_idle_s > 0)
+            ok &= setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &c.keepalive_idle_s, sizeof(int)) == 0;
+        if (c.keepalive_interval_s > 0)
+            ok &= setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &c.keepalive_interval_s, sizeof(int)) == 0;
+        if (c.keepalive_count > 0)
+            ok &= setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &c.keepalive_count, sizeof(int)) == 0;
+    }
+#ifdef TCP_USER_TIMEOUT
+    unsigned int user_timeout = c.tcp_user_timeout_ms;
+    ok &= setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &user_timeout, sizeof(user_timeout)) == 0;
+#endif
+    return ok;
+}
+
+int64_t liveness_now_ms() {
+    return Clock::nowNs() / 1000000;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+
+// 连接存活检测配置：客户端空闲/读写截止时间、NPU 心跳与 TCP 层保活
+// 客户端与 NPU 节点共用，启动时由 main 设置一次；时间为 0 表示关闭对应检测
+struct LivenessConfig {
+    uint32_t client_idle_ms;        // 客户端既无请求也无在途流的最长空闲时间
+    uint32_t client_write_ms;       // 有待发送 token 时，最长多久没有任何发送进展
+    uint32_t npu_heartbeat_ms;      // 发往节点的链路空闲这么久后补发一次心跳
+    uint32_t npu_dead_ms;           // 节点多久没有任何消息（含心跳）判定失联
+    uint32_t stream_idle_ms;        // 在途流多久没有任何 token 到达即判定失败（节点在线但不再出 token）
+    bool tcp_keepalive;
+    int keepalive_idle_s;           // TCP_KEEPIDLE
+    int keepalive_interval_s;       // TCP_KEEPINTVL
+    int keepalive_count;            // TCP_KEEPCNT
+    uint32_t tcp_user_timeout_ms;   // TCP_USER_TIMEOUT：已发数据多久未被确认即断开，0 为内核默认
+};
+
+// 默认：客户端空闲 5 分钟、写停滞 30 秒；节点 10 秒心跳、90 秒失联（示例节点每 30 秒发一次心跳）；在途流 2 分钟无 token；
+// 保活 60 秒空闲后每 10 秒探测一次，3 次无响应断开；未确认数据 30 秒断开
+void liveness_configure(const LivenessConfig& cfg);
+const LivenessConfig& liveness_config();
+
+// 设置 TCP 保活与 TCP_USER_TIMEOUT。设在监听 socket 上时，accept 出的连接在内核中直接继承，
+// 不必为每个连接再发系统调用
+bool liveness_apply_socket(int fd);
+
+// 单调时钟毫秒，用于各连接的截止时间
+int64_t liveness_now_ms();
@@ -0,0 +1,163 @@
+#include "dispatch_pool.h"
+#include "utils/metrics.h"
+#include "utils/thread_topology.h"
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+DispatchPool::DispatchPool(size_t capacity)
+    : capacity_(capacity), running_(false), queued_(0), ready_(0), idle_(0) {
+    for (auto& s : strands_) s.scheduled = false;
+}
+
+DispatchPool::~DispatchPool() { stop(); }
+
+bool DispatchPool::start(int workers, Handler handler) {
+    if (running_.load() || workers < 1 || workers > MAX_WORKERS) return false;
+    handler_ = std::move(handler);
+    running_.store(true);
+    for (int i = 0; i < workers; ++i) {
+        void* mem = nullptr;
+        if (posix_memalign(&mem, 64, sizeof(Worker)) != 0) break;
+        Worker* w = new (mem) Worker();
+        w->head = 0;
+        w->count = 0;
+        workers_.push_back(w);
+    }
+    if (workers_.empty()) {
+        running_.store(false);
+        return false;
+    }
+    // 线程在全部本地队列建好之后再启动，窃取时可以安全遍历 workers_
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread = std::thread(&DispatchPool::workerLoop, this, (int)i);
+    }
+    return true;
+}
+
+void DispatchPool::stop() {
+    if (!running_.exchange(false)) return;
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex_);
+    }
+    idle_cv_.notify_all();
+    // 全部线程退出后再释放本地队列，其他线程可能仍在窃取
+    for (Worker* w : workers_) {
+        if (w->thread.joinable()) w->thread.join();
+    }
+    for (Worker* w : workers_) {
+        w->~Worker();
+        free(w);
+    }
+    workers_.clear();
+    for (auto& s : strands_) {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.tasks.clear();
+        s.scheduled = false;
+    }
+    queued_.store(0);
+    ready_.store(0);
+}
+
+bool DispatchPool::submit(int key, Task&& task) {
+    if (!running_.load(std::memory_order_relaxed)) return false;
+    if (queued_.fetch_add(1) >= capacity_) {
+        queued_.fetch_sub(1);
+        return false;
+    }
+    unsigned k = (unsigned)key;
+    Strand& s = strands_[k % STRANDS];
+    bool need_schedule;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.tasks.push_back(std::move(task));
+        need_schedule = !s.scheduled;
+        s.scheduled = true;
+    }
+    if (need_schedule) schedule((int)(k % workers_.size()), (int)(k % STRANDS));
+    return true;
+}
+
+void DispatchPool::schedule(int worker, int strand) {
+    Worker* w = workers_[worker];
+    {
+        std::lock_guard<std::mutex> lock(w->mutex);
+        w->ring[(w->head + w->count) % STRANDS] = strand;
+        w->count++;
+    }
+    // ready_ 与 idle_ 的先增后读保证：要么休眠线程看到 ready_ > 0，要么这里看到 idle_ > 0 并唤醒
+    ready_.fetch_add(1);
+    if (idle_.load() > 0) {
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex_);
+        }
+        idle_cv_.notify_one();
+    }
+}
+
+int DispatchPool::popLocal(int worker) {
+    Worker* w = workers_[worker];
+    std::lock_guard<std::mutex> lock(w->mutex);
+    if (w->count == 0) return -1;
+    int strand = w->ring[w->head];
+    w->head = (w->head + 1) % STRANDS;
+    w->count--;
+    return strand;
+}
+
+// 从其他线程本地队列的尾部窃取（最近挂上的串行队列，在归属线程缓存中最冷）
+int DispatchPool::steal(int worker) {
+    int n = (int)workers_.size();
+    for (int i = 1; i < n; ++i) {
+        Worker* v = workers_[(worker + i) % n];
+        std::lock_guard<std::mutex> lock(v->mutex);
+        if (v->count == 0) continue;
+        v->count--;
+        Metrics::add(Metrics::Counter::TASK_STOLEN);
+        return v->ring[(v->head + v->count) % STRANDS];
+    }
+    return -1;
+}
+
+void DispatchPool::runStrand(int worker, int strand) {
+    ready_.fetch_sub(1);
+    Strand& s = strands_[strand];
+    for (int i = 0; i < STRAND_BATCH; ++i) {
+        std::unique_lock<std::mutex> lock(s.mutex);
+        if (s.tasks.empty()) {
+            s.scheduled = false;
+            return;
+        }
+        Task task = std::move(s.tasks.front());
+        s.tasks.pop_front();
+        lock.unlock();
+        queued_.fetch_sub(1);
+        handler_(task);
+    }
+    bool more;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        more = !s.tasks.empty();
+        if (!more) s.scheduled = false;
+    }
+    if (more) schedule(worker, strand);
+}
+
+void DispatchPool::workerLoop(int index) {
+    // 多个下发线程按序号各占 task_dispatch 核心集合中的一个核心
+    ThreadTopology::apply(ThreadTopology::Role::TASK_DISPATCH, workers_.size() > 1 ? index : -1);
+    while (running_.load(std::memory_order_relaxed)) {
+        int strand = popLocal(index);
+        if (strand < 0) strand = steal(index);
+        if (strand >= 0) {
+            runStrand(index, strand);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(idle_mutex_);
+        idle_.fetch_add(1);
+        // 超时兜底，与原 taskLoop 的 10ms 轮询间隔一致
+        idle_cv_.wait_for(lock, std::chrono::milliseconds(10),
+                          [this]() { return ready_.load() > 0 || !running_.load(); });
+        idle_.fetch_sub(1);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "message_handler.h"
+
+// 下发任务：反应器提交请求，下发线程取出后发往节点（TaskManager 的响应队列沿用同一结构）
+struct Task {
+    int client_socket;
+    uint64_t request_id;  // 网关分配的 64 位 id，客户端自带的 id 只留在 request_data 中用于回显
+    long long enqueue_ns; // 进入下发池的时间，下发线程取出时计入 QUEUE_WAIT
+    RequestMessage request_data;
+    ResponseMessage response_data;
+    bool success;
+    std::string error_msg;
+};
+
+// 任务下发工作池 - 取代单个 taskLoop 线程
+// 请求按客户端 fd 散列到串行队列（strand），同一串行队列同一时刻只由一个工作线程执行，
+// 因此同一客户端的请求严格按提交顺序处理；不同客户端可在多个核心上并行。
+// 有任务的串行队列挂在工作线程的本地双端队列上：提交时放到客户端的"归属"线程（缓存局部性），
+// 本地线程从头部取，空闲线程从其他线程的尾部窃取。
+class DispatchPool {
+public:
+    static constexpr int MAX_WORKERS = 16;
+    static constexpr int STRANDS = 256;      // 串行队列数，散列冲突只会让两个客户端共享顺序
+    static constexpr int STRAND_BATCH = 8;   // 取得一个串行队列后连续处理的任务数，之后放回队尾让其他客户端轮到
+
+    using Handler = std::function<void(Task&)>;
+
+    explicit DispatchPool(size_t capacity);
+    ~DispatchPool();
+
+    DispatchPool(const DispatchPool&) = delete;
+    DispatchPool& operator=(const DispatchPool&) = delete;
+
+    // 启动 workers 个工作线程（1 ~ MAX_WORKERS），handler 在工作线程上执行
+    bool start(int workers, Handler handler);
+    // 停止并等待工作线程退出，尚未执行的任务丢弃
+    void stop();
+    bool isRunning() const { return running_.load(std::memory_order_relaxed); }
+
+    // 提交任务，key 相同的任务按提交顺序执行；未启动或排队任务达到容量时返回 false。
+    // 可在任意线程调用（下发线程会重新提交接替失败请求的 follower），但不得与 start/stop 并发
+    bool submit(int key, Task&& task);
+
+    size_t queued() const { return queued_.load(std::memory_order_relaxed); }
+    size_t capacity() const { return capacity_; }
+    int workerCount() const { return (int)workers_.size(); }
+
+private:
+    struct Strand {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        bool scheduled;  // 已挂在某个工作线程的本地队列上或正在执行
+    };
+
+    // 工作线程的本地队列：环形缓冲存串行队列下标，一个串行队列同一时刻只在一处，容量 STRANDS 足够
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        int ring[STRANDS];
+        int head;
+        int count;
+        std::thread thread;
+    };
+
+    void workerLoop(int index);
+    void schedule(int worker, int strand);
+    int popLocal(int worker);
+    int steal(int worker);
+    // 执行一个串行队列的一批任务；还有剩余时放回本地队列尾部
+    void runStrand(int worker, int strand);
+
+    size_t capacity_;
+    Handler handler_;
+    std::atomic<bool> running_;
+    std::atomic<size_t> queued_;  // 排队中的任务数
+    std::atomic<int> ready_;      // 挂在本地队列上的串行队列数
+    std::atomic<int> idle_;       // 休眠中的工作线程数
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cv_;
+    Strand strands_[STRANDS];
+    std::vector<Worker*> workers_;
+};
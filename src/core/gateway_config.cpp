@@ -0,0 +1,273 @@
+#include "gateway_config.h"
+#include "admin_server.h"
+#include "task_manager.h"
+#include <nlohmann/json.hpp>
+#include <arpa/inet.h>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+using nlohmann::json;
+
+void gateway_config_defaults(GatewayConfig& cfg) {
+    cfg.listen_port = 9000;
+    cfg.max_clients = MAX_CLIENTS;
+    cfg.io_backend = IoBackend::AUTO;
+    cfg.admin_port = ADMIN_DEFAULT_PORT;
+    cfg.admin_sock.clear();
+    cfg.prealloc = false;
+    cfg.prealloc_cfg = {65536, 4096, TaskCache::DEFAULT_MAX_TASKS, BUFPOOL_DEFAULT_COUNT, true, true};
+    cfg.task_cache_slots = TaskCache::DEFAULT_MAX_TASKS;
+    for (auto& t : cfg.threads) {
+        ThreadTopology::parseCpus("", t);  // 不绑定
+        t.policy = ThreadTopology::Policy::DEFAULT;
+        t.priority = 0;
+    }
+    cfg.dispatch_workers = TaskManager::DEFAULT_DISPATCH_WORKERS;
+    cfg.npu_nodes.clear();
+    // 全局 64MB，单客户端积压 1MB，单流积压 256KB，90% 开始背压、75% 解除
+    cfg.mem = {64 * 1024 * 1024, 1024 * 1024, 256 * 1024, 90, 75};
+    // 客户端空闲 5 分钟、写停滞 30 秒；节点 10 秒心跳、90 秒失联；TCP 保活 60/10/3，未确认数据 30 秒
+    cfg.liveness = {300000, 30000, 10000, 90000, 120000, true, 60, 10, 3, 30000};
+    cfg.limits = {0, 0, 0};
+    cfg.coalesce_requests = true;
+    cfg.trace_sample_rate = 0.0;
+    cfg.trace_file = "gateway_trace.json";
+    cfg.drain_timeout_ms = 30000;
+}
+
+// 读取一个数值项：不存在时保持原值，类型不对或越界时报错
+template <class T>
+static bool read_num(const json& obj, const char* section, const char* key, double lo, double hi, T& out, std::string& err) {
+    if (!obj.contains(key)) return true;
+    const json& v = obj[key];
+    if (!v.is_number() || v.get<double>() < lo || v.get<double>() > hi) {
+        err = std::string(section) + "." + key + ": expected number in [" + std::to_string((long long)lo) + ", " +
+              std::to_string((long long)hi) + "]";
+        return false;
+    }
+    out = v.get<T>();
+    return true;
+}
+
+static bool read_bool(const json& obj, const char* section, const char* key, bool& out, std::string& err) {
+    if (!obj.contains(key)) return true;
+    if (!obj[key].is_boolean()) {
+        err = std::string(section) + "." + key + ": expected boolean";
+        return false;
+    }
+    out = obj[key].get<bool>();
+    return true;
+}
+
+static bool read_string(const json& obj, const char* section, const char* key, std::string& out, std::string& err) {
+    if (!obj.contains(key)) return true;
+    if (!obj[key].is_string()) {
+        err = std::string(section) + "." + key + ": expected string";
+        return false;
+    }
+    out = obj[key].get<std::string>();
+    return true;
+}
+
+// 取一个对象分节，不存在时返回空对象
+static const json& section_of(const json& root, const char* name, bool& ok, std::string& err) {
+    static const json empty = json::object();
+    if (!root.contains(name)) return empty;
+    if (!root[name].is_object()) {
+        err = std::string(name) + ": expected object";
+        ok = false;
+        return empty;
+    }
+    return root[name];
+}
+
+static bool parse_listen(const json& root, GatewayConfig& cfg, std::string& err) {
+    bool ok = true;
+    const json& s = section_of(root, "listen", ok, err);
+    std::string backend;
+    ok = ok && read_num(s, "listen", "port", 1, 65535, cfg.listen_port, err) &&
+         read_num(s, "listen", "max_clients", 64, 1 << 24, cfg.max_clients, err) &&
+         read_string(s, "listen", "io_backend", backend, err);
+    if (!ok) return false;
+    if (backend.empty() || backend == "auto") cfg.io_backend = IoBackend::AUTO;
+    else if (backend == "epoll") cfg.io_backend = IoBackend::EPOLL;
+    else if (backend == "io_uring") cfg.io_backend = IoBackend::URING;
+    else {
+        err = "listen.io_backend: expected auto, epoll or io_uring";
+        return false;
+    }
+    const json& a = section_of(root, "admin", ok, err);
+    return ok && read_num(a, "admin", "port", 0, 65535, cfg.admin_port, err) &&
+           read_string(a, "admin", "unix_socket", cfg.admin_sock, err);
+}
+
+static bool parse_pools(const json& root, GatewayConfig& cfg, std::string& err) {
+    bool ok = true;
+    const json& s = section_of(root, "pools", ok, err);
+    Prealloc::Config& p = cfg.prealloc_cfg;
+    return ok && read_bool(s, "pools", "prealloc", cfg.prealloc, err) &&
+           read_num(s, "pools", "token_slots", 1, 1 << 26, p.token_slots, err) &&
+           read_num(s, "pools", "token_text_slots", 1, 1 << 24, p.token_text_slots, err) &&
+           read_num(s, "pools", "task_slots", 1, 1 << 24, p.task_slots, err) &&
+           read_num(s, "pools", "recv_bufs", IO_ENGINE_RECV_BUFS + 1, 1 << 20, p.recv_bufs, err) &&
+           read_bool(s, "pools", "huge_pages", p.huge_pages, err) &&
+           read_bool(s, "pools", "lock_memory", p.lock_memory, err) &&
+           read_num(s, "pools", "task_cache", 1, 1 << 24, cfg.task_cache_slots, err);
+}
+
+static bool parse_nodes(const json& root, GatewayConfig& cfg, std::string& err) {
+    if (!root.contains("npu_nodes")) return true;
+    const json& list = root["npu_nodes"];
+    if (!list.is_array() || list.size() > MAX_NPU_NODES) {
+        err = "npu_nodes: expected array of at most " + std::to_string(MAX_NPU_NODES) + " nodes";
+        return false;
+    }
+    for (const json& n : list) {
+        NPUNodeAddr addr{};
+        std::string host;
+        in_addr tmp;
+        if (!n.is_object() || !read_string(n, "npu_nodes", "host", host, err) ||
+            !read_num(n, "npu_nodes", "port", 1, 65535, addr.port, err)) {
+            if (err.empty()) err = "npu_nodes: expected {\"host\": ..., \"port\": ...}";
+            return false;
+        }
+        if (addr.port == 0 || inet_pton(AF_INET, host.c_str(), &tmp) <= 0) {
+            err = "npu_nodes: invalid address " + host + ":" + std::to_string(addr.port);
+            return false;
+        }
+        strncpy(addr.ip, host.c_str(), sizeof(addr.ip) - 1);
+        cfg.npu_nodes.push_back(addr);
+    }
+    return true;
+}
+
+// "threads": {"reactor": {"cpus": "big", "policy": "fifo", "priority": 50}, "logger": {"cpus": "little"}, ...}
+static bool parse_threads(const json& root, GatewayConfig& cfg, std::string& err) {
+    bool ok = true;
+    const json& s = section_of(root, "threads", ok, err);
+    if (!ok) return false;
+    static const char* keys[ThreadTopology::NUM_ROLES] = {"reactor", "task_dispatch", "task_response", "admin", "logger"};
+    for (int i = 0; i < ThreadTopology::NUM_ROLES; ++i) {
+        const json& t = section_of(s, keys[i], ok, err);
+        std::string cpus, policy;
+        ThreadTopology::Placement& p = cfg.threads[i];
+        if (!ok || !read_string(t, keys[i], "cpus", cpus, err) || !read_string(t, keys[i], "policy", policy, err) ||
+            !read_num(t, keys[i], "priority", -20, 99, p.priority, err)) {
+            err = "threads." + err;
+            return false;
+        }
+        if (i == static_cast<int>(ThreadTopology::Role::TASK_DISPATCH) &&
+            !read_num(t, "threads.task_dispatch", "workers", 1, DispatchPool::MAX_WORKERS, cfg.dispatch_workers, err)) {
+            return false;
+        }
+        if (!ThreadTopology::parseCpus(cpus.c_str(), p)) {
+            err = std::string("threads.") + keys[i] + ".cpus: expected \"0-3,6\", big, little or all (within the process CPU set)";
+            return false;
+        }
+        if (!ThreadTopology::parsePolicy(policy.c_str(), p.policy)) {
+            err = std::string("threads.") + keys[i] + ".policy: expected default, fifo or rr";
+            return false;
+        }
+        if (p.policy != ThreadTopology::Policy::DEFAULT && p.priority < 1) {
+            err = std::string("threads.") + keys[i] + ".priority: fifo/rr need a priority in [1, 99]";
+            return false;
+        }
+        if (p.policy == ThreadTopology::Policy::DEFAULT && p.priority > 19) {
+            err = std::string("threads.") + keys[i] + ".priority: nice value must be in [-20, 19]";
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool parse_runtime(const json& root, GatewayConfig& cfg, std::string& err) {
+    bool ok = true;
+    const json& m = section_of(root, "memory", ok, err);
+    size_t global_mb = cfg.mem.global_limit >> 20;
+    size_t client_kb = cfg.mem.per_client_limit >> 10;
+    size_t stream_kb = cfg.mem.per_stream_limit >> 10;
+    ok = ok && read_num(m, "memory", "global_limit_mb", 1, 1 << 20, global_mb, err) &&
+         read_num(m, "memory", "per_client_limit_kb", 1, 1 << 30, client_kb, err) &&
+         read_num(m, "memory", "per_stream_limit_kb", 1, 1 << 30, stream_kb, err) &&
+         read_num(m, "memory", "high_watermark_pct", 1, 100, cfg.mem.high_watermark_pct, err) &&
+         read_num(m, "memory", "low_watermark_pct", 0, 100, cfg.mem.low_watermark_pct, err);
+    if (!ok) return false;
+    cfg.mem.global_limit = global_mb << 20;
+    cfg.mem.per_client_limit = client_kb << 10;
+    cfg.mem.per_stream_limit = stream_kb << 10;
+
+    const json& t = section_of(root, "timeouts", ok, err);
+    LivenessConfig& l = cfg.liveness;
+    ok = ok && read_num(t, "timeouts", "client_idle_ms", 0, 1e9, l.client_idle_ms, err) &&
+         read_num(t, "timeouts", "client_write_ms", 0, 1e9, l.client_write_ms, err) &&
+         read_num(t, "timeouts", "npu_heartbeat_ms", 0, 1e9, l.npu_heartbeat_ms, err) &&
+         read_num(t, "timeouts", "npu_dead_ms", 0, 1e9, l.npu_dead_ms, err) &&
+         read_num(t, "timeouts", "stream_idle_ms", 0, 1e9, l.stream_idle_ms, err) &&
+         read_bool(t, "timeouts", "tcp_keepalive", l.tcp_keepalive, err) &&
+         read_num(t, "timeouts", "keepalive_idle_s", 0, 32767, l.keepalive_idle_s, err) &&
+         read_num(t, "timeouts", "keepalive_interval_s", 0, 32767, l.keepalive_interval_s, err) &&
+         read_num(t, "timeouts", "keepalive_count", 0, 127, l.keepalive_count, err) &&
+         read_num(t, "timeouts", "tcp_user_timeout_ms", 0, 1e9, l.tcp_user_timeout_ms, err);
+    if (!ok) return false;
+
+    const json& r = section_of(root, "rate_limits", ok, err);
+    ok = ok && read_num(r, "rate_limits", "requests_per_sec", 0, 1e6, cfg.limits.requests_per_sec, err) &&
+         read_num(r, "rate_limits", "burst", 0, 1e6, cfg.limits.burst, err) &&
+         read_num(r, "rate_limits", "max_streams_per_client", 0, 1e6, cfg.limits.max_streams, err);
+    if (!ok) return false;
+
+    const json& b = section_of(root, "batching", ok, err);
+    const json& tr = section_of(root, "trace", ok, err);
+    const json& sd = section_of(root, "shutdown", ok, err);
+    return ok && read_bool(b, "batching", "coalesce_requests", cfg.coalesce_requests, err) &&
+           read_num(tr, "trace", "sample_rate", 0, 1, cfg.trace_sample_rate, err) &&
+           read_string(tr, "trace", "file", cfg.trace_file, err) &&
+           read_num(sd, "shutdown", "drain_timeout_ms", 0, 3600000, cfg.drain_timeout_ms, err);
+}
+
+bool gateway_config_load(const char* path, GatewayConfig& cfg, std::string& err) {
+    gateway_config_defaults(cfg);
+    err.clear();
+    std::ifstream in(path);
+    if (!in) {
+        err = std::string("cannot open ") + path;
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string text = ss.str();
+    // 不抛异常的解析，-fno-exceptions 的嵌入式构建同样可用
+    json root = json::parse(text.begin(), text.end(), nullptr, false);
+    if (root.is_discarded() || !root.is_object()) {
+        err = "invalid JSON";
+        return false;
+    }
+    return parse_listen(root, cfg, err) && parse_pools(root, cfg, err) && parse_nodes(root, cfg, err) &&
+           parse_threads(root, cfg, err) && parse_runtime(root, cfg, err);
+}
+
+std::string gateway_config_restart_diff(const GatewayConfig& running, const GatewayConfig& loaded) {
+    std::string out;
+    auto note = [&out](bool changed, const char* name) {
+        if (!changed) return;
+        if (!out.empty()) out += ", ";
+        out += name;
+    };
+    const Prealloc::Config& a = running.prealloc_cfg;
+    const Prealloc::Config& b = loaded.prealloc_cfg;
+    note(running.listen_port != loaded.listen_port, "listen.port");
+    note(running.max_clients != loaded.max_clients, "listen.max_clients");
+    note(running.io_backend != loaded.io_backend, "listen.io_backend");
+    note(running.admin_port != loaded.admin_port || running.admin_sock != loaded.admin_sock, "admin");
+    note(running.prealloc != loaded.prealloc || a.token_slots != b.token_slots || a.task_slots != b.task_slots ||
+         a.token_text_slots != b.token_text_slots ||
+         a.recv_bufs != b.recv_bufs || a.huge_pages != b.huge_pages || a.lock_memory != b.lock_memory ||
+         running.task_cache_slots != loaded.task_cache_slots, "pools");
+    bool threads_changed = running.dispatch_workers != loaded.dispatch_workers;
+    for (int i = 0; i < ThreadTopology::NUM_ROLES; ++i) {
+        threads_changed |= !ThreadTopology::samePlacement(running.threads[i], loaded.threads[i]);
+    }
+    note(threads_changed, "threads");
+    return out;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "client_manager.h"
+#include "npu_node_manager.h"
+#include "io_engine.h"
+#include "conn_liveness.h"
+#include "utils/mem_budget.h"
+#include "utils/prealloc.h"
+#include "utils/thread_topology.h"
+
+// 网关运行配置：启动时从 JSON 文件加载，收到 SIGHUP 时重新加载。
+// 文件中缺省的项取默认值（与原先写在 main 中的常量一致），未指定文件时全部取默认值。
+// 热加载只应用可在运行中调整的项（节点列表、超时、限速、内存配额、合并开关、采样率、排空期限），
+// 监听端口、连接容量、I/O 后端、管理端点、预分配池大小与线程绑定需要重启才生效
+struct GatewayConfig {
+    // 监听
+    int listen_port;
+    int max_clients;
+    IoBackend io_backend;
+    int admin_port;              // <= 0 不监听 TCP
+    std::string admin_sock;      // 为空不监听 UNIX socket
+
+    // 预分配池（开发板部署）
+    bool prealloc;
+    Prealloc::Config prealloc_cfg;
+    size_t task_cache_slots;     // TaskManager 任务缓存容量
+
+    // 线程绑定：按角色（ThreadTopology::Role）下标，未配置的角色不绑定
+    ThreadTopology::Placement threads[ThreadTopology::NUM_ROLES];
+    int dispatch_workers;        // TaskManager 下发工作池线程数
+
+    // 可热加载
+    std::vector<NPUNodeAddr> npu_nodes;
+    MemBudget::Config mem;
+    LivenessConfig liveness;
+    ClientLimits limits;
+    bool coalesce_requests;      // 相同 model/prompt 的在途请求合并生成
+    double trace_sample_rate;
+    std::string trace_file;
+    int drain_timeout_ms;        // 停止或热重启时等待在途流结束的最长时间
+};
+
+// 填入默认值
+void gateway_config_defaults(GatewayConfig& cfg);
+// 从文件加载：先填默认值再覆盖文件中出现的项。文件不存在、JSON 无效或取值越界时返回 false，
+// err 给出原因，cfg 内容无效（热加载时调用方应保留原配置）
+bool gateway_config_load(const char* path, GatewayConfig& cfg, std::string& err);
+// 列出两份配置间需要重启才能生效的差异项（逗号分隔），没有差异时返回空串
+std::string gateway_config_restart_diff(const GatewayConfig& running, const GatewayConfig& loaded);
@@ -0,0 +1,215 @@
+#include "hot_restart.h"
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern char** environ;
+
+#define HOT_RESTART_TAG_LISTENER 'L'
+#define HOT_RESTART_TAG_CONNS 'C'
+#define HOT_RESTART_TAG_READY 'R'
+
+static int g_channel = -1;  // 旧进程与新进程各持一端
+static pid_t g_child = -1;
+static HotRestartState g_state = HotRestartState::NONE;
+
+// 发送一条消息：1 字节标记，可选 4 字节数值（value 非空时），附带 count 个 fd
+static bool send_fds(int sock, char tag, const int* fds, int count, const uint32_t* value = nullptr) {
+    char control[CMSG_SPACE(sizeof(int) * HOT_RESTART_BATCH)];
+    iovec iov[2] = {{&tag, 1}, {const_cast<uint32_t*>(value), sizeof(uint32_t)}};
+    size_t len = value ? 1 + sizeof(uint32_t) : 1;
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = value ? 2 : 1;
+    if (count > 0) {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+        cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int) * count);
+        memcpy(CMSG_DATA(cm), fds, sizeof(int) * count);
+    }
+    ssize_t n;
+    do {
+        n = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == (ssize_t)len;
+}
+
+// 接收一条消息，返回附带的 fd 数（收到的 fd 为 close-on-exec）；
+// 没有消息时返回 -2，对端关闭或出错返回 -1。max 不足时多出的 fd 被关闭。
+// 消息带数值时写入 *value 并置 *has_value（旧版本发来的消息不带数值）
+static int recv_fds(int sock, char& tag, int* fds, int max, uint32_t* value = nullptr, bool* has_value = nullptr) {
+    char control[CMSG_SPACE(sizeof(int) * HOT_RESTART_BATCH)];
+    uint32_t v = 0;
+    iovec iov[2] = {{&tag, 1}, {&v, sizeof(v)}};
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK ? -2 : -1;
+    if (n == 0) return -1;
+    bool got_value = n == (ssize_t)(1 + sizeof(v));
+    if (has_value) *has_value = got_value;
+    if (value && got_value) *value = v;
+    int count = 0;
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) continue;
+        int k = (int)((cm->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        const int* got = (const int*)CMSG_DATA(cm);
+        for (int i = 0; i < k; ++i) {
+            int fd;
+            memcpy(&fd, got + i, sizeof(int));
+            if (count < max) fds[count++] = fd;
+            else close(fd);
+        }
+    }
+    return count;
+}
+
+bool hot_restart_spawn(char* const argv[], int listen_fd, uint32_t id_epoch) {
+    if (g_channel >= 0 || listen_fd < 0) return false;
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) return false;
+    // 环境变量在 fork 前准备好，子进程在 exec 前只做异步信号安全的调用
+    std::string handoff = std::string(HOT_RESTART_ENV "=") + std::to_string(sv[1]);
+    std::vector<char*> envp;
+    for (char** e = environ; *e; ++e) {
+        if (strncmp(*e, HOT_RESTART_ENV "=", sizeof(HOT_RESTART_ENV)) != 0) envp.push_back(*e);
+    }
+    envp.push_back(&handoff[0]);
+    envp.push_back(nullptr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(sv[0]);
+        close(sv[1]);
+        return false;
+    }
+    if (pid == 0) {
+        // 只有通道的这一端跨过 exec，其余 fd 均为 close-on-exec
+        fcntl(sv[1], F_SETFD, 0);
+        execve("/proc/self/exe", argv, envp.data());
+        _exit(127);
+    }
+    close(sv[1]);
+    g_channel = sv[0];
+    g_child = pid;
+    g_state = HotRestartState::SPAWNED;
+    fcntl(g_channel, F_SETFL, O_NONBLOCK);
+    // 监听 socket 先行：新进程一初始化完就能 accept，积压队列中的连接不会丢
+    if (!send_fds(g_channel, HOT_RESTART_TAG_LISTENER, &listen_fd, 1, &id_epoch)) {
+        hot_restart_close();
+        return false;
+    }
+    return true;
+}
+
+// 就绪后同样每轮检查：移交期间新进程退出或关闭通道，旧进程要能恢复服务
+HotRestartState hot_restart_poll() {
+    if (g_state != HotRestartState::SPAWNED && g_state != HotRestartState::READY) return g_state;
+    char tag = 0;
+    int n = recv_fds(g_channel, tag, nullptr, 0);
+    if (n == -1) {
+        g_state = HotRestartState::FAILED;
+        return g_state;
+    }
+    if (g_state == HotRestartState::SPAWNED && n == 0 && tag == HOT_RESTART_TAG_READY) {
+        g_state = HotRestartState::READY;
+    }
+    int status;
+    if (g_child > 0 && waitpid(g_child, &status, WNOHANG) == g_child) {
+        g_child = -1;
+        g_state = HotRestartState::FAILED;
+    }
+    return g_state;
+}
+
+bool hot_restart_send(const int* fds, int count) {
+    if (g_state != HotRestartState::READY || count <= 0 || count > HOT_RESTART_BATCH) return false;
+    // 通道非阻塞：新进程来不及接收时返回 false，调用方下一轮重试；对端已关闭时判定失败
+    if (send_fds(g_channel, HOT_RESTART_TAG_CONNS, fds, count)) return true;
+    if (errno == EPIPE || errno == ECONNRESET) g_state = HotRestartState::FAILED;
+    return false;
+}
+
+void hot_restart_close() {
+    if (g_channel >= 0) close(g_channel);
+    g_channel = -1;
+    // 放弃时终止尚未就绪的新进程，避免它拿着监听 socket 继续运行
+    if (g_child > 0 && g_state != HotRestartState::READY) {
+        int status;
+        kill(g_child, SIGTERM);
+        waitpid(g_child, &status, WNOHANG);
+    }
+    g_child = -1;
+    g_state = HotRestartState::NONE;
+}
+
+// FAILED 也算进行中，直到调用方 hot_restart_close 收尾
+bool hot_restart_in_progress() {
+    return g_state != HotRestartState::NONE;
+}
+
+int hot_restart_inherit_listener(uint32_t* id_epoch, bool* has_id_epoch) {
+    *has_id_epoch = false;
+    const char* env = getenv(HOT_RESTART_ENV);
+    if (!env) return -1;
+    int ch = atoi(env);
+    unsetenv(HOT_RESTART_ENV);
+    if (ch < 0) return -1;
+    fcntl(ch, F_SETFD, FD_CLOEXEC);
+    pollfd pfd = {ch, POLLIN, 0};
+    char tag = 0;
+    int fd = -1;
+    if (poll(&pfd, 1, HOT_RESTART_LISTENER_WAIT_MS) != 1 || recv_fds(ch, tag, &fd, 1, id_epoch, has_id_epoch) != 1 ||
+        tag != HOT_RESTART_TAG_LISTENER) {
+        if (fd >= 0) close(fd);
+        close(ch);
+        return -1;
+    }
+    fcntl(ch, F_SETFL, O_NONBLOCK);
+    g_channel = ch;
+    return fd;
+}
+
+void hot_restart_ready() {
+    if (g_channel >= 0 && g_state == HotRestartState::NONE) send_fds(g_channel, HOT_RESTART_TAG_READY, nullptr, 0);
+}
+
+int hot_restart_receive(int* fds, int max) {
+    if (g_channel < 0 || g_state != HotRestartState::NONE) return -1;
+    int total = 0;
+    while (max - total >= HOT_RESTART_BATCH) {
+        char tag = 0;
+        int n = recv_fds(g_channel, tag, fds + total, max - total);
+        if (n == -2) break;
+        if (n == -1) {
+            close(g_channel);
+            g_channel = -1;
+            return total ? total : -1;
+        }
+        if (tag == HOT_RESTART_TAG_CONNS) {
+            total += n;
+        } else {
+            for (int i = 0; i < n; ++i) close(fds[total + i]);
+        }
+    }
+    return total;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <sys/types.h>
+#include <cstdint>
+
+// 热重启：旧进程 fork/exec 出新进程，经 UNIX socket（SOCK_SEQPACKET）用 SCM_RIGHTS 把监听 socket
+// 和空闲连接交给新进程。流程：
+//   旧进程收到 SIGUSR2 -> hot_restart_spawn，先发监听 socket（新旧进程短时间内共同 accept），
+//   同一条消息带上请求 id 的下一个 epoch，新进程从它开始分配，与旧进程在途的 id 不重复
+//   新进程初始化完成 -> hot_restart_ready 回报就绪
+//   旧进程收到就绪 -> 暂停 accept（监听 socket 保留到移交结束），空闲连接分批移交，
+//   有在途流的连接等流结束后再移交
+//   旧进程连接移交完（或超过排空期限）后关闭通道并退出，新进程读到 EOF 后关闭通道
+// 新进程未能就绪（启动失败、退出），或移交途中退出、关闭通道时，旧进程恢复 accept 与尚未移交的连接。
+
+#define HOT_RESTART_ENV "GATEWAY_HANDOFF_FD"  // 新进程从该环境变量得到通道 fd
+#define HOT_RESTART_BATCH 64                   // 单条消息携带的连接数上限
+#define HOT_RESTART_LISTENER_WAIT_MS 5000      // 新进程等待监听 socket 的最长时间
+
+enum class HotRestartState { NONE, SPAWNED, READY, FAILED };
+
+// ---- 旧进程 ----
+// 建立通道并启动新进程（argv 为本进程的启动参数），随后发出监听 socket 和新进程的起始 id epoch
+bool hot_restart_spawn(char* const argv[], int listen_fd, uint32_t id_epoch);
+// 非阻塞检查新进程状态：收到就绪消息后返回 READY，新进程退出或通道断开返回 FAILED（就绪后仍每轮检查）
+HotRestartState hot_restart_poll();
+// 移交一批连接（count <= HOT_RESTART_BATCH），调用方随后关闭自己的 fd；
+// 通道已断开时返回 false，之后 hot_restart_poll 返回 FAILED
+bool hot_restart_send(const int* fds, int count);
+// 关闭通道（移交完成或放弃）；放弃时终止尚未就绪的新进程
+void hot_restart_close();
+bool hot_restart_in_progress();
+
+// ---- 新进程 ----
+// 由热重启启动时返回继承的监听 socket（阻塞等待，最长 HOT_RESTART_LISTENER_WAIT_MS），否则返回 -1；
+// 旧进程交来起始 id epoch 时写入 *id_epoch 并置 *has_id_epoch
+int hot_restart_inherit_listener(uint32_t* id_epoch, bool* has_id_epoch);
+// 初始化完成后通知旧进程
+void hot_restart_ready();
+// 非阻塞接收旧进程移交的连接，返回收到的个数；通道已关闭（或不是热重启启动）时返回 -1
+int hot_restart_receive(int* fds, int max);
@@ -0,0 +1,910 @@
+#include "io_engine.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include "utils/clock.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(IORING_RECV_MULTISHOT) && defined(IORING_ACCEPT_MULTISHOT) && \
+    defined(IORING_ASYNC_CANCEL_FD) && defined(IORING_FEAT_EXT_ARG)
+#define IO_ENGINE_HAVE_URING 1
+#endif
+#endif
+#endif
+
+// 每个 fd 的状态，按 fd 直接索引
+struct FdState {
+    IoOwner owner;
+    bool paused;
+    bool recv_armed;   // io_uring：多发 recv/accept 仍在内核中
+    bool send_error;   // 发送失败，后续帧直接丢弃，断开由读路径处理
+    bool dirty;        // io_uring：已在待提交列表中
+    bool want_out;     // epoll：已关注 EPOLLOUT
+    bool backoff;      // 监听：accept 资源耗尽，暂停到 g_backoff_until_ms（与调用方的 paused 相互独立）
+    uint16_t gen;      // fd 复用时递增，用于丢弃旧连接的完成事件
+    uint8_t inflight;  // io_uring：已提交未完成的发送块
+    uint16_t chunks;   // 占用的发送块（含在途）
+    uint16_t head_off; // epoll：队首块已写出的字节
+    int staged_head;   // 暂存未发出（io_uring 为未提交）的发送块链表
+    int staged_tail;
+};
+
+static FdState* g_fds = nullptr;  // fd 状态表，init 时按 max_fds 一次性映射
+static int g_max_fds = 0;
+static IoBackend g_backend = IoBackend::EPOLL;
+static bool g_active = false;
+static IoEngineStats g_stats;
+static RecvBuf* g_held[IO_ENGINE_MAX_EVENTS];  // 上一轮事件引用的接收缓冲，下一轮 wait 时释放
+static int g_held_count = 0;
+static int g_backoff_fd = -1;  // 正在退避的监听 fd（只有一个监听 socket）
+static int64_t g_backoff_until_ms = 0;
+
+static void accept_backoff(int fd);
+
+// accept 失败是否因为资源耗尽：监听 socket 会一直就绪，立即重试只会空转
+static bool accept_exhausted(int err) {
+    return err == EMFILE || err == ENFILE || err == ENOBUFS || err == ENOMEM;
+}
+
+static void reset_fd(FdState& st) {
+    uint16_t gen = st.gen;
+    memset(&st, 0, sizeof(st));
+    st.gen = (uint16_t)(gen + 1);
+    st.staged_head = st.staged_tail = -1;
+}
+
+static void* map_anon(size_t len) {
+    void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? nullptr : p;
+}
+
+// ---------------------------------------------------------------- 发送暂存块（两个后端共用）
+// 窗口满时帧的剩余部分暂存在按连接串起的块链中：io_uring 按链提交链接的 send，epoll 在可写时写出
+
+struct SendChunk {
+    int next;
+    uint32_t len;
+};
+
+static const size_t SMEM_TOTAL = (size_t)IO_ENGINE_SEND_CHUNKS * IO_ENGINE_SEND_CHUNK_SIZE;
+static char* g_smem = nullptr;
+static SendChunk g_chunks[IO_ENGINE_SEND_CHUNKS];
+static int g_free_chunks[IO_ENGINE_SEND_CHUNKS];
+static int g_free_count = 0;
+
+static bool chunks_init() {
+    if (!g_smem) g_smem = (char*)map_anon(SMEM_TOTAL);
+    if (!g_smem) return false;
+    for (int i = 0; i < IO_ENGINE_SEND_CHUNKS; ++i) g_free_chunks[i] = IO_ENGINE_SEND_CHUNKS - 1 - i;
+    g_free_count = IO_ENGINE_SEND_CHUNKS;
+    return true;
+}
+
+static inline char* chunk_data(int idx) {
+    return g_smem + (size_t)idx * IO_ENGINE_SEND_CHUNK_SIZE;
+}
+
+static void free_chunk(int idx) {
+    g_free_chunks[g_free_count++] = idx;
+}
+
+// 追加到连接的暂存链，块不足或超出单连接配额时不写入任何字节并返回 false
+// 单连接配额只在已有占用时生效，超大帧在空闲连接上仍可发出；force 时不计配额（续写已写出一部分的帧）
+static bool stage_send(FdState& st, const char* data, size_t len, bool force) {
+    size_t room = st.staged_tail >= 0 ? IO_ENGINE_SEND_CHUNK_SIZE - g_chunks[st.staged_tail].len : 0;
+    size_t need = len > room ? (len - room + IO_ENGINE_SEND_CHUNK_SIZE - 1) / IO_ENGINE_SEND_CHUNK_SIZE : 0;
+    if (need > (size_t)g_free_count) return false;
+    if (!force && st.chunks > 0 && st.chunks + need > IO_ENGINE_SEND_CHUNKS_PER_FD) return false;
+    while (len > 0) {
+        if (st.staged_tail < 0 || g_chunks[st.staged_tail].len == IO_ENGINE_SEND_CHUNK_SIZE) {
+            int idx = g_free_chunks[--g_free_count];
+            g_chunks[idx].next = -1;
+            g_chunks[idx].len = 0;
+            if (st.staged_tail >= 0) g_chunks[st.staged_tail].next = idx;
+            else st.staged_head = idx;
+            st.staged_tail = idx;
+            st.chunks++;
+        }
+        SendChunk& c = g_chunks[st.staged_tail];
+        size_t n = IO_ENGINE_SEND_CHUNK_SIZE - c.len;
+        if (n > len) n = len;
+        memcpy(chunk_data(st.staged_tail) + c.len, data, n);
+        c.len += (uint32_t)n;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 回收尚未发出的暂存块（io_uring 在途的块在完成事件中回收）
+static void drop_staged(FdState& st) {
+    for (int idx = st.staged_head; idx >= 0; idx = g_chunks[idx].next) {
+        free_chunk(idx);
+        st.chunks--;
+    }
+    st.staged_head = st.staged_tail = -1;
+    st.head_off = 0;
+}
+
+// ---------------------------------------------------------------- epoll 后端
+
+static int g_epfd = -1;
+
+static bool epoll_init() {
+    g_epfd = epoll_create1(EPOLL_CLOEXEC);
+    return g_epfd >= 0;
+}
+
+static void epoll_release() {
+    if (g_epfd >= 0) close(g_epfd);
+    g_epfd = -1;
+}
+
+static bool epoll_ctl_fd(int op, int fd, uint32_t events) {
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = fd;
+    g_stats.syscalls++;
+    return epoll_ctl(g_epfd, op, fd, &ev) == 0;
+}
+
+// 按暂停状态与是否有暂存发送调整关注的事件
+static void epoll_update(int fd, bool force) {
+    FdState& st = g_fds[fd];
+    bool want_out = st.staged_head >= 0;
+    if (!force && want_out == st.want_out) return;
+    st.want_out = want_out;
+    bool read = !st.paused && !st.backoff;
+    epoll_ctl_fd(EPOLL_CTL_MOD, fd, (read ? (uint32_t)EPOLLIN : 0u) | (want_out ? (uint32_t)EPOLLOUT : 0u));
+}
+
+// 可写时按序写出暂存块，写完后取消 EPOLLOUT 关注
+static void epoll_drain(int fd) {
+    FdState& st = g_fds[fd];
+    while (st.staged_head >= 0) {
+        int idx = st.staged_head;
+        SendChunk& c = g_chunks[idx];
+        g_stats.syscalls++;
+        ssize_t n = send(fd, chunk_data(idx) + st.head_off, c.len - st.head_off, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n <= 0) {
+            // 连接已出错，断开由读路径处理
+            st.send_error = true;
+            drop_staged(st);
+            break;
+        }
+        g_stats.bytes_sent += (uint64_t)n;
+        st.head_off = (uint16_t)(st.head_off + n);
+        if (st.head_off < c.len) continue;
+        st.staged_head = c.next;
+        if (st.staged_head < 0) st.staged_tail = -1;
+        st.head_off = 0;
+        free_chunk(idx);
+        st.chunks--;
+    }
+    epoll_update(fd, false);
+}
+
+static int epoll_wait_events(IoEvent* events, int max_events, int timeout_ms) {
+    epoll_event evs[IO_ENGINE_MAX_EVENTS];
+    g_stats.syscalls++;
+    int n = epoll_wait(g_epfd, evs, max_events, timeout_ms);
+    int out = 0;
+    for (int i = 0; i < n && out < max_events; ++i) {
+        int fd = evs[i].data.fd;
+        FdState& st = g_fds[fd];
+        if (evs[i].events & EPOLLOUT) epoll_drain(fd);
+        if (!(evs[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))) continue;
+        if (st.owner == IoOwner::LISTENER) {
+            // 一次唤醒连续 accept 到 EAGAIN；新连接直接为非阻塞，本轮放不下的连接水平触发下一轮继续
+            while (out < max_events) {
+                g_stats.syscalls++;
+                int cfd = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (cfd < 0) {
+                    if (accept_exhausted(errno)) accept_backoff(fd);
+                    break;
+                }
+                events[out++] = {IoEventType::ACCEPT, IoOwner::LISTENER, cfd, nullptr, 0, nullptr};
+            }
+            continue;
+        }
+        // 缓冲池耗尽时本轮不读，水平触发下一轮再报
+        RecvBuf* buf = BufPool::acquire();
+        if (!buf) continue;
+        g_stats.syscalls++;
+        ssize_t r = recv(fd, buf->data, BUFPOOL_BUF_SIZE, MSG_DONTWAIT);
+        if (r > 0) {
+            g_stats.bytes_received += (uint64_t)r;
+            g_held[g_held_count++] = buf;
+            events[out++] = {IoEventType::DATA, st.owner, fd, buf->data, (int)r, buf};
+            continue;
+        }
+        BufPool::release(buf);
+        if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            events[out++] = {IoEventType::CLOSED, st.owner, fd, nullptr, 0, nullptr};
+        }
+    }
+    return out;
+}
+
+// 非阻塞写出尽量多的字节，返回已写出的字节数；连接出错时返回 -1
+static ssize_t send_some(int fd, const char* data, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        g_stats.syscalls++;
+        ssize_t n = send(fd, data + off, len - off, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            off += (size_t)n;
+            g_stats.bytes_sent += (uint64_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return -1;
+    }
+    return (ssize_t)off;
+}
+
+// 已有暂存时排在其后，保证字节顺序；否则直接写，窗口满且未写出任何字节时返回 false。
+// 写出部分字节后剩余部分进入暂存（不计单连接配额），由 EPOLLOUT 写完，反应器从不等待发送窗口
+static bool epoll_send(int fd, const char* data, size_t len) {
+    FdState& st = g_fds[fd];
+    if (st.send_error) return true;
+    if (st.staged_head >= 0) {
+        if (stage_send(st, data, len, false)) return true;
+        g_stats.sends_deferred++;
+        return false;
+    }
+    ssize_t off = send_some(fd, data, len);
+    if (off < 0) {
+        st.send_error = true;  // 断开由读路径处理
+        return true;
+    }
+    if ((size_t)off == len) return true;
+    if (off == 0) {
+        g_stats.sends_deferred++;
+        return false;
+    }
+    if (!stage_send(st, data + off, len - off, true)) {
+        // 暂存块耗尽：帧已无法写完，断开连接而不是留下半帧
+        st.send_error = true;
+        shutdown(fd, SHUT_RDWR);
+        return true;
+    }
+    epoll_update(fd, false);
+    return true;
+}
+
+// 未注册的 fd 没有暂存：写不完整帧时断开连接，不留半帧
+static bool direct_send(int fd, const char* data, size_t len) {
+    ssize_t off = send_some(fd, data, len);
+    if (off == 0 && len > 0) {
+        g_stats.sends_deferred++;
+        return false;
+    }
+    if (off >= 0 && (size_t)off < len) shutdown(fd, SHUT_RDWR);
+    return true;
+}
+
+// ---------------------------------------------------------------- io_uring 后端
+
+#ifdef IO_ENGINE_HAVE_URING
+
+#define URING_ENTRIES 1024
+#define URING_BGID 1
+
+enum : uint64_t { OP_ACCEPT = 1, OP_RECV, OP_SEND, OP_CANCEL };
+
+// user_data 布局：op(8) | gen(16) | aux(16，发送块编号) | fd(24)
+static inline uint64_t ud_pack(uint64_t op, uint16_t gen, unsigned aux, int fd) {
+    return (op << 56) | ((uint64_t)gen << 40) | ((uint64_t)(aux & 0xffff) << 24) | (uint64_t)(fd & 0xffffff);
+}
+
+struct Uring {
+    int fd;
+    void* sq_ptr;
+    size_t sq_len;
+    void* cq_ptr;
+    size_t cq_len;
+    io_uring_sqe* sqes;
+    size_t sqes_len;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_local_tail;
+    unsigned pending;       // 已填写未提交的 SQE 数
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe* cqes;
+    io_uring_buf_ring* br;  // 提供缓冲环，环中的缓冲取自 BufPool
+    size_t br_len;
+    unsigned br_tail;
+    unsigned br_lent;       // 已交给内核、尚未在完成事件中取回的缓冲数
+};
+
+static Uring g_ring = {};
+static int g_dirty[IO_ENGINE_SEND_CHUNKS];  // 有暂存发送待提交的 fd；每个至少占一个暂存块，不会超过块数
+static int g_dirty_count = 0;
+
+static void uring_release() {
+    if (g_ring.fd >= 0) close(g_ring.fd);
+    // 关闭 ring 后内核不再使用环中的缓冲，全部归还缓冲池
+    if (g_ring.br) {
+        io_uring_buf* bufs = (io_uring_buf*)g_ring.br;
+        for (unsigned k = 0; k < g_ring.br_lent; ++k) {
+            BufPool::release(BufPool::at(bufs[(g_ring.br_tail - 1 - k) & (IO_ENGINE_RECV_BUFS - 1)].bid));
+        }
+    }
+    if (g_ring.sqes) munmap(g_ring.sqes, g_ring.sqes_len);
+    if (g_ring.cq_ptr && g_ring.cq_ptr != g_ring.sq_ptr) munmap(g_ring.cq_ptr, g_ring.cq_len);
+    if (g_ring.sq_ptr) munmap(g_ring.sq_ptr, g_ring.sq_len);
+    if (g_ring.br) munmap(g_ring.br, g_ring.br_len);
+    memset(&g_ring, 0, sizeof(g_ring));
+    g_ring.fd = -1;
+}
+
+// 多发 recv 需要 6.0 及以上内核
+static bool uring_kernel_supported() {
+    utsname u;
+    if (uname(&u) != 0) return false;
+    int major = 0;
+    if (sscanf(u.release, "%d", &major) != 1) return false;
+    return major >= 6;
+}
+
+// 内核头文件中 bufs 前有一个空结构体，C++ 下空结构体占 1 字节会让 bufs 偏移 8 字节，
+// 这里直接把环首地址当作 io_uring_buf 数组使用
+static void uring_buf_add(RecvBuf* buf) {
+    io_uring_buf* b = (io_uring_buf*)g_ring.br + (g_ring.br_tail & (IO_ENGINE_RECV_BUFS - 1));
+    b->addr = (uint64_t)(uintptr_t)buf->data;
+    b->len = BUFPOOL_BUF_SIZE;
+    b->bid = (uint16_t)buf->index;
+    g_ring.br_tail++;
+    g_ring.br_lent++;
+}
+
+// 从缓冲池补满提供缓冲环；仍被上层引用的缓冲不在环中，池耗尽时多发 recv 以 ENOBUFS 结束，补充后重新挂载
+static void uring_buf_refill() {
+    while (g_ring.br_lent < IO_ENGINE_RECV_BUFS) {
+        RecvBuf* buf = BufPool::acquire();
+        if (!buf) break;
+        uring_buf_add(buf);
+    }
+    __atomic_store_n(&g_ring.br->tail, (uint16_t)g_ring.br_tail, __ATOMIC_RELEASE);
+}
+
+static bool uring_init() {
+    if (!uring_kernel_supported()) return false;
+    memset(&g_ring, 0, sizeof(g_ring));
+    g_ring.fd = -1;
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+    int fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+    if (fd < 0) {
+        memset(&p, 0, sizeof(p));
+        fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+    }
+    if (fd < 0) return false;
+    g_ring.fd = fd;
+    if (!(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP)) {
+        uring_release();
+        return false;
+    }
+
+    g_ring.sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    g_ring.cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && g_ring.cq_len > g_ring.sq_len) g_ring.sq_len = g_ring.cq_len;
+    void* sq = mmap(nullptr, g_ring.sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        uring_release();
+        return false;
+    }
+    g_ring.sq_ptr = sq;
+    if (single_mmap) {
+        g_ring.cq_ptr = sq;
+    } else {
+        void* cq = mmap(nullptr, g_ring.cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            uring_release();
+            return false;
+        }
+        g_ring.cq_ptr = cq;
+    }
+    g_ring.sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, g_ring.sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        uring_release();
+        return false;
+    }
+    g_ring.sqes = (io_uring_sqe*)sqes;
+
+    char* sqb = (char*)g_ring.sq_ptr;
+    g_ring.sq_head = (unsigned*)(sqb + p.sq_off.head);
+    g_ring.sq_tail = (unsigned*)(sqb + p.sq_off.tail);
+    g_ring.sq_mask = *(unsigned*)(sqb + p.sq_off.ring_mask);
+    g_ring.sq_entries = *(unsigned*)(sqb + p.sq_off.ring_entries);
+    unsigned* sq_array = (unsigned*)(sqb + p.sq_off.array);
+    for (unsigned i = 0; i < g_ring.sq_entries; ++i) sq_array[i] = i;  // SQE 按下标顺序使用
+    g_ring.sq_local_tail = *g_ring.sq_tail;
+    char* cqb = (char*)g_ring.cq_ptr;
+    g_ring.cq_head = (unsigned*)(cqb + p.cq_off.head);
+    g_ring.cq_tail = (unsigned*)(cqb + p.cq_off.tail);
+    g_ring.cq_mask = *(unsigned*)(cqb + p.cq_off.ring_mask);
+    g_ring.cqes = (io_uring_cqe*)(cqb + p.cq_off.cqes);
+
+    // 提供缓冲环（5.19+）：注册失败说明内核不支持，退回 epoll
+    g_ring.br_len = IO_ENGINE_RECV_BUFS * sizeof(io_uring_buf);
+    g_ring.br = (io_uring_buf_ring*)map_anon(g_ring.br_len);
+    // bid 只有 16 位，缓冲池容量不能超过 65536
+    if (!g_ring.br || BufPool::capacity() > 65536) {
+        uring_release();
+        return false;
+    }
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)g_ring.br;
+    reg.ring_entries = IO_ENGINE_RECV_BUFS;
+    reg.bgid = URING_BGID;
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        uring_release();
+        return false;
+    }
+    g_ring.br_tail = 0;
+    g_ring.br_lent = 0;
+    uring_buf_refill();
+
+    g_dirty_count = 0;
+    return true;
+}
+
+static int uring_enter(unsigned min_complete, int timeout_ms) {
+    __atomic_store_n(g_ring.sq_tail, g_ring.sq_local_tail, __ATOMIC_RELEASE);
+    unsigned flags = 0;
+    const void* argp = nullptr;
+    size_t argsz = 0;
+    __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    if (min_complete) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000LL;
+            memset(&arg, 0, sizeof(arg));
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argsz = sizeof(arg);
+        }
+    } else if (g_ring.pending == 0) {
+        return 0;
+    }
+    g_stats.syscalls++;
+    int r = (int)syscall(__NR_io_uring_enter, g_ring.fd, g_ring.pending, min_complete, flags, argp, argsz);
+    if (r < 0) return -errno;
+    g_ring.pending -= (unsigned)r < g_ring.pending ? (unsigned)r : g_ring.pending;
+    return r;
+}
+
+// 保证 SQ 中至少有 n 个空位，同一连接的链接发送必须落在同一次提交中
+static bool uring_reserve(unsigned n) {
+    unsigned head = __atomic_load_n(g_ring.sq_head, __ATOMIC_ACQUIRE);
+    if (g_ring.sq_entries - (g_ring.sq_local_tail - head) >= n) return true;
+    uring_enter(0, -1);
+    head = __atomic_load_n(g_ring.sq_head, __ATOMIC_ACQUIRE);
+    return g_ring.sq_entries - (g_ring.sq_local_tail - head) >= n;
+}
+
+static io_uring_sqe* uring_get_sqe() {
+    if (!uring_reserve(1)) return nullptr;
+    io_uring_sqe* sqe = &g_ring.sqes[g_ring.sq_local_tail & g_ring.sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    g_ring.sq_local_tail++;
+    g_ring.pending++;
+    return sqe;
+}
+
+static void uring_arm(int fd) {
+    io_uring_sqe* sqe = uring_get_sqe();
+    if (!sqe) return;
+    FdState& st = g_fds[fd];
+    sqe->fd = fd;
+    if (st.owner == IoOwner::LISTENER) {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data = ud_pack(OP_ACCEPT, st.gen, 0, fd);
+    } else {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_BGID;
+        sqe->user_data = ud_pack(OP_RECV, st.gen, 0, fd);
+    }
+    st.recv_armed = true;
+}
+
+static void uring_cancel(int fd, uint64_t target) {
+    io_uring_sqe* sqe = uring_get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = fd;
+    if (target) {
+        sqe->addr = target;
+    } else {
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    }
+    sqe->user_data = ud_pack(OP_CANCEL, 0, 0, fd);
+}
+
+static void uring_mark_dirty(int fd) {
+    FdState& st = g_fds[fd];
+    if (st.dirty || g_dirty_count >= IO_ENGINE_SEND_CHUNKS) return;
+    st.dirty = true;
+    g_dirty[g_dirty_count++] = fd;
+}
+
+static bool uring_send(int fd, const char* data, size_t len) {
+    FdState& st = g_fds[fd];
+    if (st.send_error) return true;
+    if (!stage_send(st, data, len, false)) {
+        g_stats.sends_deferred++;
+        return false;
+    }
+    if (st.inflight == 0) uring_mark_dirty(fd);
+    return true;
+}
+
+// 每个连接的暂存块作为一条链接的 send 链提交；上一条链完成前不提交新链，保证字节顺序
+static void uring_flush_sends() {
+    int keep = 0;
+    for (int k = 0; k < g_dirty_count; ++k) {
+        int fd = g_dirty[k];
+        FdState& st = g_fds[fd];
+        if (st.inflight > 0 || st.staged_head < 0) {
+            st.dirty = false;
+            continue;
+        }
+        if (!uring_reserve(st.chunks)) {
+            g_dirty[keep++] = fd;  // SQ 已满，下一轮再提交
+            continue;
+        }
+        st.dirty = false;
+        for (int idx = st.staged_head; idx >= 0;) {
+            SendChunk& c = g_chunks[idx];
+            io_uring_sqe* sqe = uring_get_sqe();
+            sqe->opcode = IORING_OP_SEND;
+            sqe->fd = fd;
+            sqe->addr = (uint64_t)(uintptr_t)chunk_data(idx);
+            sqe->len = c.len;
+            sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            if (c.next >= 0) sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = ud_pack(OP_SEND, st.gen, (unsigned)idx, fd);
+            st.inflight++;
+            idx = c.next;
+        }
+        st.staged_head = st.staged_tail = -1;
+    }
+    g_dirty_count = keep;
+}
+
+static void uring_remove(int fd) {
+    // 暂存未提交的块由调用方回收，在途的块在完成事件中回收
+    uring_cancel(fd, 0);
+    // 取消按 fd 查找文件，必须在调用方 close 之前提交
+    uring_enter(0, -1);
+}
+
+// 处理一条完成事件，产生对外事件时返回 true
+static bool uring_handle_cqe(const io_uring_cqe* cqe, IoEvent& ev) {
+    uint64_t ud = cqe->user_data;
+    uint64_t op = ud >> 56;
+    uint16_t gen = (uint16_t)(ud >> 40);
+    int aux = (int)((ud >> 24) & 0xffff);
+    int fd = (int)(ud & 0xffffff);
+    int res = cqe->res;
+    bool more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+    FdState& st = g_fds[fd];
+    bool live = st.owner != IoOwner::NONE && st.gen == gen;
+
+    switch (op) {
+    case OP_ACCEPT:
+        if (!live) {
+            if (res >= 0) close(res);  // 监听已注销，丢弃迟到的连接
+            return false;
+        }
+        if (!more) st.recv_armed = false;
+        if (res < 0 && accept_exhausted(-res)) {
+            accept_backoff(fd);
+            return false;
+        }
+        if (!more && !st.paused && !st.backoff) uring_arm(fd);
+        if (res < 0) return false;
+        ev = {IoEventType::ACCEPT, IoOwner::LISTENER, res, nullptr, 0, nullptr};
+        return true;
+    case OP_RECV: {
+        RecvBuf* buf = nullptr;
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+            buf = BufPool::at(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            g_ring.br_lent--;
+        }
+        if (buf && (!live || res <= 0)) {
+            BufPool::release(buf);
+            buf = nullptr;
+        }
+        if (!live) return false;
+        if (!more) st.recv_armed = false;
+        if (res > 0 && buf) {
+            if (!more && !st.paused) uring_arm(fd);
+            g_held[g_held_count++] = buf;
+            g_stats.bytes_received += (uint64_t)res;
+            ev = {IoEventType::DATA, st.owner, fd, buf->data, res, buf};
+            return true;
+        }
+        // 缓冲耗尽、被暂停取消或被打断：未暂停时重新挂载
+        if (res == -ENOBUFS || res == -ECANCELED || res == -EAGAIN || res == -EINTR) {
+            if (!more && !st.paused) uring_arm(fd);
+            return false;
+        }
+        ev = {IoEventType::CLOSED, st.owner, fd, nullptr, 0, nullptr};
+        return true;
+    }
+    case OP_SEND: {
+        bool short_send = res < 0 || (uint32_t)res < g_chunks[aux].len;
+        free_chunk(aux);
+        if (!live) return false;
+        st.inflight--;
+        st.chunks--;
+        if (short_send) st.send_error = true;
+        if (st.send_error) {
+            drop_staged(st);
+        } else if (st.inflight == 0 && st.staged_head >= 0) {
+            uring_mark_dirty(fd);
+        }
+        g_stats.bytes_sent += res > 0 ? (uint64_t)res : 0;
+        return false;
+    }
+    default:
+        return false;
+    }
+}
+
+static int uring_wait_events(IoEvent* events, int max_events, int timeout_ms) {
+    uring_buf_refill();
+    uring_flush_sends();
+
+    unsigned head = *g_ring.cq_head;
+    unsigned tail = __atomic_load_n(g_ring.cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        // 提交与等待合并为一次系统调用
+        int r = uring_enter(1, timeout_ms);
+        if (r < 0 && r != -ETIME && r != -EINTR && r != -EBUSY) return 0;
+        tail = __atomic_load_n(g_ring.cq_tail, __ATOMIC_ACQUIRE);
+    } else {
+        uring_enter(0, -1);
+    }
+
+    int out = 0;
+    while (head != tail && out < max_events) {
+        if (uring_handle_cqe(&g_ring.cqes[head & g_ring.cq_mask], events[out])) out++;
+        head++;
+    }
+    __atomic_store_n(g_ring.cq_head, head, __ATOMIC_RELEASE);
+    return out;
+}
+
+#endif // IO_ENGINE_HAVE_URING
+
+// ---------------------------------------------------------------- accept 退避
+
+// 暂停监听，IO_ENGINE_ACCEPT_BACKOFF_MS 后由 io_engine_wait 恢复；期间积压的连接留在内核队列中
+static void accept_backoff(int fd) {
+    FdState& st = g_fds[fd];
+    g_backoff_until_ms = Clock::monotonicSyscallNs() / 1000000 + IO_ENGINE_ACCEPT_BACKOFF_MS;
+    g_backoff_fd = fd;
+    if (st.backoff) return;
+    st.backoff = true;
+    g_stats.accept_backoffs++;
+#ifdef IO_ENGINE_HAVE_URING
+    if (g_backend == IoBackend::URING) {
+        if (st.recv_armed) uring_cancel(fd, ud_pack(OP_ACCEPT, st.gen, 0, fd));
+        return;
+    }
+#endif
+    epoll_update(fd, true);
+}
+
+// 退避到期时恢复监听，否则把等待时间截到到期时刻
+static int accept_backoff_timer(int timeout_ms) {
+    if (g_backoff_fd < 0) return timeout_ms;
+    int64_t left = g_backoff_until_ms - Clock::monotonicSyscallNs() / 1000000;
+    if (left > 0) return timeout_ms >= 0 && timeout_ms < left ? timeout_ms : (int)left;
+    int fd = g_backoff_fd;
+    g_backoff_fd = -1;
+    FdState& st = g_fds[fd];
+    if (!st.backoff) return timeout_ms;
+    st.backoff = false;
+#ifdef IO_ENGINE_HAVE_URING
+    if (g_backend == IoBackend::URING) {
+        if (!st.paused && !st.recv_armed) uring_arm(fd);
+        return timeout_ms;
+    }
+#endif
+    epoll_update(fd, true);
+    return timeout_ms;
+}
+
+// ---------------------------------------------------------------- 对外接口
+
+// fd 状态表：大小变化时重新映射，否则沿用（保留各 fd 的代数）
+static bool fd_table_init(int max_fds) {
+    if (g_fds && g_max_fds == max_fds) return true;
+    if (g_fds) munmap(g_fds, sizeof(FdState) * (size_t)g_max_fds);
+    g_max_fds = 0;
+    g_fds = (FdState*)map_anon(sizeof(FdState) * (size_t)max_fds);
+    if (!g_fds) return false;
+    g_max_fds = max_fds;
+    return true;
+}
+
+bool io_engine_init(IoBackend want, int max_fds) {
+    if (g_active) io_engine_shutdown();
+    if (max_fds <= 0 || max_fds > (1 << 24)) return false;  // user_data 中 fd 占 24 位
+    if (!BufPool::init(BUFPOOL_DEFAULT_COUNT)) return false;
+    if (!fd_table_init(max_fds) || !chunks_init()) return false;
+    for (int fd = 0; fd < g_max_fds; ++fd) reset_fd(g_fds[fd]);
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_backoff_fd = -1;
+#ifdef IO_ENGINE_HAVE_URING
+    if (want != IoBackend::EPOLL && uring_init()) {
+        g_backend = IoBackend::URING;
+        g_active = true;
+        return true;
+    }
+#else
+    (void)want;
+#endif
+    if (!epoll_init()) return false;
+    g_backend = IoBackend::EPOLL;
+    g_active = true;
+    return true;
+}
+
+static void release_held() {
+    for (int i = 0; i < g_held_count; ++i) BufPool::release(g_held[i]);
+    g_held_count = 0;
+}
+
+void io_engine_shutdown() {
+    if (!g_active) return;
+    release_held();
+#ifdef IO_ENGINE_HAVE_URING
+    if (g_backend == IoBackend::URING) uring_release();
+#endif
+    if (g_backend == IoBackend::EPOLL) epoll_release();
+    if (g_smem) munmap(g_smem, SMEM_TOTAL);
+    g_smem = nullptr;
+    g_active = false;
+}
+
+IoBackend io_engine_backend() {
+    return g_backend;
+}
+
+const char* io_engine_backend_name() {
+    return g_backend == IoBackend::URING ? "io_uring" : "epoll";
+}
+
+bool io_engine_active() {
+    return g_active;
+}
+
+int io_engine_max_fds() {
+    return g_max_fds;
+}
+
+bool io_engine_add(int fd, IoOwner owner) {
+    if (!g_active || fd < 0 || fd >= g_max_fds || owner == IoOwner::NONE) return false;
+    FdState& st = g_fds[fd];
+    reset_fd(st);
+    st.owner = owner;
+#ifdef IO_ENGINE_HAVE_URING
+    if (g_backend == IoBackend::URING) {
+        uring_arm(fd);
+        return true;
+    }
+#endif
+    if (!epoll_ctl_fd(EPOLL_CTL_ADD, fd, EPOLLIN)) {
+        reset_fd(st);
+        return false;
+    }
+    return true;
+}
+
+void io_engine_remove(int fd) {
+    if (!g_active || fd < 0 || fd >= g_max_fds) return;
+    FdState& st = g_fds[fd];
+    if (st.owner == IoOwner::NONE) return;
+    drop_staged(st);
+#ifdef IO_ENGINE_HAVE_URING
+    if (g_backend == IoBackend::URING) uring_remove(fd);
+#endif
+    if (g_backend == IoBackend::EPOLL) epoll_ctl_fd(EPOLL_CTL_DEL, fd, 0);
+    if (g_backoff_fd == fd) g_backoff_fd = -1;
+    reset_fd(st);
+}
+
+void io_engine_set_paused(int fd, bool paused) {
+    if (!g_active || fd < 0 || fd >= g_max_fds) return;
+    FdState& st = g_fds[fd];
+    if (st.owner == IoOwner::NONE || st.paused == paused) return;
+    st.paused = paused;
+#ifdef IO_ENGINE_HAVE_URING
+    if (g_backend == IoBackend::URING) {
+        uint64_t op = st.owner == IoOwner::LISTENER ? OP_ACCEPT : OP_RECV;
+        if (paused && st.recv_armed) uring_cancel(fd, ud_pack(op, st.gen, 0, fd));
+        else if (!paused && !st.recv_armed && !st.backoff) uring_arm(fd);
+        return;
+    }
+#endif
+    epoll_update(fd, true);
+}
+
+bool io_engine_quiesced(int fd) {
+    if (!g_active || fd < 0 || fd >= g_max_fds) return true;
+    const FdState& st = g_fds[fd];
+    if (st.owner == IoOwner::NONE) return true;
+    return st.paused && !st.recv_armed && st.inflight == 0 && st.staged_head < 0;
+}
+
+int io_engine_wait(IoEvent* events, int max_events, int timeout_ms) {
+    if (!g_active) return 0;
+    if (max_events > IO_ENGINE_MAX_EVENTS) max_events = IO_ENGINE_MAX_EVENTS;
+    g_stats.waits++;
+    // 上一轮事件的数据到此失效，调用方未另行持有的缓冲回到池中
+    release_held();
+    timeout_ms = accept_backoff_timer(timeout_ms);
+    int n = 0;
+#ifdef IO_ENGINE_HAVE_URING
+    if (g_backend == IoBackend::URING) n = uring_wait_events(events, max_events, timeout_ms);
+#endif
+    if (g_backend == IoBackend::EPOLL) n = epoll_wait_events(events, max_events, timeout_ms);
+    g_stats.events += (uint64_t)n;
+    return n;
+}
+
+bool io_engine_send(int fd, const char* data, size_t len) {
+    if (fd < 0) return true;
+    // 未注册的 fd（或引擎未启用）直接走非阻塞 send
+    if (!g_active || fd >= g_max_fds || g_fds[fd].owner == IoOwner::NONE) return direct_send(fd, data, len);
+#ifdef IO_ENGINE_HAVE_URING
+    if (g_backend == IoBackend::URING) return uring_send(fd, data, len);
+#endif
+    return epoll_send(fd, data, len);
+}
+
+void io_engine_flush() {
+#ifdef IO_ENGINE_HAVE_URING
+    if (g_active && g_backend == IoBackend::URING) {
+        uring_flush_sends();
+        uring_enter(0, -1);
+    }
+#endif
+}
+
+IoEngineStats io_engine_stats() {
+    return g_stats;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "utils/buf_pool.h"
+
+// 网络 I/O 引擎：反应器线程上的收发统一走这里，后端二选一
+// 接收缓冲统一取自 BufPool（io_uring 后端把池中的缓冲注册为提供缓冲），事件直接引用缓冲中的数据。
+//  - URING：多发 accept、基于提供缓冲环（provided buffer ring）的多发 recv、按连接链接的 send，
+//    一轮事件循环中的提交与收割合并为一次 io_uring_enter
+//  - EPOLL：水平触发 epoll + 非阻塞 recv/send，写不完的帧余下部分进入同一套暂存块，可写时写出；
+//    内核过旧或编译环境缺少 io_uring 头文件时使用
+// 引擎只允许在调用 io_engine_init 的线程上使用（io_uring 以 SINGLE_ISSUER 方式创建）。
+
+#define IO_ENGINE_MAX_FDS 4096           // 默认 fd 状态表大小，fd 超出时拒绝注册；可在 init 时指定
+#define IO_ENGINE_MAX_EVENTS 128         // 单次 wait 最多返回的事件数
+#define IO_ENGINE_RECV_BUFS 256          // io_uring 提供缓冲环的容量（2 的幂），应小于 BufPool 容量
+#define IO_ENGINE_SEND_CHUNK_SIZE 4096   // 发送暂存块大小
+#define IO_ENGINE_SEND_CHUNKS 256        // 发送暂存块总数
+#define IO_ENGINE_SEND_CHUNKS_PER_FD 16  // 单连接最多占用的暂存块，超出视为对端窗口已满
+#define IO_ENGINE_ACCEPT_BACKOFF_MS 100  // accept 因 fd 或内存耗尽失败后暂停监听的时间，到期自动恢复
+
+enum class IoBackend { AUTO, EPOLL, URING };
+enum class IoOwner : uint8_t { NONE, LISTENER, CLIENT, NPU };
+enum class IoEventType : uint8_t { ACCEPT, DATA, CLOSED };
+
+struct IoEvent {
+    IoEventType type;
+    IoOwner owner;    // 事件所属 fd 的注册类型（ACCEPT 时为 LISTENER）
+    int fd;           // ACCEPT 时为新连接 fd（已是非阻塞、close-on-exec）
+    const char* data; // DATA 事件的数据，在下一次 io_engine_wait 之前有效
+    int len;
+    RecvBuf* buf;     // data 所在的接收缓冲；需要更久保留时用 BufSlice 持有引用
+};
+
+struct IoEngineStats {
+    uint64_t syscalls;       // 引擎发起的系统调用数
+    uint64_t waits;          // io_engine_wait 调用次数
+    uint64_t events;         // 返回给调用方的事件数
+    uint64_t bytes_received;
+    uint64_t bytes_sent;
+    uint64_t sends_deferred; // 因窗口或暂存块不足而被推迟的发送
+    uint64_t accept_backoffs; // accept 因 EMFILE/ENFILE/ENOBUFS/ENOMEM 失败而暂停监听的次数
+};
+
+// 初始化引擎：AUTO 优先 io_uring，不支持时退回 epoll；want=URING 但不支持时同样退回并返回 true
+// max_fds 为 fd 状态表大小（每个 fd 约 24 字节），应不小于进程的 RLIMIT_NOFILE 或预期的最大 fd
+// BufPool 尚未初始化时按默认容量初始化
+bool io_engine_init(IoBackend want, int max_fds = IO_ENGINE_MAX_FDS);
+// 释放引擎资源（不关闭已注册的 fd）
+void io_engine_shutdown();
+IoBackend io_engine_backend();
+const char* io_engine_backend_name();
+bool io_engine_active();
+int io_engine_max_fds();
+
+// 注册 fd：LISTENER 产生 ACCEPT 事件，CLIENT/NPU 产生 DATA/CLOSED 事件
+bool io_engine_add(int fd, IoOwner owner);
+// 注销 fd（调用方负责 close），其后该 fd 上未完成的操作结果会被丢弃
+void io_engine_remove(int fd);
+// 暂停/恢复读取，用于背压
+void io_engine_set_paused(int fd, bool paused);
+// 已暂停且内核中没有该 fd 的接收/发送操作（io_uring 的取消已完成、发送已落地），
+// 之后不会再产生事件，注销后可安全移交给其他进程
+bool io_engine_quiesced(int fd);
+// 等待事件，timeout_ms < 0 表示一直等待；返回事件数，被信号打断时返回 0
+int io_engine_wait(IoEvent* events, int max_events, int timeout_ms);
+
+// 发送一帧：对端窗口已满或暂存不足且未写出任何字节时返回 false，由调用方稍后重试
+// io_uring 后端只做暂存，下一次 io_engine_wait（或 io_engine_flush）时统一提交；
+// epoll 后端直接写，写出部分字节后余下部分暂存，之后的帧排在其后。发送从不阻塞反应器
+bool io_engine_send(int fd, const char* data, size_t len);
+// 立即提交暂存的发送
+void io_engine_flush();
+
+IoEngineStats io_engine_stats();
@@ -1,4 +1,5 @@
 #include "json_utils.h"
+#include "message_handler.h"
 
 bool parse_json(const std::string& str, nlohmann::json& out_json) {
     try {
@@ -9,6 +10,15 @@ bool parse_json(const std::string& str, nlohmann::json& out_json) {
     }
 }
 
+bool parse_json(const char* data, size_t len, nlohmann::json& out_json) {
+    try {
+        out_json = nlohmann::json::parse(data, data + len);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
 std::string dump_json(const nlohmann::json& json_obj) {
     return json_obj.dump();
 }
@@ -133,26 +143,37 @@ nlohmann::json create_heartbeat() {
     return json_obj;
 }
 
-nlohmann::json create_status(const std::string& node_id, bool available, float load) {
+nlohmann::json create_status(const std::string& node_id, bool available, float load,
+                             const std::vector<std::string>& models, int capacity) {
     nlohmann::json json_obj;
     json_obj["type"] = "status";
     json_obj["node_id"] = node_id;
     json_obj["available"] = available;
     json_obj["load"] = load;
+    if (capacity > 0) json_obj["capacity"] = capacity;
+    if (!models.empty()) json_obj["models"] = models;
     return json_obj;
 } 
 
 // 新增：消息类序列化/反序列化
 bool parse_request_message(const std::string& json_str, RequestMessage& out_msg) {
+    return parse_request_message(json_str.data(), json_str.size(), out_msg);
+}
+
+bool parse_response_message(const std::string& json_str, ResponseMessage& out_msg) {
+    return parse_response_message(json_str.data(), json_str.size(), out_msg);
+}
+
+bool parse_request_message(const char* data, size_t len, RequestMessage& out_msg) {
     nlohmann::json json_obj;
-    if (!parse_json(json_str, json_obj) || !is_request(json_obj)) return false;
+    if (!parse_json(data, len, json_obj) || !is_request(json_obj)) return false;
     out_msg.from_json(json_obj);
     return true;
 }
 
-bool parse_response_message(const std::string& json_str, ResponseMessage& out_msg) {
+bool parse_response_message(const char* data, size_t len, ResponseMessage& out_msg) {
     nlohmann::json json_obj;
-    if (!parse_json(json_str, json_obj) || !is_response(json_obj)) return false;
+    if (!parse_json(data, len, json_obj) || !is_response(json_obj)) return false;
     out_msg.from_json(json_obj);
     return true;
 }
@@ -1,9 +1,15 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <nlohmann/json.hpp>
 
+class RequestMessage;
+class ResponseMessage;
+
 // 解析JSON字符串，返回nlohmann::json对象
 bool parse_json(const std::string& str, nlohmann::json& out_json);
+// 直接在接收缓冲上解析，省去构造 std::string 的拷贝
+bool parse_json(const char* data, size_t len, nlohmann::json& out_json);
 
 // 生成JSON字符串
 std::string dump_json(const nlohmann::json& json_obj);
@@ -33,10 +39,14 @@ nlohmann::json create_stream_response(const std::string& id, int client_socket,
 nlohmann::json create_error(const std::string& id, const std::string& message);
 nlohmann::json create_client_error(const std::string& id, const std::string& message);
 nlohmann::json create_heartbeat();
-nlohmann::json create_status(const std::string& node_id, bool available, float load = 0.0f); 
+// models 为节点已加载的模型，capacity 为并发流上限；为空/0 时不输出该字段
+nlohmann::json create_status(const std::string& node_id, bool available, float load = 0.0f,
+                             const std::vector<std::string>& models = {}, int capacity = 0);
 
 // 新增：消息类序列化/反序列化
 bool parse_request_message(const std::string& json_str, RequestMessage& out_msg);
 bool parse_response_message(const std::string& json_str, ResponseMessage& out_msg);
+bool parse_request_message(const char* data, size_t len, RequestMessage& out_msg);
+bool parse_response_message(const char* data, size_t len, ResponseMessage& out_msg);
 std::string dump_request_message(const RequestMessage& msg);
 std::string dump_response_message(const ResponseMessage& msg); 
\ No newline at end of file
@@ -168,8 +168,9 @@ std::string MessageHandler::build_heartbeat() {
     return dump_json(json_obj);
 }
 
-std::string MessageHandler::build_status(const std::string& node_id, bool available, float load) {
-    nlohmann::json json_obj = create_status(node_id, available, load);
+std::string MessageHandler::build_status(const std::string& node_id, bool available, float load,
+                                        const std::vector<std::string>& models, int capacity) {
+    nlohmann::json json_obj = create_status(node_id, available, load, models, capacity);
     return dump_json(json_obj);
 }
 
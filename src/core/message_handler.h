@@ -19,6 +19,11 @@ class Message {
 public:
     Message();
     virtual ~Message() = default;
+    // 声明了析构函数后不再隐式生成移动操作，显式补上，使 std::move 真正转移字符串而不是复制
+    Message(const Message&) = default;
+    Message(Message&&) = default;
+    Message& operator=(const Message&) = default;
+    Message& operator=(Message&&) = default;
     MessageType getType() const;
     void setType(MessageType t);
     const std::string& getId() const;
@@ -53,6 +58,8 @@ public:
     virtual nlohmann::json to_json() const;
 
 protected:
+    friend class MessageHandler;  // parse_message 直接填充各字段
+
     MessageType type;
     std::string id;
     std::string model;
@@ -108,7 +115,8 @@ public:
     
     static std::string build_heartbeat();
     
-    static std::string build_status(const std::string& node_id, bool available, float load = 0.0f);
+    static std::string build_status(const std::string& node_id, bool available, float load = 0.0f,
+                                    const std::vector<std::string>& models = {}, int capacity = 0);
     
     // 消息类型检查
     static bool is_request_message(const std::string& json_str);
@@ -0,0 +1,169 @@
+#include "model_router.h"
+#include <mutex>
+#include <cstring>
+
+struct ModelEntry {
+    char name[ROUTER_MODEL_NAME_SIZE];  // 空串表示空闲项
+    uint32_t warm_mask;                 // 已加载（或已分配、待确认）该模型的节点
+    uint32_t pending_mask;              // warm_mask 中尚待 status 确认的节点
+    int64_t pending_until[ROUTER_MAX_NODES];  // 待确认标记的到期时间
+    int sticky;                         // 上一次服务该模型的节点，-1 为无
+    uint64_t last_used;
+};
+
+struct NodeState {
+    bool reported;  // 收到过 status
+    NodeModelStatus status;
+};
+
+static std::mutex g_router_mutex;
+static ModelEntry g_models[ROUTER_MAX_MODELS];
+static NodeState g_nodes[ROUTER_MAX_NODES];
+static uint64_t g_use_clock = 0;
+
+// 表中的名称都短于 ROUTER_MODEL_NAME_SIZE（过长的不入表），整串比较，不会把共享前缀的名称当成同一个模型
+static ModelEntry* router_find(const char* model) {
+    for (auto& m : g_models) {
+        if (m.name[0] && strcmp(m.name, model) == 0) return &m;
+    }
+    return nullptr;
+}
+
+// 查找或新建模型项；表满时淘汰最久未用且没有热节点的项，都有热节点时返回 nullptr（不跟踪）。
+// 名称为空或不短于 ROUTER_MODEL_NAME_SIZE 时也返回 nullptr（客户端与节点两侧已拒绝过长的名称）
+static ModelEntry* router_find_or_add(const char* model) {
+    size_t len = strnlen(model, ROUTER_MODEL_NAME_SIZE);
+    if (len == 0 || len >= ROUTER_MODEL_NAME_SIZE) return nullptr;
+    ModelEntry* m = router_find(model);
+    if (m) return m;
+    ModelEntry* victim = nullptr;
+    for (auto& e : g_models) {
+        if (!e.name[0]) {
+            victim = &e;
+            break;
+        }
+        if (e.warm_mask == 0 && (!victim || e.last_used < victim->last_used)) victim = &e;
+    }
+    if (!victim) return nullptr;
+    memcpy(victim->name, model, len + 1);
+    victim->warm_mask = 0;
+    victim->pending_mask = 0;
+    victim->sticky = -1;
+    victim->last_used = g_use_clock;
+    return victim;
+}
+
+void model_router_reset() {
+    std::lock_guard<std::mutex> lock(g_router_mutex);
+    memset(g_models, 0, sizeof(g_models));
+    memset(g_nodes, 0, sizeof(g_nodes));
+    for (auto& m : g_models) m.sticky = -1;
+    g_use_clock = 0;
+}
+
+void model_router_update_node(int node, const NodeModelStatus& status, int64_t now_ms) {
+    if (node < 0 || node >= ROUTER_MAX_NODES) return;
+    std::lock_guard<std::mutex> lock(g_router_mutex);
+    g_nodes[node].reported = true;
+    g_nodes[node].status = status;
+    // 上报为准：先清掉该节点的热标记（未到期的待确认标记保留），再按列表重新标记并转正
+    uint32_t bit = 1u << node;
+    for (auto& m : g_models) {
+        if ((m.pending_mask & bit) && now_ms < m.pending_until[node]) continue;
+        m.warm_mask &= ~bit;
+        m.pending_mask &= ~bit;
+    }
+    int count = status.model_count < ROUTER_MAX_NODE_MODELS ? status.model_count : ROUTER_MAX_NODE_MODELS;
+    for (int i = 0; i < count; ++i) {
+        ModelEntry* m = router_find_or_add(status.models[i]);
+        if (!m) continue;
+        m->warm_mask |= bit;
+        m->pending_mask &= ~bit;
+    }
+}
+
+void model_router_remove_node(int node) {
+    if (node < 0 || node >= ROUTER_MAX_NODES) return;
+    std::lock_guard<std::mutex> lock(g_router_mutex);
+    g_nodes[node].reported = false;
+    uint32_t bit = 1u << node;
+    for (auto& m : g_models) {
+        m.warm_mask &= ~bit;
+        m.pending_mask &= ~bit;
+        if (m.sticky == node) m.sticky = -1;
+    }
+}
+
+static int node_capacity(int node) {
+    const NodeState& n = g_nodes[node];
+    return n.reported && n.status.capacity > 0 ? n.status.capacity : ROUTER_DEFAULT_CAPACITY;
+}
+
+// mask 中负载（在途数/容量）最低的节点；only_spare 时跳过满载节点
+static int router_least_loaded(uint32_t mask, const int64_t* inflight, int node_count, bool only_spare) {
+    int best = -1;
+    double best_score = 0;
+    for (int i = 0; i < node_count; ++i) {
+        if (!(mask & (1u << i))) continue;
+        int cap = node_capacity(i);
+        if (only_spare && inflight[i] >= cap) continue;
+        double score = (double)inflight[i] / cap;
+        if (best < 0 || score < best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+int model_router_select(const char* model, uint32_t connected_mask, const int64_t* inflight, int node_count,
+                        int64_t now_ms, bool& warm) {
+    warm = false;
+    if (node_count > ROUTER_MAX_NODES) node_count = ROUTER_MAX_NODES;
+    std::lock_guard<std::mutex> lock(g_router_mutex);
+    uint32_t eligible = 0;
+    for (int i = 0; i < node_count; ++i) {
+        bool available = !g_nodes[i].reported || g_nodes[i].status.available;
+        if ((connected_mask & (1u << i)) && available) eligible |= 1u << i;
+    }
+    if (!eligible) return -1;
+    ModelEntry* m = router_find_or_add(model ? model : "");
+    if (!m) return router_least_loaded(eligible, inflight, node_count, false);
+    m->last_used = ++g_use_clock;
+    uint32_t hot = m->warm_mask & eligible;
+    int s = m->sticky;
+    bool sticky_spare = s >= 0 && (eligible & (1u << s)) && inflight[s] < node_capacity(s);
+    int node = sticky_spare && (hot & (1u << s)) ? s : -1;
+    if (node < 0) node = router_least_loaded(hot, inflight, node_count, true);
+    if (node < 0 && sticky_spare) node = s;
+    if (node < 0) {
+        node = router_least_loaded(eligible & ~hot, inflight, node_count, true);
+        // 冷节点：先记为热节点（待确认），ROUTER_PENDING_MS 内等它的 status 列出该模型
+        if (node >= 0) {
+            m->warm_mask |= 1u << node;
+            m->pending_mask |= 1u << node;
+            m->pending_until[node] = now_ms + ROUTER_PENDING_MS;
+        }
+    }
+    if (node < 0) node = router_least_loaded(hot ? hot : eligible, inflight, node_count, false);
+    warm = (hot & (1u << node)) != 0;
+    m->sticky = node;
+    return node;
+}
+
+bool model_router_node_status(int node, NodeModelStatus& out) {
+    if (node < 0 || node >= ROUTER_MAX_NODES) return false;
+    std::lock_guard<std::mutex> lock(g_router_mutex);
+    if (!g_nodes[node].reported) return false;
+    out = g_nodes[node].status;
+    return true;
+}
+
+int model_router_model_count() {
+    std::lock_guard<std::mutex> lock(g_router_mutex);
+    int count = 0;
+    for (auto& m : g_models) {
+        if (m.name[0]) count++;
+    }
+    return count;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+
+// 按模型路由：节点在 status 消息中通告已加载的模型与并发容量，路由表维护 模型 -> 已加载该模型的节点。
+// 选择顺序：
+//   1. 已加载（热）且未满的节点，优先上一次服务该模型的节点（粘性），否则取负载最低者
+//   2. 粘性节点未满（它可能正在加载该模型，状态尚未上报）
+//   3. 未满的冷节点中负载最低者；选中后即视为该模型的热节点（待确认），后续请求跟随过去，
+//      不会把同一模型的首批请求撒到多个节点上同时加载
+//   4. 全部满载：热节点中负载最低者，没有热节点时取全部节点中负载最低者
+// 节点的 status 覆盖它的热模型集合；待确认的标记例外：status 列出该模型即转正，未列出时保留到
+// 分配后 ROUTER_PENDING_MS 才清除（节点加载期间的 status 不会把跟过去的请求又撒到别的节点）。
+// 从未发送 status 的节点视为可用、未加载任何模型。
+// 更新在反应器线程，选择在下发线程，内部加锁
+
+#define ROUTER_MAX_NODES 32           // 节点位图宽度，需不小于 MAX_NPU_NODES
+#define ROUTER_MAX_MODELS 32          // 路由表跟踪的模型数，满时淘汰最久未用且没有热节点的模型
+#define ROUTER_MAX_NODE_MODELS 8      // 单个节点通告的模型数上限，多出的忽略
+#define ROUTER_MODEL_NAME_SIZE 64          // 含结尾 0；更长的模型名在请求与 status 中均被拒绝，不截断
+#define ROUTER_DEFAULT_CAPACITY 8     // 节点未通告容量时按此判断是否满载
+#define ROUTER_PENDING_MS 30000       // 冷分配的待确认热标记最长保留时间
+
+// 节点在 status 消息中通告的状态
+struct NodeModelStatus {
+    bool available;    // false 时不再分配新请求，在途流不受影响
+    float load;        // 节点自报的负载（0~1），仅用于展示
+    int capacity;      // 并发流上限，<= 0 为未通告
+    int model_count;
+    char models[ROUTER_MAX_NODE_MODELS][ROUTER_MODEL_NAME_SIZE];
+};
+
+// 清空路由表与全部节点状态
+void model_router_reset();
+// 节点上报状态（反应器线程），now_ms 为单调时钟
+void model_router_update_node(int node, const NodeModelStatus& status, int64_t now_ms);
+// 节点断开或移除：清除其状态与在各模型上的热标记
+void model_router_remove_node(int node);
+// 为 model 选择节点：connected_mask 为已连接节点位图，inflight 为各节点在途请求数（node_count 项）。
+// now_ms 为单调时钟，用于待确认标记的到期。没有可用节点时返回 -1；warm 返回所选节点是否已加载该模型
+int model_router_select(const char* model, uint32_t connected_mask, const int64_t* inflight, int node_count,
+                        int64_t now_ms, bool& warm);
+// 读取节点最近一次上报的状态（管理端点展示），节点从未上报时返回 false
+bool model_router_node_status(int node, NodeModelStatus& out);
+// 当前跟踪的模型数
+int model_router_model_count();
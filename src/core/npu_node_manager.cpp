@@ -6,13 +6,56 @@
 #include <fcntl.h>
 #include <cstring>
 #include <cstdio>
+#include <cerrno>
+#include <poll.h>
+#include <mutex>
+#include <unordered_set>
 #include "task_manager.h"
-#include <etl/string.h>
+#include "io_engine.h"
+#include "conn_liveness.h"
 #include "json_utils.h"
+#include "model_router.h"
+#include "utils/metrics.h"
+#include "utils/logger.h"
+#include "utils/request_id.h"
 
 static NPUNodeList npu_nodes;
 static TaskManager* g_task_mgr = nullptr;
 
+// 每个节点的拼接缓冲：只存放跨越两个接收缓冲的半帧
+#define NPU_RX_BUF_SIZE (MAX_JSON_SIZE * 4)
+static char npu_rx_buf[MAX_NPU_NODES][NPU_RX_BUF_SIZE];
+static int npu_rx_len[MAX_NPU_NODES];
+static BufSlice npu_rx_tail[MAX_NPU_NODES];  // 接收缓冲末尾的半帧，只持有引用
+
+static NPUNodeStats npu_stats[MAX_NPU_NODES];
+static std::atomic<int> npu_stats_count(0);
+
+static_assert(MAX_NPU_NODES <= ROUTER_MAX_NODES, "model router bitmask too narrow");
+// 下发线程与反应器都会向节点发送：串行化同一节点上的 send，保证帧不交错，并保护 socket_fd/connected 的交接
+static std::mutex npu_send_mutex[MAX_NPU_NODES];
+// 每个节点上尚未结束的请求：下发线程登记，收到结束消息时注销，节点断开时其上的流全部判失败
+static std::unordered_set<uint64_t> npu_node_requests[MAX_NPU_NODES];
+static std::mutex npu_req_mutex[MAX_NPU_NODES];
+
+static void npu_track_request(int idx, uint64_t request_id) {
+    std::lock_guard<std::mutex> lock(npu_req_mutex[idx]);
+    npu_node_requests[idx].insert(request_id);
+}
+
+static bool npu_untrack_request(int idx, uint64_t request_id) {
+    std::lock_guard<std::mutex> lock(npu_req_mutex[idx]);
+    return npu_node_requests[idx].erase(request_id) > 0;
+}
+
+static void npu_update_connected_gauge() {
+    int connected = 0;
+    for (auto& n : npu_nodes) {
+        if (n.connected) connected++;
+    }
+    Metrics::setGauge(Metrics::Gauge::NPU_NODES_CONNECTED, connected);
+}
+
 // 设置全局 TaskManager 指针
 void npu_set_task_manager(TaskManager* task_mgr) {
     g_task_mgr = task_mgr;
@@ -20,68 +63,493 @@ void npu_set_task_manager(TaskManager* task_mgr) {
 
 void npu_node_manager_init() {
     npu_nodes.clear();
+    memset(npu_rx_len, 0, sizeof(npu_rx_len));
+    npu_stats_count.store(0, std::memory_order_release);
+    model_router_reset();
+    npu_update_connected_gauge();
 }
 
-bool npu_add_node(const char* ip, int port) {
-    if (npu_nodes.size() >= MAX_NPU_NODES) return false;
-    int fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (fd < 0) return false;
-    sockaddr_in addr{};
+static bool npu_parse_addr(const char* ip, int port, sockaddr_in& addr) {
+    addr = sockaddr_in{};
     addr.sin_family = AF_INET;
     addr.sin_port = htons(port);
-    if (inet_pton(AF_INET, ip, &addr.sin_addr) <= 0) {
-        close(fd);
-        return false;
+    return port > 0 && port < 65536 && inet_pton(AF_INET, ip, &addr.sin_addr) > 0;
+}
+
+static bool npu_same_addr(const sockaddr_in& a, const sockaddr_in& b) {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+// 节点所在槽位：同地址的槽优先，其次是已断开（且不在连接中）的槽，都没有时追加；槽满返回 -1
+static int npu_slot_for(const sockaddr_in& addr) {
+    for (size_t i = 0; i < npu_nodes.size(); ++i) {
+        if (npu_same_addr(npu_nodes[i].addr, addr)) return (int)i;
+    }
+    for (size_t i = 0; i < npu_nodes.size(); ++i) {
+        if (!npu_nodes[i].connected && !npu_nodes[i].connecting) return (int)i;
+    }
+    return npu_nodes.size() < MAX_NPU_NODES ? (int)npu_nodes.size() : -1;
+}
+
+// 连接建立后启用节点：引擎已启用时由反应器统一接收，否则由 npu_poll_receive 轮询
+static void npu_activate(int idx) {
+    auto& n = npu_nodes[idx];
+    liveness_apply_socket(n.socket_fd);
+    bool via_engine = io_engine_add(n.socket_fd, IoOwner::NPU);
+    npu_rx_len[idx] = 0;
+    npu_rx_tail[idx].reset();
+    NPUNodeStats& st = npu_stats[idx];
+    st.requests_sent.store(0, std::memory_order_relaxed);
+    st.messages_received.store(0, std::memory_order_relaxed);
+    st.tokens_received.store(0, std::memory_order_relaxed);
+    st.inflight.store(0, std::memory_order_relaxed);
+    int64_t now = liveness_now_ms();
+    st.last_tx_ms.store(now, std::memory_order_relaxed);
+    // 重连后节点需重新上报模型
+    model_router_remove_node(idx);
+    {
+        std::lock_guard<std::mutex> lock(npu_send_mutex[idx]);
+        n.via_engine = via_engine;
+        n.last_rx_ms = now;
+        n.connecting = false;
+        n.connected = true;
     }
-    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+    st.connected.store(true, std::memory_order_relaxed);
+    npu_update_connected_gauge();
+    LOG_INFO("NPU node %s connected", st.addr);
+}
+
+// 放弃正在建立的连接，槽位保留地址，下次配置同步时重试
+static void npu_abort_connect(int idx, const char* why) {
+    auto& n = npu_nodes[idx];
+    LOG_WARN("Failed to connect NPU node %s (%s)", npu_stats[idx].addr, why);
+    close(n.socket_fd);
+    n.connecting = false;
+}
+
+// 非阻塞连接的收尾：每轮以零超时检查一次，反应器从不等待连接建立
+static void npu_check_connecting(int64_t now) {
+    for (size_t i = 0; i < npu_nodes.size(); ++i) {
+        auto& n = npu_nodes[i];
+        if (!n.connecting) continue;
+        pollfd pfd = {n.socket_fd, POLLOUT, 0};
+        if (poll(&pfd, 1, 0) == 1) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(n.socket_fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) err = errno;
+            if (err == 0) npu_activate((int)i);
+            else npu_abort_connect((int)i, strerror(err));
+        } else if (now >= n.connect_deadline_ms) {
+            npu_abort_connect((int)i, "timed out");
+        }
+    }
+}
+
+bool npu_add_node(const char* ip, int port) {
+    sockaddr_in addr;
+    if (!npu_parse_addr(ip, port, addr)) return false;
+    int idx = npu_slot_for(addr);
+    if (idx < 0) return false;
+    if (idx < (int)npu_nodes.size() && (npu_nodes[idx].connected || npu_nodes[idx].connecting)) return true;
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    bool done = connect(fd, (const sockaddr*)&addr, sizeof(addr)) == 0;
+    if (!done && errno != EINPROGRESS) {
         close(fd);
         return false;
     }
-    fcntl(fd, F_SETFL, O_NONBLOCK);
-    npu_nodes.push_back({fd, addr, true});
+    snprintf(npu_stats[idx].addr, sizeof(npu_stats[idx].addr), "%s:%d", ip, port);
+    NPUNodeInfo info = {fd, addr, false, false, 0, true, liveness_now_ms() + NPU_CONNECT_TIMEOUT_MS};
+    {
+        std::lock_guard<std::mutex> lock(npu_send_mutex[idx]);
+        if (idx == (int)npu_nodes.size()) {
+            npu_nodes.push_back(info);
+            npu_stats_count.store(idx + 1, std::memory_order_release);
+        } else {
+            npu_nodes[idx] = info;
+        }
+    }
+    if (done) npu_activate(idx);
     return true;
 }
 
-void npu_close_all() {
+bool npu_remove_node(const char* ip, int port) {
+    sockaddr_in addr;
+    if (!npu_parse_addr(ip, port, addr)) return false;
     for (auto& n : npu_nodes) {
-        if (n.connected) close(n.socket_fd);
+        if (!n.connected || !npu_same_addr(n.addr, addr)) continue;
+        npu_on_closed(n.socket_fd);
+        return true;
     }
+    return false;
+}
+
+int npu_sync_nodes(const NPUNodeAddr* nodes, int count) {
+    // 先断开已移出配置的节点，空出的槽位可给新节点使用
+    for (auto& n : npu_nodes) {
+        if (!n.connected && !n.connecting) continue;
+        bool keep = false;
+        for (int i = 0; i < count && !keep; ++i) {
+            sockaddr_in addr;
+            keep = npu_parse_addr(nodes[i].ip, nodes[i].port, addr) && npu_same_addr(n.addr, addr);
+        }
+        if (keep) continue;
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &n.addr.sin_addr, ip, sizeof(ip));
+        LOG_INFO("NPU node %s:%d removed from config, disconnecting", ip, ntohs(n.addr.sin_port));
+        if (n.connecting) {
+            close(n.socket_fd);
+            n.connecting = false;
+            continue;
+        }
+        npu_on_closed(n.socket_fd);
+    }
+    int failed = 0;
+    for (int i = 0; i < count; ++i) {
+        if (npu_add_node(nodes[i].ip, nodes[i].port)) continue;
+        LOG_WARN("Failed to start connecting NPU node %s:%d", nodes[i].ip, nodes[i].port);
+        failed++;
+    }
+    return failed;
+}
+
+void npu_close_all() {
+    for (size_t i = 0; i < npu_nodes.size(); ++i) {
+        auto& n = npu_nodes[i];
+        if (n.connecting) {
+            close(n.socket_fd);
+            n.connecting = false;
+            continue;
+        }
+        if (n.connected) shutdown(n.socket_fd, SHUT_RDWR);  // 唤醒正在等待发送窗口的下发线程
+        std::lock_guard<std::mutex> lock(npu_send_mutex[i]);
+        if (!n.connected) continue;
+        if (n.via_engine) io_engine_remove(n.socket_fd);
+        close(n.socket_fd);
+        n.connected = false;
+        npu_stats[i].connected.store(false, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < MAX_NPU_NODES; ++i) {
+        std::lock_guard<std::mutex> lock(npu_req_mutex[i]);
+        npu_node_requests[i].clear();
+    }
+    for (auto& tail : npu_rx_tail) tail.reset();
     npu_nodes.clear();
+    npu_stats_count.store(0, std::memory_order_release);
+    model_router_reset();
+    npu_update_connected_gauge();
+}
+
+// 整帧写出（调用方持有该节点的发送锁），链路上不留半帧。窗口满时等待可写，最多 NPU_SEND_TIMEOUT_MS；
+// skip_if_full 时一个字节都没写出就放弃（心跳下次再发）。写出部分后失败则分帧已无法恢复：
+// shutdown 链路，反应器收到断开后按常规路径清理
+static bool npu_write_frame(int fd, const char* data, size_t len, bool skip_if_full) {
+    size_t off = 0;
+    int64_t deadline = 0;
+    while (off < len) {
+        ssize_t n = send(fd, data + off, len - off, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) {
+            off += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) break;
+        if (off == 0 && skip_if_full) return false;
+        int64_t now = liveness_now_ms();
+        if (!deadline) deadline = now + NPU_SEND_TIMEOUT_MS;
+        if (now >= deadline) break;
+        pollfd pfd = {fd, POLLOUT, 0};
+        poll(&pfd, 1, (int)(deadline - now));
+    }
+    if (off == len) return true;
+    if (off > 0) shutdown(fd, SHUT_RDWR);
+    return false;
 }
 
+// 下发线程也会调用：按已发布的节点数判断下标，槽位存储不会移动
 bool npu_send_to_node(int node_idx, const std::string& data) {
-    if (node_idx < 0 || node_idx >= (int)npu_nodes.size()) return false;
+    if (node_idx < 0 || node_idx >= npu_stats_count.load(std::memory_order_acquire)) return false;
     auto& n = npu_nodes[node_idx];
+    std::lock_guard<std::mutex> lock(npu_send_mutex[node_idx]);
     if (!n.connected) return false;
-    ssize_t sent = send(n.socket_fd, data.c_str(), data.size(), 0);
-    return sent == (ssize_t)data.size();
+    if (!npu_write_frame(n.socket_fd, data.data(), data.size(), false)) return false;
+    npu_stats[node_idx].last_tx_ms.store(liveness_now_ms(), std::memory_order_relaxed);
+    npu_stats[node_idx].requests_sent.fetch_add(1, std::memory_order_relaxed);
+    npu_stats[node_idx].inflight.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool npu_dispatch_task(int client_socket, uint64_t request_id, const RequestMessage& req) {
+    int count = npu_get_node_count();
+    uint32_t connected = 0;
+    int64_t inflight[MAX_NPU_NODES];
+    for (int i = 0; i < count; ++i) {
+        if (npu_stats[i].connected.load(std::memory_order_relaxed)) connected |= 1u << i;
+        inflight[i] = npu_stats[i].inflight.load(std::memory_order_relaxed);
+    }
+    bool warm = false;
+    int idx = model_router_select(req.getModel().c_str(), connected, inflight, count, liveness_now_ms(), warm);
+    if (idx < 0) {
+        Metrics::add(Metrics::Counter::REQUEST_UNROUTABLE);
+        return false;
+    }
+    char id[RequestId::TEXT_SIZE];
+    RequestId::format(request_id, id);
+    std::string frame = dump_json(create_task(id, client_socket, req.getModel(), req.getPrompt(),
+                                              req.getMaxTokens(), req.getStream()));
+    frame += '\n';
+    // 先登记再发送，节点在发送前后断开时都能由 npu_on_closed 判失败
+    npu_track_request(idx, request_id);
+    if (!npu_send_to_node(idx, frame)) {
+        // 登记已被 npu_on_closed 取走时流已判失败，不再让调用方重复处理
+        if (!npu_untrack_request(idx, request_id)) return true;
+        Metrics::add(Metrics::Counter::REQUEST_UNROUTABLE);
+        return false;
+    }
+    Metrics::add(warm ? Metrics::Counter::REQUEST_ROUTED_WARM : Metrics::Counter::REQUEST_ROUTED_COLD);
+    return true;
 }
 
 NPUNodeList* npu_get_node_list() {
     return &npu_nodes;
 }
 
-void npu_poll_receive() {
-    char buf[MAX_JSON_SIZE+1];
-    for (auto& n : npu_nodes) {
+int npu_get_node_count() {
+    return npu_stats_count.load(std::memory_order_acquire);
+}
+
+const NPUNodeStats* npu_get_node_stats(int node_idx) {
+    if (node_idx < 0 || node_idx >= npu_get_node_count()) return nullptr;
+    return &npu_stats[node_idx];
+}
+
+// 节点 status：可用性、负载、容量与已加载模型，交给模型路由表
+static void npu_handle_status(size_t i, const nlohmann::json& json_obj) {
+    NodeModelStatus st;
+    memset(&st, 0, sizeof(st));
+    st.available = true;
+    get_json_bool(json_obj, "available", st.available);
+    if (json_obj.contains("load") && json_obj["load"].is_number()) st.load = json_obj["load"].get<float>();
+    get_json_int(json_obj, "capacity", st.capacity);
+    if (json_obj.contains("models") && json_obj["models"].is_array()) {
+        for (const auto& m : json_obj["models"]) {
+            if (!m.is_string() || st.model_count >= ROUTER_MAX_NODE_MODELS) continue;
+            const std::string& name = m.get_ref<const std::string&>();
+            // 名称原样写入管理端 JSON，不接受需要转义的字符；过长的忽略（截断后会与别的模型混同）
+            bool plain = !name.empty() && name.size() < ROUTER_MODEL_NAME_SIZE;
+            for (char c : name) plain = plain && (unsigned char)c >= 0x20 && c != '"' && c != '\\';
+            if (!plain) continue;
+            memcpy(st.models[st.model_count], name.c_str(), name.size() + 1);
+            st.model_count++;
+        }
+    }
+    model_router_update_node((int)i, st, liveness_now_ms());
+}
+
+// 处理NPU节点的一条完整消息：流式token转发到TaskManager，结束消息标记流结束
+static bool npu_handle_message(size_t i, NPUNodeStats& st, const char* data, size_t len) {
+    ResponseMessage resp_msg;
+    if (!parse_response_message(data, len, resp_msg)) {
+        // 节点心跳只用于存活检测（收到数据时已刷新 last_rx_ms），识别出来直接丢弃
+        nlohmann::json json_obj;
+        if (!parse_json(data, len, json_obj)) return false;
+        if (is_status(json_obj)) {
+            npu_handle_status(i, json_obj);
+            return true;
+        }
+        return is_heartbeat(json_obj);
+    }
+    Metrics::add(Metrics::Counter::NPU_MESSAGES);
+    st.messages_received.fetch_add(1, std::memory_order_relaxed);
+    // 网关下发的 id 都是 RequestId 文本，解析不了的不属于任何在途流
+    uint64_t request_id;
+    const std::string& id = resp_msg.getId();
+    if (!RequestId::parse(id.data(), id.size(), request_id)) return true;
+    if (!resp_msg.getToken().empty()) st.tokens_received.fetch_add(1, std::memory_order_relaxed);
+    if (resp_msg.getFinished()) {
+        npu_untrack_request((int)i, request_id);
+        if (st.inflight.load(std::memory_order_relaxed) > 0) st.inflight.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (!g_task_mgr) return true;
+    if (!resp_msg.getToken().empty()) {
+        npu_forward_token(request_id, resp_msg.getToken().c_str());
+    }
+    if (resp_msg.getFinished()) {
+        g_task_mgr->markTokenStreamFinished(request_id);
+    }
+    return true;
+}
+
+// 把跨缓冲的半帧追加到节点拼接缓冲；放不下时丢弃整帧
+static void npu_rx_append(size_t i, const char* data, size_t len) {
+    int& rx = npu_rx_len[i];
+    if (len > (size_t)(NPU_RX_BUF_SIZE - rx)) {
+        rx = 0;
+        return;
+    }
+    memcpy(npu_rx_buf[i] + rx, data, len);
+    rx += (int)len;
+}
+
+// 按 '\n' 分帧，一次接收可能包含多个 token 消息。完整的帧直接在接收缓冲上解析；
+// 末尾的半帧只持有缓冲引用，下一段数据到达后再拼接，只有跨缓冲的帧需要拷贝
+static void npu_feed(size_t i, RecvBuf* buf, const char* data, size_t len) {
+    NPUNodeStats& st = npu_stats[i];
+    BufSlice& tail = npu_rx_tail[i];
+    int& rx = npu_rx_len[i];
+    const char* p = data;
+    const char* end = data + len;
+    if (!tail.empty() || rx > 0) {
+        const char* nl = (const char*)memchr(p, '\n', len);
+        if (!tail.empty()) {
+            npu_rx_append(i, tail.data(), tail.size());
+            tail.reset();
+        }
+        npu_rx_append(i, p, (nl ? nl : end) - p);
+        if (!nl) {
+            // 兼容不分帧的节点：能解析即按整条消息处理
+            if (npu_handle_message(i, st, npu_rx_buf[i], rx)) rx = 0;
+            return;
+        }
+        if (rx > 0) npu_handle_message(i, st, npu_rx_buf[i], rx);
+        rx = 0;
+        p = nl + 1;
+    }
+    while (p < end) {
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        if (!nl) break;
+        if (nl > p) npu_handle_message(i, st, p, nl - p);
+        p = nl + 1;
+    }
+    if (p == end) return;
+    if (p == data && npu_handle_message(i, st, p, end - p)) return;
+    if (buf) tail = BufSlice(buf, p, end - p);
+    else npu_rx_append(i, p, end - p);
+}
+
+static int npu_find_node(int socket_fd) {
+    for (size_t i = 0; i < npu_nodes.size(); ++i) {
+        if (npu_nodes[i].connected && npu_nodes[i].socket_fd == socket_fd) return (int)i;
+    }
+    return -1;
+}
+
+void npu_on_data(int socket_fd, RecvBuf* buf, const char* data, int len) {
+    int idx = npu_find_node(socket_fd);
+    if (idx < 0 || len <= 0) return;
+    npu_nodes[idx].last_rx_ms = liveness_now_ms();
+    npu_feed(idx, buf, data, (size_t)len);
+}
+
+void npu_on_closed(int socket_fd) {
+    int idx = npu_find_node(socket_fd);
+    if (idx < 0) return;
+    auto& n = npu_nodes[idx];
+    shutdown(n.socket_fd, SHUT_RDWR);  // 唤醒正在等待发送窗口的下发线程
+    {
+        std::lock_guard<std::mutex> lock(npu_send_mutex[idx]);
+        if (n.via_engine) io_engine_remove(n.socket_fd);
+        close(n.socket_fd);
+        n.connected = false;
+        npu_stats[idx].connected.store(false, std::memory_order_relaxed);
+    }
+    npu_rx_len[idx] = 0;
+    npu_rx_tail[idx].reset();
+    model_router_remove_node(idx);
+    npu_update_connected_gauge();
+    // 节点上的在途流不会再有 token：已到达的照常投递，之后给客户端回错误帧
+    std::unordered_set<uint64_t> lost;
+    {
+        std::lock_guard<std::mutex> lock(npu_req_mutex[idx]);
+        lost.swap(npu_node_requests[idx]);
+    }
+    npu_stats[idx].inflight.store(0, std::memory_order_relaxed);
+    if (!lost.empty()) LOG_WARN("NPU node %s lost with %zu streams in flight", npu_stats[idx].addr, lost.size());
+    for (uint64_t id : lost) {
+        Metrics::add(Metrics::Counter::STREAM_NODE_LOST);
+        if (g_task_mgr) g_task_mgr->failStream(id, "NPU node disconnected");
+    }
+}
+
+// 链路空闲时补发心跳；发送失败（窗口满）不影响判定，失联只看是否收到消息
+// 下发线程正持锁发送时链路并不空闲，直接跳过，反应器不等锁
+static void npu_send_heartbeat(size_t i, NPUNodeInfo& n, int64_t now) {
+    static const std::string frame = dump_json(create_heartbeat()) + "\n";
+    NPUNodeStats& st = npu_stats[i];
+    if (now - st.last_tx_ms.load(std::memory_order_relaxed) < liveness_config().npu_heartbeat_ms) return;
+    std::unique_lock<std::mutex> lock(npu_send_mutex[i], std::try_to_lock);
+    if (!lock.owns_lock()) return;
+    if (npu_write_frame(n.socket_fd, frame.data(), frame.size(), true)) {
+        st.last_tx_ms.store(now, std::memory_order_relaxed);
+    }
+}
+
+static void npu_check_liveness(int64_t now) {
+    const LivenessConfig& cfg = liveness_config();
+    for (size_t i = 0; i < npu_nodes.size(); ++i) {
+        auto& n = npu_nodes[i];
         if (!n.connected) continue;
-        ssize_t nread = recv(n.socket_fd, buf, MAX_JSON_SIZE, MSG_DONTWAIT);
+        if (cfg.npu_dead_ms && now - n.last_rx_ms >= cfg.npu_dead_ms) {
+            LOG_WARN("NPU node %s silent for %lld ms, disconnecting", npu_stats[i].addr, (long long)(now - n.last_rx_ms));
+            Metrics::add(Metrics::Counter::NPU_LIVENESS_TIMEOUT);
+            npu_on_closed(n.socket_fd);
+            continue;
+        }
+        if (cfg.npu_heartbeat_ms) npu_send_heartbeat(i, n, now);
+    }
+}
+
+int npu_next_timer_ms(int64_t now_ms) {
+    const LivenessConfig& cfg = liveness_config();
+    int64_t next = -1;
+    for (size_t i = 0; i < npu_nodes.size(); ++i) {
+        auto& n = npu_nodes[i];
+        if (n.connecting) {
+            int64_t due = now_ms + NPU_CONNECT_POLL_MS;
+            if (next < 0 || due < next) next = due;
+            continue;
+        }
+        if (!n.connected) continue;
+        if (cfg.npu_dead_ms) {
+            int64_t due = n.last_rx_ms + cfg.npu_dead_ms;
+            if (next < 0 || due < next) next = due;
+        }
+        if (cfg.npu_heartbeat_ms) {
+            int64_t due = npu_stats[i].last_tx_ms.load(std::memory_order_relaxed) + cfg.npu_heartbeat_ms;
+            if (next < 0 || due < next) next = due;
+        }
+    }
+    if (next < 0) return -1;
+    return next > now_ms ? (int)(next - now_ms) : 0;
+}
+
+void npu_poll_receive() {
+    int64_t now = liveness_now_ms();
+    npu_check_connecting(now);
+    npu_check_liveness(now);
+    // 内存背压只暂停客户端（见 MemBudget）：节点链路上还有结束、失败与控制消息，
+    // 停读会让积压无法释放而死锁，慢客户端由单流配额取消
+    for (size_t i = 0; i < npu_nodes.size(); ++i) {
+        auto& n = npu_nodes[i];
+        // 数据由反应器经 npu_on_data 送达
+        if (!n.connected || n.via_engine) continue;
+        RecvBuf* buf = BufPool::acquire();
+        if (!buf) continue;
+        ssize_t nread = recv(n.socket_fd, buf->data, BUFPOOL_BUF_SIZE, MSG_DONTWAIT);
         if (nread > 0) {
-            buf[nread] = 0;
-            // 直接解析为ResponseMessage
-            ResponseMessage resp_msg;
-            if (parse_response_message(std::string(buf), resp_msg)) {
-                // 可选：处理request_id/token等逻辑
-                if (g_task_mgr) {
-                    g_task_mgr->pushResponse(n.socket_fd, resp_msg, true);
-                }
-            }
+            n.last_rx_ms = liveness_now_ms();
+            npu_feed(i, buf, buf->data, (size_t)nread);
+        }
+        BufPool::release(buf);
+        // 对端关闭或发送侧因半帧 shutdown 了链路
+        if (nread == 0 || (nread < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            npu_on_closed(n.socket_fd);
         }
     }
 }
 
-void npu_forward_token(const etl::string<64>& request_id, const char* token) {
+void npu_forward_token(uint64_t request_id, const char* token) {
     if (g_task_mgr) {
         g_task_mgr->addToken(request_id, token);
     }
-} 
\ No newline at end of file
+}
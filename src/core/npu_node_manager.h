@@ -1,32 +1,84 @@
 #pragma once
 #include <etl/vector.h>
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <netinet/in.h>
-#include <etl/string.h>
+#include "utils/buf_pool.h"
+
+class RequestMessage;
+class TaskManager;
 
 #define MAX_NPU_NODES 8
 #define MAX_JSON_SIZE 2048
+#define NPU_CONNECT_TIMEOUT_MS 1000  // 连接节点的最长等待时间，超时放弃，下次配置同步时重试
+#define NPU_CONNECT_POLL_MS 10       // 有连接正在建立时事件循环的最长等待
+#define NPU_SEND_TIMEOUT_MS 1000     // 发送窗口满时写完一帧的最长等待，超时断开该节点
 
 struct NPUNodeInfo {
     int socket_fd;
     sockaddr_in addr;
     bool connected;
+    bool via_engine;  // 已注册到 I/O 引擎，由反应器接收数据
+    int64_t last_rx_ms;  // 最近一次收到任何数据（含心跳，单调时钟）
+    bool connecting;     // 非阻塞连接尚未完成，槽位已占用但不参与下发
+    int64_t connect_deadline_ms;
 };
 using NPUNodeList = etl::vector<NPUNodeInfo, MAX_NPU_NODES>;
 
+// 配置中的节点地址
+struct NPUNodeAddr {
+    char ip[INET_ADDRSTRLEN];
+    int port;
+};
+
+// 节点统计：由轮询线程写入，管理端可在任意线程只读
+struct NPUNodeStats {
+    char addr[32];                            // "ip:port"
+    std::atomic<bool> connected;
+    std::atomic<uint64_t> requests_sent;
+    std::atomic<uint64_t> messages_received;
+    std::atomic<uint64_t> tokens_received;
+    std::atomic<int64_t> inflight;            // 已下发、尚未收到结束消息的请求数
+    std::atomic<int64_t> last_tx_ms;          // 最近一次发出数据（下发线程与反应器都会写）
+};
+
 // 初始化NPU节点管理
 void npu_node_manager_init();
-// 添加NPU节点
+// 添加NPU节点：同一地址已连接或正在连接时直接返回 true，已断开时在原槽位重连；
+// 新地址优先复用已断开节点的槽位。连接在后台完成（见 npu_poll_receive），反应器不等待，
+// 只有地址无效、槽满或 connect 立即失败时返回 false
 bool npu_add_node(const char* ip, int port);
+// 移除NPU节点：断开连接并空出槽位，该节点上的在途流不再有 token 到达
+bool npu_remove_node(const char* ip, int port);
+// 按配置的节点列表对齐：断开不在列表中的节点，连接（或重连）列表中未连接的节点。
+// 其余节点及其在途流不受影响，返回未能发起连接的节点数（连接结果稍后在日志中给出）
+int npu_sync_nodes(const NPUNodeAddr* nodes, int count);
 // 关闭所有NPU节点
 void npu_close_all();
 // 发送数据到某个NPU节点
 bool npu_send_to_node(int node_idx, const std::string& data);
-// 轮询接收NPU节点数据（流式）
+// 按请求的模型选择节点并下发 task（可在下发线程调用）：优先已加载该模型的节点，见 model_router.h。
+// request_id 只在写入 task 帧时渲染为文本，节点回传的 id 按同一格式解析回整数。
+// 没有可用节点或发送失败时返回 false
+bool npu_dispatch_task(int client_socket, uint64_t request_id, const RequestMessage& req);
+// 轮询接收未注册到 I/O 引擎的NPU节点数据（流式）；节点链路不受内存背压影响，始终照常读取。
+// 同时完成正在建立的连接（零超时检查），并做心跳与存活检查：链路空闲时发心跳，
+// 超过失联时间没有任何消息的节点被断开
 void npu_poll_receive();
+// 距下一次心跳/存活检查的毫秒数，供事件循环设置等待超时；有连接正在建立时不超过 NPU_CONNECT_POLL_MS；
+// 没有需要检查的节点时返回 -1
+int npu_next_timer_ms(int64_t now_ms);
+// 反应器收到节点数据/连接断开时调用
+// buf 为数据所在的接收缓冲，未凑成完整消息的尾部会持有它的引用
+void npu_on_data(int socket_fd, RecvBuf* buf, const char* data, int len);
+void npu_on_closed(int socket_fd);
 // 获取NPU节点列表
 NPUNodeList* npu_get_node_list();
+// 获取节点统计（线程安全）
+int npu_get_node_count();
+const NPUNodeStats* npu_get_node_stats(int node_idx);
 // 设置全局 TaskManager 指针
 void npu_set_task_manager(TaskManager* task_mgr);
 // 转发NPU流式token到TaskManager
-void npu_forward_token(const etl::string<64>& request_id, const char* token); 
\ No newline at end of file
+void npu_forward_token(uint64_t request_id, const char* token);
\ No newline at end of file
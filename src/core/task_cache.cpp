@@ -1,11 +1,66 @@
 #include "task_cache.h"
+#include "utils/metrics.h"
+#include "utils/clock.h"
+#include "utils/mem_budget.h"
 #include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+TaskCache::TaskCache(size_t max_tasks, size_t shard_count)
+    : shards_(nullptr), shard_mask_(0), max_tasks_(max_tasks), size_(0) {
+    size_t n = 1;
+    while (n < shard_count) n <<= 1;
+    // C++14 的 new 不保证超过 alignof(max_align_t) 的对齐，与 DispatchPool 一样按缓存行分配后原地构造
+    void* mem = nullptr;
+    if (posix_memalign(&mem, alignof(Shard), n * sizeof(Shard)) != 0) throw std::bad_alloc();
+    shards_ = static_cast<Shard*>(mem);
+    for (size_t i = 0; i < n; ++i) new (&shards_[i]) Shard();
+    shard_mask_ = n - 1;
+    
+    // 预留桶，避免运行期 rehash
+    size_t per_shard = max_tasks_ / n + 1;
+    for (size_t i = 0; i < n; ++i) {
+        shards_[i].tasks.reserve(per_shard);
+    }
+}
+
+// 任务计入内存预算的字节数：上下文本身加 prompt 副本
+static size_t taskBytes(const TaskContext* task) {
+    return sizeof(TaskContext) + task->getRequest().getPrompt().size();
+}
+
+TaskCache::~TaskCache() {
+    for (size_t i = 0; i <= shard_mask_; ++i) {
+        for (auto& pair : shards_[i].tasks) {
+            MemBudget::release(MemBudget::Category::TASK, taskBytes(pair.second));
+            delete pair.second;
+        }
+        shards_[i].~Shard();
+    }
+    free(shards_);
+    shards_ = nullptr;
+}
+
+TaskCache::Shard& TaskCache::shardFor(const std::string& request_id) {
+    return shards_[std::hash<std::string>()(request_id) & shard_mask_];
+}
 
 TaskContext* TaskCache::createTask(const std::string& request_id, int client_socket, 
                                    const RequestMessage& request, int priority) {
-    std::lock_guard<std::mutex> lock(cache_mutex_);
+    // 先占用容量名额，超出上限则回退
+    if (size_.fetch_add(1, std::memory_order_relaxed) >= max_tasks_) {
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    
+    Shard& shard = shardFor(request_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
     
-    if (task_cache_.size() >= MAX_TASKS) return nullptr;
+    if (shard.tasks.find(request_id) != shard.tasks.end()) {
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return nullptr;
+    }
     
     TaskContext* task = new TaskContext();
     
@@ -14,59 +69,67 @@ TaskContext* TaskCache::createTask(const std::string& request_id, int client_soc
     task->client_socket = client_socket;
     task->request = request;
     task->status = TaskStatus::PENDING;
-    task->create_time = getCurrentTimestamp();
+    task->create_time = Clock::wallMs();
+    task->setCreateNs(Metrics::nowNs());
     task->priority = priority;
     
     // 添加到缓存池
-    task_cache_.insert(std::make_pair(request_id, task));
+    shard.tasks.insert(std::make_pair(request_id, task));
+    MemBudget::charge(MemBudget::Category::TASK, taskBytes(task));
     
     return task;
 }
 
 TaskContext* TaskCache::getTask(const std::string& request_id) {
-    std::lock_guard<std::mutex> lock(cache_mutex_);
-    auto it = task_cache_.find(request_id);
-    return (it != task_cache_.end()) ? it->second : nullptr;
+    Shard& shard = shardFor(request_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.tasks.find(request_id);
+    return (it != shard.tasks.end()) ? it->second : nullptr;
 }
 
 void TaskCache::updateTaskStatus(const std::string& request_id, TaskStatus status) {
-    std::lock_guard<std::mutex> lock(cache_mutex_);
-    auto it = task_cache_.find(request_id);
-    if (it != task_cache_.end()) {
+    Shard& shard = shardFor(request_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.tasks.find(request_id);
+    if (it != shard.tasks.end()) {
         it->second->status = status;
     }
 }
 
 void TaskCache::completeTask(const std::string& request_id) {
-    std::lock_guard<std::mutex> lock(cache_mutex_);
-    auto it = task_cache_.find(request_id);
-    if (it != task_cache_.end()) {
-        TaskContext* task = it->second;
-        task_cache_.erase(it);
-        delete task;
+    TaskContext* task = nullptr;
+    {
+        Shard& shard = shardFor(request_id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.tasks.find(request_id);
+        if (it == shard.tasks.end()) return;
+        task = it->second;
+        shard.tasks.erase(it);
     }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    MemBudget::release(MemBudget::Category::TASK, taskBytes(task));
+    // 在锁外释放，缩短临界区
+    delete task;
 }
 
 void TaskCache::getTasksByStatus(TaskStatus status, std::vector<TaskContext*>& tasks) {
-    std::lock_guard<std::mutex> lock(cache_mutex_);
     tasks.clear();
     
-    for (auto& pair : task_cache_) {
-        if (pair.second->status == status) {
-            tasks.push_back(pair.second);
+    for (size_t i = 0; i <= shard_mask_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        for (auto& pair : shards_[i].tasks) {
+            if (pair.second->status == status) {
+                tasks.push_back(pair.second);
+            }
         }
     }
 }
 
 size_t TaskCache::getSize() const {
-    return task_cache_.size();
+    return size_.load(std::memory_order_relaxed);
 }
 
 bool TaskCache::isFull() const {
-    return task_cache_.size() >= MAX_TASKS;
+    return size_.load(std::memory_order_relaxed) >= max_tasks_;
 }
 
-long long TaskCache::getCurrentTimestamp() {
-    return std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
-} 
\ No newline at end of file
@@ -2,22 +2,24 @@
 #include <unordered_map>
 #include <string>
 #include <mutex>
+#include <atomic>
 #include <vector>
 #include "task_context.h"
 
 // 任务缓存池 - 负责所有任务的存储和查找
+// 按 request_id 哈希分片，每个分片独立加锁，降低客户端线程与NPU线程之间的锁竞争
 class TaskCache {
-private:
-    static constexpr size_t MAX_TASKS = 128;
-    
-    // 主缓存池：存储所有任务
-    std::unordered_map<std::string, TaskContext*> task_cache_;
+public:
+    static constexpr size_t DEFAULT_MAX_TASKS = 4096;
+    static constexpr size_t DEFAULT_SHARD_COUNT = 16;
     
-    std::mutex cache_mutex_;
+    // shard_count 会向上取整为2的幂
+    explicit TaskCache(size_t max_tasks = DEFAULT_MAX_TASKS, size_t shard_count = DEFAULT_SHARD_COUNT);
+    ~TaskCache();
     
-public:
-    TaskCache() = default;
-    ~TaskCache() = default;
+    // 禁用拷贝
+    TaskCache(const TaskCache&) = delete;
+    TaskCache& operator=(const TaskCache&) = delete;
     
     // 创建新任务
     TaskContext* createTask(const std::string& request_id, int client_socket, 
@@ -41,6 +43,22 @@ public:
     // 检查是否已满
     bool isFull() const;
     
+    // 容量与分片数
+    size_t getCapacity() const { return max_tasks_; }
+    size_t getShardCount() const { return shard_mask_ + 1; }
+    
 private:
-    long long getCurrentTimestamp();
-}; 
\ No newline at end of file
+    // 分片：独占缓存行，避免相邻分片的锁伪共享
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, TaskContext*> tasks;
+    };
+    
+    Shard& shardFor(const std::string& request_id);
+    
+    Shard* shards_;
+    size_t shard_mask_;
+    size_t max_tasks_;
+    // 全局任务计数，getSize/isFull 无需加锁
+    std::atomic<size_t> size_;
+};
@@ -1,12 +1,27 @@
 #include "task_context.h"
 
+SlabPool& TaskContext::pool() {
+    static SlabPool instance;
+    return instance;
+}
+
+void* TaskContext::operator new(size_t size) {
+    void* p = size <= pool().slotSize() ? pool().alloc() : nullptr;
+    return p ? p : ::operator new(size);
+}
+
+void TaskContext::operator delete(void* p) {
+    if (pool().owns(p)) pool().free(p);
+    else ::operator delete(p);
+}
+
 TaskContext::TaskContext()
     : client_socket(-1), status(TaskStatus::PENDING),
-      create_time(0), assign_time(0), complete_time(0), priority(0) {}
+      create_time(0), assign_time(0), complete_time(0), create_ns(0), priority(0) {}
 
 TaskContext::TaskContext(const std::string& request_id, int client_socket, const RequestMessage& request, int priority)
     : request_id(request_id), client_socket(client_socket), request(request), status(TaskStatus::PENDING),
-      create_time(0), assign_time(0), complete_time(0), priority(priority) {}
+      create_time(0), assign_time(0), complete_time(0), create_ns(0), priority(priority) {}
 
 const std::string& TaskContext::getRequestId() const { return request_id; }
 void TaskContext::setRequestId(const std::string& id) { request_id = id; }
@@ -24,6 +39,8 @@ long long TaskContext::getAssignTime() const { return assign_time; }
 void TaskContext::setAssignTime(long long t) { assign_time = t; }
 long long TaskContext::getCompleteTime() const { return complete_time; }
 void TaskContext::setCompleteTime(long long t) { complete_time = t; }
+long long TaskContext::getCreateNs() const { return create_ns; }
+void TaskContext::setCreateNs(long long t) { create_ns = t; }
 int TaskContext::getPriority() const { return priority; }
 void TaskContext::setPriority(int p) { priority = p; }
 const std::string& TaskContext::getErrorMsg() const { return error_msg; }
@@ -1,8 +1,9 @@
 #pragma once
 #include <string>
 #include <chrono>
-#include "data_structures.h"
+#include "common/data_structures.h"
 #include "message_handler.h"
+#include "utils/prealloc.h"
 #include <nlohmann/json.hpp>
 
 // 任务上下文结构
@@ -10,6 +11,11 @@ class TaskContext {
 public:
     TaskContext();
     TaskContext(const std::string& request_id, int client_socket, const RequestMessage& request, int priority = 0);
+
+    // 预分配模式下上下文对象从池中分配
+    static SlabPool& pool();
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
     // getter/setter
     const std::string& getRequestId() const;
     void setRequestId(const std::string& id);
@@ -27,6 +33,8 @@ public:
     void setAssignTime(long long t);
     long long getCompleteTime() const;
     void setCompleteTime(long long t);
+    long long getCreateNs() const;
+    void setCreateNs(long long t);
     int getPriority() const;
     void setPriority(int p);
     const std::string& getErrorMsg() const;
@@ -34,6 +42,9 @@ public:
     nlohmann::json to_json() const;
     void from_json(const nlohmann::json& j);
 private:
+    // 缓存与管理器在创建、分配、完成时直接改写状态字段
+    friend class TaskCache;
+    friend class TaskManager;
     std::string request_id;
     int client_socket;
     RequestMessage request;
@@ -42,6 +53,7 @@ private:
     long long create_time;
     long long assign_time;
     long long complete_time;
+    long long create_ns;    // 单调时钟创建时间（纳秒），用于延迟统计
     int priority;
     std::string error_msg;
 }; 
\ No newline at end of file
@@ -1,15 +1,43 @@
 #include "task_manager.h"
-#include "inference_node_manager.h"
+#include "npu_node_manager.h"
+#include "utils/thread_topology.h"
 #include <chrono>
+#include <algorithm>
+#include <new>
 
-TaskManager::TaskManager() : running(false), node_manager_(nullptr) {}
-TaskManager::~TaskManager() { stop(); }
+static size_t align64(size_t n) {
+    return (n + 63) & ~(size_t)63;
+}
 
-bool TaskManager::start(InferenceNodeManager* node_manager) {
+TaskManager::TaskManager(size_t max_cached_tasks, size_t max_streams)
+    : running(false), slots_(nullptr), slot_count_(0), slots_mapped_(0), free_head_(NIL), follower_count_(0), coalesced_count_(0),
+      coalesce_(true), task_cache_(max_cached_tasks),
+      dispatch_pool_(MAX_TASKS) {
+    slots_ = (StreamState*)Prealloc::allocTable(align64(sizeof(StreamState) * max_streams), slots_mapped_);
+    if (!slots_ || !streams_.init(max_streams) || !leaders_.init(max_streams)) return;
+    for (size_t i = max_streams; i > 0; --i) {
+        StreamState* st = new (&slots_[i - 1]) StreamState();
+        st->id = 0;
+        st->next = free_head_;
+        free_head_ = (uint32_t)(i - 1);
+    }
+    slot_count_ = max_streams;
+}
+
+TaskManager::~TaskManager() {
+    stop();
+    for (size_t i = 0; i < slot_count_; ++i) slots_[i].~StreamState();
+    Prealloc::freeTable(slots_, slots_mapped_);
+}
+
+size_t TaskManager::streamTableBytes(size_t max_streams) {
+    return align64(sizeof(StreamState) * max_streams) + 2 * align64(IdTable::bytesFor(max_streams));
+}
+
+bool TaskManager::start(int dispatch_workers) {
     if (running.load()) return false;
-    node_manager_ = node_manager;
+    if (!dispatch_pool_.start(dispatch_workers, [this](Task& task) { dispatchTask(task); })) return false;
     running.store(true);
-    task_thread = std::thread(&TaskManager::taskLoop, this);
     response_thread = std::thread(&TaskManager::responseLoop, this);
     return true;
 }
@@ -17,95 +45,262 @@ bool TaskManager::start(InferenceNodeManager* node_manager) {
 void TaskManager::stop() {
     if (!running.load()) return;
     running.store(false);
-    if (task_thread.joinable()) task_thread.join();
+    dispatch_pool_.stop();
     if (response_thread.joinable()) response_thread.join();
 }
 
-void TaskManager::pushRequest(int client_socket, const RequestMessage& request) {
-    if (!input_queue.full()) {
-        input_queue.push(Task{client_socket, request, ResponseMessage(), false, ""});
+bool TaskManager::pushRequest(int client_socket, uint64_t request_id, RequestMessage&& request) {
+    std::lock_guard<std::mutex> lock(token_mutex_);
+    if (streams_.find(request_id) != NIL) return false;
+    uint32_t s = allocStream(request_id, client_socket);
+    if (s == NIL) return false;
+    StreamState& st = slots_[s];
+    st.start_ns = Metrics::nowNs();
+    uint64_t key = 0;
+    if (coalesce_.load(std::memory_order_relaxed)) {
+        key = makeCoalesceKey(request);
+        uint32_t leader = leaders_.find(key);
+        if (leader != NIL && sameRequest(slots_[leader].request, request)) {
+            // 已有相同请求在途：挂到 leader 的 token 流上，不再下发NPU；保留自己的请求，接替 leader 时重新下发
+            st.request = std::move(request);
+            attachFollower(leader, s);
+            Metrics::add(Metrics::Counter::TASK_CREATED);
+            Metrics::add(Metrics::Counter::TASK_COALESCED);
+            Trace::mark(request_id, Trace::Stage::ENQUEUE);
+            return true;
+        }
+        if (leader != NIL) key = 0;  // 哈希碰撞：各自下发，不登记
     }
+    // 登记为 leader 的请求留一份在槽中供后来者比对，其余直接交给下发任务
+    if (key) st.request = request;
+    // 持锁提交：相同请求在登记为 leader 之前不会另行下发
+    if (!submitTask(Task{client_socket, request_id, 0, std::move(request), ResponseMessage(), false, std::string()})) {
+        freeStream(s);
+        return false;
+    }
+    if (key) {
+        leaders_.insert(key, s);
+        st.coalesce_key = key;
+    }
+    Metrics::add(Metrics::Counter::TASK_CREATED);
+    Trace::mark(request_id, Trace::Stage::ENQUEUE);
+    return true;
+}
+
+bool TaskManager::submitTask(Task&& task) {
+    size_t bytes = sizeof(Task) + task.request_data.getPrompt().size();
+    // 先计入预算：任务提交后可能立即被下发线程取走并释放
+    MemBudget::charge(MemBudget::Category::REQUEST, bytes);
+    task.enqueue_ns = Metrics::nowNs();
+    int key = task.client_socket;
+    if (!dispatch_pool_.submit(key, std::move(task))) {
+        MemBudget::release(MemBudget::Category::REQUEST, bytes);
+        return false;
+    }
+    return true;
 }
 
 void TaskManager::pushResponse(int client_socket, const ResponseMessage& response, bool success, const std::string& error_msg) {
+    std::lock_guard<std::mutex> lock(output_mutex_);
     if (!output_queue.full()) {
-        output_queue.push(Task{client_socket, RequestMessage(), response, true, error_msg});
+        output_queue.push(Task{client_socket, 0, 0, RequestMessage(), response, true, error_msg});
     }
 }
 
 bool TaskManager::popFinishedResponse(Task& task) {
+    std::lock_guard<std::mutex> lock(output_mutex_);
     if (output_queue.empty()) return false;
     task = output_queue.front();
     output_queue.pop();
     return true;
 }
 
-void TaskManager::taskLoop() {
-    while (running.load()) {
-        if (!input_queue.empty()) {
-            Task task = input_queue.front();
-            input_queue.pop();
-            if (node_manager_) {
-                node_manager_->sendToNode(task.client_socket, task.request_data);
-            }
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
+void TaskManager::dispatchTask(Task& task) {
+    MemBudget::release(MemBudget::Category::REQUEST, sizeof(Task) + task.request_data.getPrompt().size());
+    Metrics::recordSince(Metrics::Histogram::QUEUE_WAIT, task.enqueue_ns);
+    long long start_ns = Metrics::nowNs();
+    if (!npu_dispatch_task(task.client_socket, task.request_id, task.request_data)) {
+        // 按模型路由到 NPU 节点；失败已计入 request_unroutable，回错误给客户端
+        failStream(task.request_id, "no NPU node available");
+        return;
     }
+    Metrics::recordSince(Metrics::Histogram::DISPATCH, start_ns);
+    Metrics::add(Metrics::Counter::TASK_DISPATCHED);
+    Trace::mark(task.request_id, Trace::Stage::DISPATCH);
 }
 
 void TaskManager::responseLoop() {
+    ThreadTopology::apply(ThreadTopology::Role::TASK_RESPONSE);
     while (running.load()) {
-        if (!output_queue.empty()) {
-            Task task = output_queue.front();
-            output_queue.pop();
-            // 这里可以通过 ClientManager 发送响应
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(output_mutex_);
+            idle = output_queue.empty();
+            if (!idle) {
+                Task task = output_queue.front();
+                output_queue.pop();
+                // 这里可以通过 ClientManager 发送响应
+            }
         }
+        if (idle) std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 }
 
 // 添加token到链表
-void TaskManager::addToken(const std::string& request_id, const char* token) {
-    auto it = token_map_.find(request_id);
-    if (it == token_map_.end()) {
-        TokenList* list = new TokenList();
-        list->addToken(token);
-        token_map_.insert(std::make_pair(request_id, list));
-    } else {
-        it->second->addToken(token);
-    }
+void TaskManager::addToken(uint64_t request_id, const char* token) {
+    Metrics::add(Metrics::Counter::TOKENS_RECEIVED);
+    std::lock_guard<std::mutex> lock(token_mutex_);
+    uint32_t s = streams_.find(request_id);
+    if (s == NIL) return;
+    uint32_t owner = streamOwner(s);
+    appendToken(owner, token);
+    // leader 的 token 同步扇出给所有合并进来的 follower
+    for (uint32_t f = slots_[owner].first_follower; f != NIL; f = slots_[f].next) appendToken(f, token);
 }
 
-// 获取链表
-TokenList* TaskManager::getTokenList(const std::string& request_id) {
-    auto it = token_map_.find(request_id);
-    if (it != token_map_.end()) return it->second;
-    return nullptr;
+// 追加token到指定流的链表（调用方需持有 token_mutex_）
+void TaskManager::appendToken(uint32_t s, const char* token) {
+    StreamState& st = slots_[s];
+    if (st.tokens.getSize() == 0) {
+        // follower 中途加入时补齐的 token 同样算作它的首个 token
+        Metrics::recordSince(Metrics::Histogram::TTFT, st.start_ns);
+        Trace::mark(st.id, Trace::Stage::FIRST_TOKEN);
+    }
+    st.tokens.addToken(token);
 }
 
 // 清理链表
-void TaskManager::clearTokenList(const std::string& request_id) {
-    auto it = token_map_.find(request_id);
-    if (it != token_map_.end()) {
-        delete it->second;
-        token_map_.erase(it);
+void TaskManager::clearTokenList(uint64_t request_id) {
+    std::lock_guard<std::mutex> lock(token_mutex_);
+    uint32_t s = streams_.find(request_id);
+    // 转交中的已断开 leader 属于节点侧，等节点结束该流时释放
+    if (s != NIL && slots_[s].forward == NIL) freeStream(s);
+}
+
+// 取消流：释放已缓存的 token，并停止接收该流后续的 token
+void TaskManager::cancelStream(uint64_t request_id) {
+    std::lock_guard<std::mutex> lock(token_mutex_);
+    uint32_t s = streams_.find(request_id);
+    if (s == NIL || slots_[s].forward != NIL) return;
+    StreamState& st = slots_[s];
+    // 作为 leader 且有 follower：生成继续，之后的 token 改由接替者接收；本槽留作转交，
+    // 节点结束该流时释放
+    uint32_t heir = st.tokens.isFinished() || st.leader != NIL ? NIL : promoteFollower(s);
+    if (heir == NIL) {
+        // follower 从 leader 的扇出列表中摘除；leader 无人接替时不再接收新的 follower
+        // （历史 token 已释放，无法补齐），节点之后回的 token 按未知 id 丢弃
+        freeStream(s);
+        return;
     }
+    st.tokens.clear();
+    st.request = RequestMessage();
+    st.forward = heir;
+    slots_[heir].forwarded_from = s;
 }
 
 // 标记token流结束
-void TaskManager::markTokenStreamFinished(const std::string& request_id) {
-    auto it = token_map_.find(request_id);
-    if (it != token_map_.end()) {
-        it->second->markFinished();
+void TaskManager::markTokenStreamFinished(uint64_t request_id) {
+    failStream(request_id, nullptr);
+}
+
+void TaskManager::failStream(uint64_t request_id, const char* error) {
+    std::lock_guard<std::mutex> lock(token_mutex_);
+    uint32_t s = streams_.find(request_id);
+    if (s == NIL) return;
+    uint32_t owner = streamOwner(s);
+    // 节点侧的流结束，转交用的槽随之释放
+    if (owner != s) releaseForwarding(owner);
+    if (slots_[owner].tokens.isFinished()) return;
+    endStream(owner, error);
+}
+
+uint32_t TaskManager::streamOwner(uint32_t s) const {
+    while (slots_[s].forward != NIL) s = slots_[s].forward;
+    return s;
+}
+
+uint32_t TaskManager::allocStream(uint64_t request_id, int client_socket) {
+    uint32_t s = free_head_;
+    if (s == NIL || !streams_.insert(request_id, s)) return NIL;
+    StreamState& st = slots_[s];
+    free_head_ = st.next;
+    st.id = request_id;
+    st.client_socket = client_socket;
+    st.coalesce_key = 0;
+    st.leader = st.first_follower = st.last_follower = st.next = NIL;
+    st.forward = st.forwarded_from = NIL;
+    return s;
+}
+
+void TaskManager::freeStream(uint32_t s) {
+    StreamState& st = slots_[s];
+    if (st.leader != NIL) detachFollower(st.leader, s);
+    if (st.forwarded_from != NIL) releaseForwarding(s);
+    unregisterLeader(s);
+    streams_.erase(st.id);
+    st.id = 0;
+    st.tokens.clear();
+    st.request = RequestMessage();
+    st.next = free_head_;
+    free_head_ = s;
+}
+
+// 释放把 token 转交给 s 的已断开 leader（可能是一串：leader 断开后接替者又断开）
+void TaskManager::releaseForwarding(uint32_t s) {
+    uint32_t from = slots_[s].forwarded_from;
+    slots_[s].forwarded_from = NIL;
+    while (from != NIL) {
+        StreamState& st = slots_[from];
+        uint32_t prev = st.forwarded_from;
+        st.forwarded_from = st.forward = NIL;
+        freeStream(from);
+        from = prev;
     }
 }
 
+// 结束单个流，反应器据此回结束/错误帧；失败在反应器回错误帧时计入 TASK_FAILED
+void TaskManager::endOne(uint32_t s, const char* error) {
+    StreamState& st = slots_[s];
+    if (error) {
+        st.tokens.markFailed(error);
+        return;
+    }
+    st.tokens.markFinished();
+    Metrics::recordSince(Metrics::Histogram::COMPLETION, st.start_ns);
+    Metrics::add(Metrics::Counter::TASK_COMPLETED);
+}
+
+void TaskManager::endStream(uint32_t s, const char* error) {
+    endOne(s, error);
+    Trace::mark(slots_[s].id, Trace::Stage::LAST_TOKEN);
+    if (error && retryWithFollower(s, error)) return;
+    // 生成已结束：follower 一并结束并解除合并关系，后续相同请求需要重新生成
+    StreamState& st = slots_[s];
+    for (uint32_t f = st.first_follower; f != NIL;) {
+        StreamState& fs = slots_[f];
+        uint32_t next = fs.next;
+        endOne(f, error);
+        Trace::mark(fs.id, Trace::Stage::LAST_TOKEN);
+        fs.leader = fs.next = NIL;
+        follower_count_--;
+        f = next;
+    }
+    st.first_follower = st.last_follower = NIL;
+    unregisterLeader(s);
+}
+
+void TaskManager::unregisterLeader(uint32_t s) {
+    StreamState& st = slots_[s];
+    if (!st.coalesce_key) return;
+    if (leaders_.find(st.coalesce_key) == s) leaders_.erase(st.coalesce_key);
+    st.coalesce_key = 0;
+}
+
 // 新的任务管理接口实现
 TaskContext* TaskManager::createTask(const std::string& request_id, int client_socket, const RequestMessage& request, int priority) {
     TaskContext* task = task_cache_.createTask(request_id, client_socket, request, priority);
     if (task) {
+        Metrics::add(Metrics::Counter::TASK_CREATED);
         task_queue_.addToPendingQueue(task);
     }
     return task;
@@ -114,8 +309,9 @@ TaskContext* TaskManager::createTask(const std::string& request_id, int client_s
 TaskContext* TaskManager::getNextPendingTask() {
     TaskContext* task = task_queue_.getNextPendingTask();
     if (task) {
+        Metrics::recordSince(Metrics::Histogram::QUEUE_WAIT, task->getCreateNs());
         task->status = TaskStatus::PROCESSING;
-        task->assign_time = getCurrentTimestamp();
+        task->assign_time = Clock::wallMs();
         task_queue_.addToProcessingQueue(task);
     }
     return task;
@@ -128,9 +324,11 @@ TaskContext* TaskManager::getTask(const std::string& request_id) {
 void TaskManager::completeTask(const std::string& request_id, const std::string& result) {
     TaskContext* task = task_cache_.getTask(request_id);
     if (task) {
-        task->response_data = result;
+        task->response.setResult(result);
         task->status = TaskStatus::COMPLETED;
-        task->complete_time = getCurrentTimestamp();
+        task->complete_time = Clock::wallMs();
+        Metrics::recordSince(Metrics::Histogram::COMPLETION, task->getCreateNs());
+        Metrics::add(Metrics::Counter::TASK_COMPLETED);
         
         task_queue_.removeFromProcessingQueue(task);
         task_cache_.completeTask(request_id);
@@ -142,13 +340,104 @@ void TaskManager::failTask(const std::string& request_id, const std::string& err
     if (task) {
         task->error_msg = error;
         task->status = TaskStatus::FAILED;
-        task->complete_time = getCurrentTimestamp();
+        task->complete_time = Clock::wallMs();
+        Metrics::add(Metrics::Counter::TASK_FAILED);
         
         task_queue_.removeFromProcessingQueue(task);
         task_cache_.completeTask(request_id);
     }
 }
 
+bool TaskManager::isCoalescedFollower(uint64_t request_id) {
+    std::lock_guard<std::mutex> lock(token_mutex_);
+    uint32_t s = streams_.find(request_id);
+    return s != NIL && slots_[s].leader != NIL;
+}
+
+// 合并键：model、max_tokens、stream、prompt 完全一致才视为相同请求（流式与非流式的响应形式不同）。
+// 只算哈希不拼接字符串，命中后由 sameRequest 逐字段确认
+uint64_t TaskManager::makeCoalesceKey(const RequestMessage& request) {
+    std::hash<std::string> hash;
+    uint64_t key = hash(request.getPrompt());
+    key = (key ^ hash(request.getModel())) * 0x9e3779b97f4a7c15ULL;
+    key ^= ((uint64_t)(uint32_t)request.getMaxTokens() << 1) | (request.getStream() ? 1 : 0);
+    key ^= key >> 29;
+    return key ? key : 1;
+}
+
+bool TaskManager::sameRequest(const RequestMessage& a, const RequestMessage& b) {
+    return a.getMaxTokens() == b.getMaxTokens() && a.getStream() == b.getStream() && a.getModel() == b.getModel() &&
+           a.getPrompt() == b.getPrompt();
+}
+
+// 将 follower 挂到 leader 上（调用方需持有 token_mutex_）
+void TaskManager::attachFollower(uint32_t leader, uint32_t follower) {
+    StreamState& ls = slots_[leader];
+    StreamState& fs = slots_[follower];
+    fs.leader = leader;
+    fs.next = NIL;
+    if (ls.last_follower != NIL) slots_[ls.last_follower].next = follower;
+    else ls.first_follower = follower;
+    ls.last_follower = follower;
+    follower_count_++;
+    coalesced_count_++;
+    
+    // 中途加入：补齐 leader 已生成的 token
+    for (TokenNode* node = ls.tokens.getHead(); node; node = node->next) {
+        appendToken(follower, node->token);
+    }
+}
+
+void TaskManager::detachFollower(uint32_t leader, uint32_t follower) {
+    StreamState& ls = slots_[leader];
+    uint32_t prev = NIL;
+    for (uint32_t f = ls.first_follower; f != NIL; prev = f, f = slots_[f].next) {
+        if (f != follower) continue;
+        if (prev != NIL) slots_[prev].next = slots_[f].next;
+        else ls.first_follower = slots_[f].next;
+        if (ls.last_follower == f) ls.last_follower = prev;
+        follower_count_--;
+        break;
+    }
+    slots_[follower].leader = slots_[follower].next = NIL;
+}
+
+uint32_t TaskManager::promoteFollower(uint32_t leader) {
+    StreamState& ls = slots_[leader];
+    uint32_t heir = ls.first_follower;
+    if (heir == NIL) return NIL;
+    StreamState& hs = slots_[heir];
+    // 其余 follower 原样转给接替者
+    hs.first_follower = hs.next;
+    hs.last_follower = hs.next != NIL ? ls.last_follower : NIL;
+    for (uint32_t f = hs.first_follower; f != NIL; f = slots_[f].next) slots_[f].leader = heir;
+    hs.leader = hs.next = NIL;
+    ls.first_follower = ls.last_follower = NIL;
+    follower_count_--;
+    if (ls.coalesce_key) {
+        if (leaders_.find(ls.coalesce_key) == leader) leaders_.insert(ls.coalesce_key, heir);
+        hs.coalesce_key = ls.coalesce_key;
+        ls.coalesce_key = 0;
+    }
+    Metrics::add(Metrics::Counter::TASK_PROMOTED);
+    return heir;
+}
+
+bool TaskManager::retryWithFollower(uint32_t leader, const char* error) {
+    uint32_t first = slots_[leader].first_follower;
+    if (first == NIL) return false;
+    // follower 已收到部分 token 时无法换一次生成续上，随 leader 一并失败
+    if (slots_[first].tokens.getSize() > 0) return false;
+    uint32_t heir = promoteFollower(leader);
+    StreamState& hs = slots_[heir];
+    // 接替者以自己的 id 重新进入下发池，其余 follower 改挂到它上面；请求仍留在槽中供后来者比对
+    if (!submitTask(Task{hs.client_socket, hs.id, 0, hs.request, ResponseMessage(), false, std::string()})) {
+        // 无法重新下发：接替者失败，再交给下一个 follower
+        endStream(heir, error);
+    }
+    return true;
+}
+
 // 统计信息
 size_t TaskManager::getPendingTaskCount() const {
     return task_queue_.getPendingQueueSize();
@@ -162,8 +451,22 @@ size_t TaskManager::getTotalTaskCount() const {
     return task_cache_.getSize();
 }
 
-// 辅助函数
-long long TaskManager::getCurrentTimestamp() {
-    return std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
-} 
\ No newline at end of file
+size_t TaskManager::getCoalescedTaskCount() const {
+    std::lock_guard<std::mutex> lock(token_mutex_);
+    return coalesced_count_;
+}
+
+size_t TaskManager::getFollowerCount() const {
+    std::lock_guard<std::mutex> lock(token_mutex_);
+    return follower_count_;
+}
+
+size_t TaskManager::getTokenListCount() const {
+    std::lock_guard<std::mutex> lock(token_mutex_);
+    return streams_.size();
+}
+
+size_t TaskManager::getInflightLeaderCount() const {
+    std::lock_guard<std::mutex> lock(token_mutex_);
+    return leaders_.size();
+}
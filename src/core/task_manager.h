@@ -7,37 +7,84 @@
 #include <functional>
 #include <map>
 #include <string>
+#include <vector>
+#include <mutex>
+#include <etl/queue.h>
 #include "task_cache.h"
 #include "task_queue.h"
-#include "data_structures.h"
+#include "dispatch_pool.h"
+#include "common/data_structures.h"
+#include "utils/metrics.h"
+#include "utils/trace.h"
+#include "utils/mem_budget.h"
+#include "utils/prealloc.h"
+#include "utils/id_table.h"
 
-class InferenceNodeManager; // 前向声明
+#define TOKEN_INLINE_SIZE 24      // 短 token 直接存在节点内，不再单独 malloc
+#define TOKEN_TEXT_SLOT_SIZE 128  // 较长的 token 从文本池取定长槽，超出槽长的才 malloc
 
 // 单向链表节点
 struct TokenNode {
     char* token;
     TokenNode* next;
-    TokenNode(const char* t) : token(nullptr), next(nullptr) {
+    long long arrive_ns;  // 到达网关的时间，用于统计投递延迟
+    size_t bytes;         // 计入内存预算的字节数
+    char inline_buf[TOKEN_INLINE_SIZE];
+    TokenNode(const char* t) : token(nullptr), next(nullptr), arrive_ns(Metrics::nowNs()), bytes(sizeof(TokenNode)) {
         if (t) {
             size_t len = strlen(t) + 1;
-            token = (char*)malloc(len);
+            token = len <= TOKEN_INLINE_SIZE ? inline_buf : allocText(len);
             if (token) {
-                strcpy(token, t);
+                memcpy(token, t, len);
+                if (token != inline_buf) bytes += len;
             }
         }
+        MemBudget::charge(MemBudget::Category::TOKEN, bytes);
     }
     ~TokenNode() {
-        if (token) {
-            free(token);
-            token = nullptr;
+        if (token && token != inline_buf) {
+            freeText(token);
         }
+        token = nullptr;
+        MemBudget::release(MemBudget::Category::TOKEN, bytes);
+    }
+
+    // 预分配模式下节点从池中分配，池耗尽或未启用时退回全局 new
+    // 池放在函数内静态变量中，只包含本头文件的基准程序也能链接
+    static SlabPool& pool() {
+        static SlabPool instance;
+        return instance;
+    }
+    static void* operator new(size_t size) {
+        void* p = size <= pool().slotSize() ? pool().alloc() : nullptr;
+        return p ? p : ::operator new(size);
+    }
+    static void operator delete(void* p) {
+        if (pool().owns(p)) pool().free(p);
+        else ::operator delete(p);
+    }
+
+    // 长 token 的文本池（槽长 TOKEN_TEXT_SLOT_SIZE），同样在预分配模式下初始化
+    static SlabPool& textPool() {
+        static SlabPool instance;
+        return instance;
+    }
+    static char* allocText(size_t len) {
+        void* p = len <= textPool().slotSize() ? textPool().alloc() : nullptr;
+        return (char*)(p ? p : malloc(len));
+    }
+    static void freeText(char* p) {
+        if (textPool().owns(p)) textPool().free(p);
+        else free(p);
     }
 };
 
 // 自定义链表类
 class TokenList {
 public:
-    TokenList() : head(nullptr), tail(nullptr), size(0), output_ptr(nullptr), is_finished(false) {}
+    TokenList()
+        : head(nullptr), tail(nullptr), size(0), output_ptr(nullptr), is_finished(false), is_failed(false),
+          pending_bytes(0), error_msg("") {}
     ~TokenList() {
         clear();
     }
@@ -52,7 +99,12 @@ public:
             tail->next = node;
             tail = node;
         }
+        // 之前的 token 已全部输出时，新 token 即为下一个待输出
+        if (!output_ptr) {
+            output_ptr = node;
+        }
         size++;
+        pending_bytes += node->bytes;
     }
     
     // 标记token流结束
@@ -64,10 +116,20 @@ public:
     bool isFinished() const {
         return is_finished;
     }
+
+    // 标记流失败（无可用节点、节点断开）：已到达的 token 照常投递，之后以错误帧代替结束帧。
+    // 只保存指针，error 须为静态字符串
+    void markFailed(const char* error) {
+        error_msg = error ? error : "";
+        is_failed = true;
+        is_finished = true;
+    }
+    bool isFailed() const { return is_failed; }
+    const char* getError() const { return error_msg; }
     
     // 检查是否还有更多token（包括未结束的流）
     bool hasMoreTokens() const {
-        return output_ptr != nullptr || (!is_finished && size > 0);
+        return output_ptr != nullptr;
     }
     
     // 检查是否完全结束（已发送完所有token且流已结束）
@@ -93,18 +155,25 @@ public:
         size = 0;
         output_ptr = nullptr;
         is_finished = false;
+        is_failed = false;
+        error_msg = "";
+        pending_bytes = 0;
     }
     
     // 输出相关函数
     // 重置输出指针到链表头
     void resetOutput() {
         output_ptr = head;
+        pending_bytes = 0;
+        for (TokenNode* cur = head; cur; cur = cur->next) pending_bytes += cur->bytes;
     }
     
-    // 获取下一个token，指针自动移动
-    const char* getNextToken() {
+    // 获取下一个token，指针自动移动；arrive_ns 非空时返回该token的到达时间
+    const char* getNextToken(long long* arrive_ns = nullptr) {
         if (!output_ptr) return nullptr;
         const char* token = output_ptr->token;
+        if (arrive_ns) *arrive_ns = output_ptr->arrive_ns;
+        pending_bytes -= output_ptr->bytes;
         output_ptr = output_ptr->next;
         return token;
     }
@@ -113,6 +182,14 @@ public:
     TokenNode* getCurrentOutputPos() const {
         return output_ptr;
     }
+
+    // 查看下一个待输出的token但不移动指针（发送失败时可重试）
+    const char* peekNextToken() const {
+        return output_ptr ? output_ptr->token : nullptr;
+    }
+
+    // 已到达但尚未发给客户端的字节数
+    size_t getPendingBytes() const { return pending_bytes; }
     
 private:
     TokenNode* head;
@@ -120,35 +197,74 @@ private:
     int size;
     TokenNode* output_ptr;  // 输出遍历指针
     bool is_finished;       // 标记token流是否结束
+    bool is_failed;
+    size_t pending_bytes;   // output_ptr 之后的节点字节数
+    const char* error_msg;
+};
+
+// 在途流：每个 pushRequest 占一个槽，token 链表与请求合并关系都存放在槽内，槽之间以下标相连。
+// 槽数组在 TaskManager 构造时一次性分配，运行中不再 new/delete；下标 IdTable::NIL 表示没有
+struct StreamState {
+    uint64_t id;              // 0 表示空闲槽
+    int client_socket;
+    long long start_ns;       // pushRequest 受理的时间，TTFT 与 COMPLETION 由此起算
+    RequestMessage request;   // 合并时据此确认请求相同，接替失败的 leader 时据此重新下发；未登记合并的 leader 为空
+    TokenList tokens;
+    uint64_t coalesce_key;    // 作为 leader 登记在合并表中的键，0 表示未登记
+    uint32_t leader;          // 作为 follower 时所挂的 leader
+    uint32_t first_follower;  // 作为 leader 时的 follower 链表，按加入顺序
+    uint32_t last_follower;
+    uint32_t next;            // follower 链表中的下一个；空闲槽中为空闲链表的下一个
+    uint32_t forward;         // 客户端已断开的 leader：节点仍按本 id 回 token，转交给接替者
+    uint32_t forwarded_from;  // 接替者：把 token 转交给自己的已断开 leader
 };
 
 // 主任务管理器 - 协调缓存池和队列
 class TaskManager {
 public:
-    static constexpr size_t MAX_TASKS = 128;
-    TaskManager();
+    static constexpr size_t MAX_TASKS = 128;  // 等待下发的请求数上限
+    static constexpr int DEFAULT_DISPATCH_WORKERS = 2;
+    static constexpr size_t DEFAULT_MAX_STREAMS = 1024;
+    // max_streams 为在途流槽数（含仍在转交 token 的已断开 leader），用满后 pushRequest 返回 false
+    explicit TaskManager(size_t max_cached_tasks = TaskCache::DEFAULT_MAX_TASKS,
+                         size_t max_streams = DEFAULT_MAX_STREAMS);
     ~TaskManager();
+    // 在途流表占用的字节数，供预分配区域预算
+    static size_t streamTableBytes(size_t max_streams);
 
-    // 启动任务管理
-    bool start(InferenceNodeManager* node_manager = nullptr);
+    // 启动任务管理：dispatch_workers 个下发线程（工作窃取，同一客户端的请求保持顺序）与一个响应线程
+    bool start(int dispatch_workers = DEFAULT_DISPATCH_WORKERS);
     void stop();
     bool isRunning() const { return running.load(); }
 
-    // 客户端推送请求
-    void pushRequest(int client_socket, const RequestMessage& request);
+    // 客户端推送请求（反应器线程调用），按客户端 socket 进入下发工作池；未启动、队列已满或流表已满时返回 false。
+    // 开启请求合并时，与在途请求相同的请求不再下发，直接挂到该请求的 token 流上（同样返回 true）
+    // request_id 为网关分配的 64 位 id（RequestId::next），下发给节点时才渲染为文本；request 被取走
+    bool pushRequest(int client_socket, uint64_t request_id, RequestMessage&& request);
     // 节点推送响应
     void pushResponse(int client_socket, const ResponseMessage& response, bool success, const std::string& error_msg = "");
     // 取出已完成响应
     bool popFinishedResponse(Task& task);
 
-    // token流式接收接口
-    void addToken(const std::string& request_id, const char* token);
+    // token流式接收接口：不属于任何在途流的 id（客户端已断开）直接丢弃
+    void addToken(uint64_t request_id, const char* token);
     // 标记token流结束
-    void markTokenStreamFinished(const std::string& request_id);
-    // 获取链表
-    TokenList* getTokenList(const std::string& request_id);
-    // 清理链表
-    void clearTokenList(const std::string& request_id);
+    void markTokenStreamFinished(uint64_t request_id);
+    // 在锁内访问链表：fn(TokenList*) 持有 token_mutex_ 期间调用，流不存在时传入 nullptr。
+    // 链表随时可能被其他线程追加或结束，不得在 fn 之外保留指针；fn 内不得再调用 TaskManager 的接口
+    template <typename Fn>
+    void withTokenList(uint64_t request_id, Fn&& fn) {
+        std::lock_guard<std::mutex> lock(token_mutex_);
+        uint32_t s = streams_.find(request_id);
+        fn(s != IdTable::NIL && slots_[s].forward == IdTable::NIL ? &slots_[s].tokens : nullptr);
+    }
+    // 流已投递完毕：归还槽位
+    void clearTokenList(uint64_t request_id);
+    // 取消流（客户端断开或超出配额）：释放链表，流结束前到达的 token 直接丢弃
+    void cancelStream(uint64_t request_id);
+    // 流失败（可在任意线程调用）：反应器投递完已到达的 token 后回错误帧并清理映射；
+    // 客户端已取消的流直接忘记。error 须为静态字符串
+    void failStream(uint64_t request_id, const char* error);
 
     // 新的任务管理接口
     TaskContext* createTask(const std::string& request_id, int client_socket, 
@@ -158,28 +274,83 @@ public:
     void completeTask(const std::string& request_id, const std::string& result);
     void failTask(const std::string& request_id, const std::string& error);
     
+    // 请求合并（single-flight，在 pushRequest 中进行）：相同 model/max_tokens/stream/prompt 的在途请求只下发一次。
+    // leader 的客户端断开时由最早加入的 follower 接替，继续接收同一生成；leader 失败且尚无 token
+    // 输出时同样由它接替，以自己的 id 重新进入下发池，其余 follower 不随之失败
+    bool isCoalescedFollower(uint64_t request_id);
+    // 运行中开关请求合并；关闭后新请求各自下发，已合并的 follower 仍随 leader 完成
+    void setCoalescing(bool enabled) { coalesce_.store(enabled, std::memory_order_relaxed); }
+    bool coalescingEnabled() const { return coalesce_.load(std::memory_order_relaxed); }
+    
     // 统计信息
     size_t getPendingTaskCount() const;
     size_t getProcessingTaskCount() const;
     size_t getTotalTaskCount() const;
+    size_t getCoalescedTaskCount() const;  // 累计合并过的请求数
+    size_t getFollowerCount() const;       // 当前挂在 leader 上等待扇出的 follower 数
+    size_t getTaskCapacity() const { return task_cache_.getCapacity(); }
+    size_t getTokenListCount() const;      // 占用的在途流槽数
+    size_t getStreamCapacity() const { return streams_.capacity(); }
+    size_t getInflightLeaderCount() const;
+    size_t getDispatchQueued() const { return dispatch_pool_.queued(); }
+    int getDispatchWorkers() const { return dispatch_pool_.workerCount(); }
 
 private:
-    void taskLoop();
+    static const uint32_t NIL = IdTable::NIL;
+
+    // 在下发工作线程上执行：把请求发往节点
+    void dispatchTask(Task& task);
+    // 计入内存预算并提交到下发池，失败时退回预算
+    bool submitTask(Task&& task);
     void responseLoop();
+    
+    // 以下调用方需持有 token_mutex_
+    uint32_t allocStream(uint64_t request_id, int client_socket);
+    // 归还槽位：从 leader 的扇出列表与合并表中摘除，并释放转交给它的已断开 leader
+    void freeStream(uint32_t s);
+    void releaseForwarding(uint32_t s);
+    // NPU 侧流 id 当前的接收者：原 leader 断开后为接替它的 follower
+    uint32_t streamOwner(uint32_t s) const;
+    void appendToken(uint32_t s, const char* token);
+    // 结束流：error 非空时为失败，follower 一并结束
+    void endStream(uint32_t s, const char* error);
+    void endOne(uint32_t s, const char* error);
+    void attachFollower(uint32_t leader, uint32_t follower);
+    void detachFollower(uint32_t leader, uint32_t follower);
+    void unregisterLeader(uint32_t s);
+    // 最早加入的 follower 接替 leader：其余 follower 与合并键转给它，返回接替者，没有 follower 时返回 NIL
+    uint32_t promoteFollower(uint32_t leader);
+    // leader 失败：尚无 token 扇出时由接替者重新下发，返回是否已接替
+    bool retryWithFollower(uint32_t leader, const char* error);
+
+    // 合并键：model、max_tokens、stream、prompt 的 64 位哈希（不为 0），命中后再逐字段确认
+    static uint64_t makeCoalesceKey(const RequestMessage& request);
+    static bool sameRequest(const RequestMessage& a, const RequestMessage& b);
 
     std::atomic<bool> running;
-    std::thread task_thread;
     std::thread response_thread;
 
-    etl::queue<Task, MAX_TASKS> input_queue;
     etl::queue<Task, MAX_TASKS> output_queue;
+    std::mutex output_mutex_;  // 反应器写入、响应线程取出
 
-    InferenceNodeManager* node_manager_;
-
-    // request_id -> token链表
-    std::map<std::string, TokenList*> token_map_;
+    // 在途流槽数组与空闲链表，request_id -> 槽下标
+    StreamState* slots_;
+    size_t slot_count_;
+    size_t slots_mapped_;
+    uint32_t free_head_;
+    IdTable streams_;
+    // 请求合并表：合并键 -> leader 槽下标
+    IdTable leaders_;
+    size_t follower_count_;
+    size_t coalesced_count_;
+    std::atomic<bool> coalesce_;
+    // 保护流表与请求合并表
+    mutable std::mutex token_mutex_;
     
     // 分离的缓存池和队列
     TaskCache task_cache_;
     TaskQueue task_queue_;
-}; 
\ No newline at end of file
+
+    // 请求下发工作池，取代原先的单个 taskLoop 线程
+    DispatchPool dispatch_pool_;
+};
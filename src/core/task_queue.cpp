@@ -47,10 +47,12 @@ void TaskQueue::removeFromProcessingQueue(TaskContext* task) {
 }
 
 size_t TaskQueue::getPendingQueueSize() const {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
     return pending_queue_.size();
 }
 
 size_t TaskQueue::getProcessingQueueSize() const {
+    std::lock_guard<std::mutex> lock(processing_mutex_);
     return processing_queue_.size();
 }
 
@@ -14,8 +14,8 @@ private:
     std::queue<TaskContext*> pending_queue_;
     std::queue<TaskContext*> processing_queue_;
     
-    std::mutex pending_mutex_;
-    std::mutex processing_mutex_;
+    mutable std::mutex pending_mutex_;
+    mutable std::mutex processing_mutex_;
     
 public:
     TaskQueue() = default;
@@ -1,35 +1,324 @@
 #include "core/client_manager.h"
 #include "core/npu_node_manager.h"
 #include "core/task_manager.h"
+#include "core/admin_server.h"
+#include "core/io_engine.h"
+#include "core/conn_liveness.h"
+#include "core/gateway_config.h"
+#include "core/hot_restart.h"
+#include "utils/logger.h"
+#include "utils/trace.h"
+#include "utils/clock.h"
+#include "utils/request_id.h"
+#include "utils/mem_budget.h"
+#include "utils/prealloc.h"
+#include "utils/buf_pool.h"
+#include "utils/thread_topology.h"
 #include <cstdio>
 #include <csignal>
+#include <sys/resource.h>
 
-static bool running = true;
+static volatile sig_atomic_t stop_signals = 0;
+static volatile sig_atomic_t reload_requested = 0;
+static volatile sig_atomic_t restart_requested = 0;
 
+// SIGINT/SIGTERM：第一次进入排空，第二次立即退出
 void handle_signal(int sig) {
-    running = false;
+    if (stop_signals < 2) stop_signals = stop_signals + 1;
 }
 
-int main() {
+// SIGHUP：只置标志，由主循环在两轮事件之间重新加载配置
+void handle_reload(int sig) {
+    reload_requested = 1;
+}
+
+// SIGUSR2：热重启，启动新进程并把监听 socket 与空闲连接移交过去
+void handle_restart(int sig) {
+    restart_requested = 1;
+}
+
+// 在途流槽数：每个请求映射一个，另留同样多给仍在转交 token 的已断开 leader
+static size_t stream_slots(int max_clients) {
+    return (size_t)max_clients * 2;
+}
+
+// 预分配模式（开发板部署）：一次性申请并锁定 token 节点池、长 token 文本池、任务上下文池、
+// 接收缓冲池与 TaskManager 的在途流表（流表在构造 TaskManager 时切分）
+static bool setup_prealloc(const Prealloc::Config& cfg, size_t streams) {
+    size_t token_bytes = cfg.token_slots * ((sizeof(TokenNode) + 63) & ~(size_t)63);
+    size_t text_bytes = cfg.token_text_slots * TOKEN_TEXT_SLOT_SIZE;
+    size_t task_bytes = cfg.task_slots * ((sizeof(TaskContext) + 63) & ~(size_t)63);
+    size_t buf_bytes = cfg.recv_bufs * ((sizeof(RecvBuf) + 63) & ~(size_t)63);
+    size_t stream_bytes = TaskManager::streamTableBytes(streams);
+    if (!Prealloc::init(token_bytes + text_bytes + task_bytes + buf_bytes + stream_bytes, cfg.huge_pages,
+                        cfg.lock_memory)) {
+        return false;
+    }
+    TokenNode::pool().init(Prealloc::carve(token_bytes), sizeof(TokenNode), cfg.token_slots);
+    TokenNode::textPool().init(Prealloc::carve(text_bytes), TOKEN_TEXT_SLOT_SIZE, cfg.token_text_slots);
+    TaskContext::pool().init(Prealloc::carve(task_bytes), sizeof(TaskContext), cfg.task_slots);
+    BufPool::init(cfg.recv_bufs);
+    return true;
+}
+
+// 按连接容量放宽打开文件数上限（不超过硬上限），返回生效后的软上限
+static int raise_fd_limit(int want) {
+    rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return IO_ENGINE_MAX_FDS;
+    if (rl.rlim_cur < (rlim_t)want) {
+        rl.rlim_cur = rl.rlim_max == RLIM_INFINITY || rl.rlim_max > (rlim_t)want ? (rlim_t)want : rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        getrlimit(RLIMIT_NOFILE, &rl);
+    }
+    return rl.rlim_cur > (rlim_t)(1 << 24) ? (1 << 24) : (int)rl.rlim_cur;
+}
+
+// 应用可在运行中调整的配置：内存配额、超时、限速、合并开关、采样率与节点列表。
+// 只在主循环（反应器线程）调用，已有连接与在途流保持不变
+static void apply_runtime_config(const GatewayConfig& cfg, TaskManager& task_mgr) {
+    MemBudget::configure(cfg.mem);
+    liveness_configure(cfg.liveness);
+    client_manager_set_limits(cfg.limits);
+    task_mgr.setCoalescing(cfg.coalesce_requests);
+    Trace::setSampleRate(cfg.trace_sample_rate);
+    int failed = npu_sync_nodes(cfg.npu_nodes.data(), (int)cfg.npu_nodes.size());
+    LOG_INFO("NPU nodes: %d configured, %d connecting or connected", (int)cfg.npu_nodes.size(),
+             (int)cfg.npu_nodes.size() - failed);
+}
+
+static void reload_config(const char* path, GatewayConfig& cfg, TaskManager& task_mgr) {
+    GatewayConfig loaded;
+    std::string err;
+    if (!gateway_config_load(path, loaded, err)) {
+        LOG_ERROR("Config reload from %s failed (%s), keeping current settings", path, err.c_str());
+        return;
+    }
+    std::string restart = gateway_config_restart_diff(cfg, loaded);
+    if (!restart.empty()) LOG_WARN("Config changes need a restart to take effect: %s", restart.c_str());
+    apply_runtime_config(loaded, task_mgr);
+    client_manager_reconfigure();
+    // 需要重启的项保留当前生效的值，下次比较时仍能提示
+    GatewayConfig applied = cfg;
+    applied.npu_nodes = loaded.npu_nodes;
+    applied.mem = loaded.mem;
+    applied.liveness = loaded.liveness;
+    applied.limits = loaded.limits;
+    applied.coalesce_requests = loaded.coalesce_requests;
+    applied.trace_sample_rate = loaded.trace_sample_rate;
+    applied.trace_file = loaded.trace_file;
+    applied.drain_timeout_ms = loaded.drain_timeout_ms;
+    cfg = applied;
+    Metrics::add(Metrics::Counter::CONFIG_RELOADED);
+    LOG_INFO("Config reloaded from %s", path);
+}
+
+static bool start_admin(const GatewayConfig& cfg, TaskManager& task_mgr) {
+    const char* admin_sock = cfg.admin_sock.empty() ? nullptr : cfg.admin_sock.c_str();
+    if (!admin_server_start(cfg.admin_port, admin_sock, &task_mgr)) return false;
+    LOG_INFO("Admin endpoint on 127.0.0.1:%d", cfg.admin_port);
+    return true;
+}
+
+// 用法: gateway_server [config.json]，不指定时使用内置默认值（见 config/gateway.json）
+int main(int argc, char* argv[]) {
+    Clock::init(); // 在启动任何线程前校准时钟
+    ThreadTopology::init(); // 记录进程可用核心，探测大小核（配置解析 big/little 时需要）
+    const char* config_path = argc > 1 ? argv[1] : nullptr;
+    GatewayConfig cfg;
+    gateway_config_defaults(cfg);
+    if (config_path) {
+        std::string err;
+        if (!gateway_config_load(config_path, cfg, err)) {
+            LOG_ERROR("Failed to load config %s: %s", config_path, err.c_str());
+            Logger::shutdown();
+            return 1;
+        }
+    }
+    // 线程绑定需在第一条日志（启动日志线程）之前配置；主线程即反应器，
+    // 在分配连接表、引擎与预分配池之前绑定，让这些内存按首次触碰落在反应器核心的本地节点上
+    for (int i = 0; i < ThreadTopology::NUM_ROLES; ++i) {
+        ThreadTopology::configure(static_cast<ThreadTopology::Role>(i), cfg.threads[i]);
+    }
+    bool pinned = ThreadTopology::apply(ThreadTopology::Role::REACTOR);
+    if (config_path) LOG_INFO("Config loaded from %s", config_path);
+    if (!pinned) LOG_WARN("Reactor thread placement partly failed (real-time scheduling needs CAP_SYS_NICE)");
+    for (int i = 0; i < ThreadTopology::NUM_ROLES; ++i) {
+        const ThreadTopology::Placement& p = cfg.threads[i];
+        if (!p.pinned && p.policy == ThreadTopology::Policy::DEFAULT && p.priority == 0) continue;
+        ThreadTopology::Role role = static_cast<ThreadTopology::Role>(i);
+        LOG_INFO("Thread %s: cpus %s, policy %s, priority %d", ThreadTopology::roleName(role),
+                 ThreadTopology::formatCpus(p).c_str(), ThreadTopology::policyName(p.policy), p.priority);
+    }
+    // 内存预算与连接存活需在建立任何连接之前设置
+    MemBudget::configure(cfg.mem);
+    liveness_configure(cfg.liveness);
+    // 预分配模式：需在创建其他线程和连接之前完成，mlockall 同时锁定静态连接表与收发缓冲
+    if (cfg.prealloc && setup_prealloc(cfg.prealloc_cfg, stream_slots(cfg.max_clients))) {
+        LOG_INFO("Preallocated %zu bytes (huge pages: %s, locked: %s)", Prealloc::regionSize(),
+                 Prealloc::usingHugePages() ? "yes" : "no", Prealloc::memoryLocked() ? "yes" : "no");
+    }
     signal(SIGINT, handle_signal);
     signal(SIGTERM, handle_signal);
+    signal(SIGHUP, handle_reload);
+    signal(SIGUSR2, handle_restart);
 
-    int port = 9000; // 客户端监听端口
-    client_manager_init(port);
+    // 连接容量：连接槽表、请求映射表与引擎 fd 表在启动时按此一次性分配（占用见启动日志与 /stats 的 table_bytes，另有内核 socket 缓冲）；
+    // 另留 64 个 fd 给监听、NPU 节点、管理端点与日志
+    int max_clients = cfg.max_clients;
+    int fd_limit = raise_fd_limit(max_clients + 64);
+    if (fd_limit < max_clients + 64) {
+        max_clients = fd_limit > 128 ? fd_limit - 64 : 64;
+        LOG_WARN("RLIMIT_NOFILE is %d, connection capacity reduced to %d", fd_limit, max_clients);
+    }
+
+    // I/O 引擎：AUTO 在 6.0+ 内核上使用 io_uring，否则退回 epoll；需在注册任何 socket 之前初始化
+    if (!io_engine_init(cfg.io_backend, fd_limit)) {
+        LOG_ERROR("Failed to initialize I/O engine");
+        Logger::shutdown();
+        return 1;
+    }
+    LOG_INFO("I/O backend: %s", io_engine_backend_name());
+
+    // 由热重启拉起时从旧进程继承监听 socket
+    uint32_t id_epoch = 0;
+    bool has_id_epoch = false;
+    int inherited_fd = hot_restart_inherit_listener(&id_epoch, &has_id_epoch);
+    // 请求 id 从旧进程交来的 epoch 开始分配，新旧进程同时在线时不会撞号（须在生成任何 id 之前）
+    if (has_id_epoch) RequestId::setBaseEpoch(id_epoch);
+    RequestId::setThreadShard(0); // 主 reactor 使用 shard 0
+    int port = cfg.listen_port;
+    if (!client_manager_init(port, max_clients, inherited_fd)) {
+        LOG_ERROR("Failed to start client manager on port %d", port);
+        io_engine_shutdown();
+        Logger::shutdown();
+        return 1;
+    }
     npu_node_manager_init();
-    TaskManager task_mgr;
-    // task_mgr.start(); // 如需多线程任务处理可启用
-    // 示例：添加一个NPU节点
-    // npu_add_node("192.168.1.100", 10000);
+    TaskManager task_mgr(cfg.task_cache_slots, stream_slots(max_clients));
+    // 请求经工作窃取下发池发往节点，节点返回的 token 交回 TaskManager 由反应器投递
+    if (!task_mgr.start(cfg.dispatch_workers)) {
+        LOG_ERROR("Failed to start task dispatch pool (%d workers)", cfg.dispatch_workers);
+        client_manager_close_all();
+        io_engine_shutdown();
+        Logger::shutdown();
+        return 1;
+    }
+    npu_set_task_manager(&task_mgr);
+    // 请求追踪采样率 0~1（0 关闭），退出时导出 Chrome trace，运行中可访问 /trace；
+    // 节点列表、限速等同样在这里首次应用
+    apply_runtime_config(cfg, task_mgr);
+    // 管理端点：独立线程提供 /metrics（Prometheus）与 /stats（JSON）
+    start_admin(cfg, task_mgr);
+
+    LOG_INFO("Client manager started on port %d (capacity %d, tables %zu bytes%s)", port,
+             client_manager_capacity(), client_manager_table_bytes(), inherited_fd >= 0 ? ", inherited listener" : "");
+    if (inherited_fd >= 0) hot_restart_ready();
 
-    printf("[INFO] Client manager started on port %d\n", port);
-    while (running) {
-        client_manager_run(&task_mgr); // 事件循环，接收数据并推送到任务队列
-        npu_poll_receive();   // 轮询NPU节点数据
-        // 可在此处处理任务响应等逻辑
+    // 排空：停止 accept 后等在途流结束（SIGTERM 时关闭空闲连接，热重启时移交空闲连接），
+    // 全部连接处理完或超过期限后退出
+    bool draining = false;
+    bool handing_off = false;
+    int64_t drain_deadline = 0;
+    int handoff_fds[HOT_RESTART_BATCH * 4];
+    while (true) {
+        if (reload_requested) {
+            reload_requested = 0;
+            if (config_path) reload_config(config_path, cfg, task_mgr);
+            else LOG_WARN("SIGHUP ignored: gateway started without a config file");
+        }
+        if (stop_signals >= 2) {
+            LOG_WARN("Second stop signal, exiting with %d streams in flight", client_manager_stream_count());
+            break;
+        }
+        if (stop_signals == 1 && !draining) {
+            if (hot_restart_in_progress()) hot_restart_close();  // 尚未就绪的新进程一并终止
+            draining = true;
+            drain_deadline = liveness_now_ms() + cfg.drain_timeout_ms;
+            client_manager_stop_accepting();
+            client_manager_set_reject_requests(true);
+            client_manager_set_max_wait(50);
+            LOG_INFO("Draining: %d connections, %d streams in flight, deadline %d ms", client_manager_count(),
+                     client_manager_stream_count(), cfg.drain_timeout_ms);
+        }
+        if (restart_requested) {
+            restart_requested = 0;
+            if (draining || hot_restart_in_progress()) {
+                LOG_WARN("Hot restart ignored: already draining or restarting");
+            } else {
+                // 管理端点的端口由新进程接管
+                admin_server_stop();
+                if (hot_restart_spawn(argv, client_manager_listen_fd(), RequestId::lastEpoch() + 1)) {
+                    client_manager_set_max_wait(50);
+                    LOG_INFO("Hot restart: new process started, waiting for it to become ready");
+                } else {
+                    LOG_ERROR("Hot restart: failed to start new process");
+                    start_admin(cfg, task_mgr);
+                }
+            }
+        }
+        if (hot_restart_in_progress()) {
+            HotRestartState st = hot_restart_poll();
+            if (st == HotRestartState::FAILED) {
+                if (handing_off) {
+                    // 监听 socket 一直保留着：恢复 accept，尚未移交的连接留在本进程继续服务
+                    LOG_ERROR("Hot restart: new process failed during handoff, resuming service with %d connections",
+                              client_manager_count());
+                    handing_off = draining = false;
+                    client_manager_cancel_handoff();
+                    client_manager_pause_accepting(false);
+                } else {
+                    LOG_ERROR("Hot restart: new process exited before becoming ready, resuming service");
+                }
+                hot_restart_close();
+                client_manager_set_max_wait(-1);
+                start_admin(cfg, task_mgr);
+            } else if (st == HotRestartState::READY) {
+                if (!handing_off) {
+                    // 新进程已在 accept，本进程暂停 accept 并开始移交；监听 socket 留到移交结束，失败时恢复
+                    handing_off = draining = true;
+                    drain_deadline = liveness_now_ms() + cfg.drain_timeout_ms;
+                    client_manager_pause_accepting(true);
+                    LOG_INFO("Hot restart: handing off %d connections (%d streams in flight)", client_manager_count(),
+                             client_manager_stream_count());
+                }
+                int n = client_manager_take_idle(handoff_fds, HOT_RESTART_BATCH);
+                if (n > 0 && hot_restart_send(handoff_fds, n)) {
+                    for (int i = 0; i < n; ++i) client_manager_detach(handoff_fds[i]);
+                }
+            }
+        }
+        client_manager_run(&task_mgr); // 事件循环一轮：接收客户端与NPU数据，投递 token
+        npu_poll_receive();   // 未注册到引擎的NPU节点轮询接收，心跳与存活检查
+        // 新进程：接管旧进程移交过来的连接，旧进程关闭通道后停止
+        int adopted = hot_restart_receive(handoff_fds, HOT_RESTART_BATCH * 4);
+        for (int i = 0; i < adopted; ++i) {
+            if (!client_manager_adopt(handoff_fds[i])) close(handoff_fds[i]);
+        }
+        if (draining) {
+            int remaining = handing_off ? client_manager_count() : client_manager_close_idle();
+            if (remaining == 0) {
+                LOG_INFO("Drain complete");
+                break;
+            }
+            if (liveness_now_ms() >= drain_deadline) {
+                LOG_WARN("Drain deadline reached: %d connections, %d streams still open", remaining,
+                         client_manager_stream_count());
+                break;
+            }
+        }
+    }
+    hot_restart_close();
+    admin_server_stop();
+    if (cfg.trace_sample_rate > 0 && Trace::dumpChrome(cfg.trace_file.c_str())) {
+        LOG_INFO("Trace written to %s", cfg.trace_file.c_str());
     }
     client_manager_close_all();
+    // 下发线程会向节点发送，先停掉再关闭节点连接
+    task_mgr.stop();
+    npu_set_task_manager(nullptr);
     npu_close_all();
-    printf("[INFO] Server stopped.\n");
+    io_engine_shutdown();
+    LOG_INFO("Server stopped.");
+    Logger::shutdown();
     return 0;
 }
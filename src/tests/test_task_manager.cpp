@@ -0,0 +1,246 @@
+// TaskManager 请求合并测试：走真实的 pushRequest -> DispatchPool -> dispatchTask 路径，
+// npu_dispatch_task 由本文件提供，记录每次下发而不连接节点
+#include <cstdio>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/task_manager.h"
+#include "core/npu_node_manager.h"
+
+static std::mutex g_dispatch_mutex;
+static std::vector<uint64_t> g_dispatched;
+static bool g_dispatch_ok = true;
+static bool g_gate_closed = false;  // 关闭时下发线程停在 npu_dispatch_task 中，用于固定请求到达的先后
+static std::condition_variable g_gate_cv;
+static int g_failures = 0;
+
+bool npu_dispatch_task(int client_socket, uint64_t request_id, const RequestMessage& req) {
+    (void)client_socket;
+    (void)req;
+    std::unique_lock<std::mutex> lock(g_dispatch_mutex);
+    g_gate_cv.wait(lock, []() { return !g_gate_closed; });
+    g_dispatched.push_back(request_id);
+    return g_dispatch_ok;
+}
+
+static void set_gate(bool closed) {
+    {
+        std::lock_guard<std::mutex> lock(g_dispatch_mutex);
+        g_gate_closed = closed;
+    }
+    g_gate_cv.notify_all();
+}
+
+#define CHECK(cond)                                                      \
+    do {                                                                 \
+        if (!(cond)) {                                                   \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            g_failures++;                                                \
+        }                                                                \
+    } while (0)
+
+static size_t dispatch_count() {
+    std::lock_guard<std::mutex> lock(g_dispatch_mutex);
+    return g_dispatched.size();
+}
+
+static uint64_t dispatched_at(size_t i) {
+    std::lock_guard<std::mutex> lock(g_dispatch_mutex);
+    return i < g_dispatched.size() ? g_dispatched[i] : 0;
+}
+
+// 下发在工作线程上异步进行：等到下发次数达到 n（最多 1 秒）
+static bool wait_dispatches(size_t n) {
+    for (int i = 0; i < 1000; ++i) {
+        if (dispatch_count() >= n) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+static void reset_dispatches(bool ok) {
+    std::lock_guard<std::mutex> lock(g_dispatch_mutex);
+    g_dispatched.clear();
+    g_dispatch_ok = ok;
+}
+
+static RequestMessage make_request(const char* prompt, bool stream = true) {
+    RequestMessage req;
+    req.setModel("llama2-7b");
+    req.setPrompt(prompt);
+    req.setMaxTokens(16);
+    req.setStream(stream);
+    return req;
+}
+
+// 链表中的全部 token 拼接为一个字符串，finished/failed 返回结束状态
+static std::string collect(TaskManager& tm, uint64_t id, bool* finished, bool* failed = nullptr) {
+    std::string out;
+    tm.withTokenList(id, [&](TokenList* list) {
+        *finished = list && list->isFinished();
+        if (failed) *failed = list && list->isFailed();
+        if (!list) return;
+        for (TokenNode* node = list->getHead(); node; node = node->next) out += node->token;
+    });
+    return out;
+}
+
+// 两个相同请求只下发一次，同一次生成的 token 同时进入两条链表
+static void test_identical_requests_share_one_dispatch() {
+    reset_dispatches(true);
+    TaskManager tm(64);
+    CHECK(tm.start(1));
+    CHECK(tm.pushRequest(3, 1, make_request("hello")));
+    CHECK(tm.pushRequest(4, 2, make_request("hello")));
+    CHECK(wait_dispatches(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(dispatch_count() == 1);
+    CHECK(dispatched_at(0) == 1);
+    CHECK(tm.isCoalescedFollower(2));
+
+    tm.addToken(1, "to");
+    tm.addToken(1, "ken");
+    tm.markTokenStreamFinished(1);
+    bool fa = false, fb = false;
+    CHECK(collect(tm, 1, &fa) == "token");
+    CHECK(collect(tm, 2, &fb) == "token");
+    CHECK(fa && fb);
+    CHECK(!tm.isCoalescedFollower(2));
+    CHECK(tm.getFollowerCount() == 0);
+    CHECK(tm.getInflightLeaderCount() == 0);
+    tm.stop();
+}
+
+// stream 标志不同、或合并关闭时各自下发
+static void test_distinct_requests_dispatch_separately() {
+    reset_dispatches(true);
+    TaskManager tm(64);
+    CHECK(tm.start(1));
+    CHECK(tm.pushRequest(3, 3, make_request("hi", true)));
+    CHECK(tm.pushRequest(4, 4, make_request("hi", false)));
+    tm.setCoalescing(false);
+    CHECK(tm.pushRequest(5, 5, make_request("hi", true)));
+    CHECK(wait_dispatches(3));
+    tm.stop();
+}
+
+// leader 下发失败且尚无 token：follower 以自己的 id 重新下发，不随之失败
+static void test_failed_leader_redispatches_heir() {
+    reset_dispatches(false);
+    TaskManager tm(64);
+    CHECK(tm.start(1));
+    // d 在 c 的下发结果出来之前到达，挂在 c 上
+    set_gate(true);
+    CHECK(tm.pushRequest(3, 6, make_request("retry")));
+    CHECK(tm.pushRequest(4, 7, make_request("retry")));
+    CHECK(tm.isCoalescedFollower(7));
+    set_gate(false);
+    // c 下发失败后由 d 重新下发，d 同样失败后才结束
+    CHECK(wait_dispatches(2));
+    CHECK(dispatched_at(0) == 6);
+    CHECK(dispatched_at(1) == 7);
+    bool finished = false, failed = false;
+    for (int i = 0; i < 1000 && !finished; ++i) {
+        collect(tm, 7, &finished, &failed);
+        if (!finished) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(finished && failed);
+    collect(tm, 6, &finished, &failed);
+    CHECK(finished && failed);
+    tm.stop();
+}
+
+// leader 的客户端断开：follower 接替，继续接收原流 id 上的 token
+static void test_cancelled_leader_hands_stream_to_follower() {
+    reset_dispatches(true);
+    TaskManager tm(64);
+    CHECK(tm.start(1));
+    CHECK(tm.pushRequest(3, 8, make_request("handoff")));
+    CHECK(tm.pushRequest(4, 9, make_request("handoff")));
+    CHECK(wait_dispatches(1));
+    tm.addToken(8, "x");
+    tm.cancelStream(8);
+    tm.addToken(8, "y");
+    tm.markTokenStreamFinished(8);
+    bool finished = false;
+    CHECK(collect(tm, 9, &finished) == "xy");
+    CHECK(finished);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(dispatch_count() == 1);
+    tm.stop();
+}
+
+// 流表用满后拒绝新请求，投递完的流归还槽位；已取消、无人接替的流之后的 token 直接丢弃
+static void test_stream_slots_are_recycled() {
+    reset_dispatches(true);
+    TaskManager tm(64, 2);
+    CHECK(tm.start(1));
+    tm.setCoalescing(false);
+    CHECK(tm.pushRequest(3, 10, make_request("p1")));
+    CHECK(tm.pushRequest(4, 11, make_request("p2")));
+    CHECK(!tm.pushRequest(5, 12, make_request("p3")));
+    CHECK(tm.getTokenListCount() == 2);
+    tm.markTokenStreamFinished(10);
+    bool finished = false;
+    collect(tm, 10, &finished);
+    CHECK(finished);
+    tm.clearTokenList(10);
+    CHECK(tm.pushRequest(5, 12, make_request("p3")));
+    tm.cancelStream(11);
+    tm.addToken(11, "late");
+    CHECK(tm.getTokenListCount() == 1);
+    bool exists = true;
+    tm.withTokenList(11, [&](TokenList* list) { exists = list != nullptr; });
+    CHECK(!exists);
+    tm.stop();
+}
+
+static uint64_t histogram_count(Metrics::Histogram h) {
+    Metrics::HistogramSnapshot snap;
+    Metrics::snapshot(h, snap);
+    return snap.count;
+}
+
+// 受理、排队、首 token 与完成在实际路径上计入指标：leader 与 follower 各自统计 TTFT 与完成
+static void test_live_path_records_metrics() {
+    reset_dispatches(true);
+    uint64_t created = Metrics::counter(Metrics::Counter::TASK_CREATED);
+    uint64_t completed = Metrics::counter(Metrics::Counter::TASK_COMPLETED);
+    uint64_t queue_wait = histogram_count(Metrics::Histogram::QUEUE_WAIT);
+    uint64_t ttft = histogram_count(Metrics::Histogram::TTFT);
+    uint64_t completion = histogram_count(Metrics::Histogram::COMPLETION);
+    TaskManager tm(64);
+    CHECK(tm.start(1));
+    CHECK(tm.pushRequest(3, 20, make_request("metrics")));
+    CHECK(tm.pushRequest(4, 21, make_request("metrics")));
+    CHECK(wait_dispatches(1));
+    tm.addToken(20, "a");
+    tm.addToken(20, "b");
+    tm.markTokenStreamFinished(20);
+    tm.stop();
+    CHECK(Metrics::counter(Metrics::Counter::TASK_CREATED) - created == 2);
+    CHECK(Metrics::counter(Metrics::Counter::TASK_COMPLETED) - completed == 2);
+    CHECK(histogram_count(Metrics::Histogram::QUEUE_WAIT) - queue_wait == 1);
+    CHECK(histogram_count(Metrics::Histogram::TTFT) - ttft == 2);
+    CHECK(histogram_count(Metrics::Histogram::COMPLETION) - completion == 2);
+}
+
+int main() {
+    Clock::init();
+    test_identical_requests_share_one_dispatch();
+    test_distinct_requests_dispatch_separately();
+    test_failed_leader_redispatches_heir();
+    test_cancelled_leader_hands_stream_to_follower();
+    test_stream_slots_are_recycled();
+    test_live_path_records_metrics();
+    if (g_failures) {
+        fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("test_task_manager: all checks passed\n");
+    return 0;
+}
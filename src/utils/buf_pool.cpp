@@ -0,0 +1,69 @@
+#include "buf_pool.h"
+#include "prealloc.h"
+#include <sys/mman.h>
+
+namespace BufPool {
+
+    static SlabPool g_pool;
+    static char* g_base = nullptr;
+    static size_t g_stride = 0;
+    static size_t g_mapped = 0;  // 自行 mmap 的字节数，从预分配区域切分时为 0
+
+    bool init(size_t count) {
+        if (g_base) return true;
+        if (count == 0) return false;
+        size_t stride = (sizeof(RecvBuf) + 63) & ~(size_t)63;
+        size_t bytes = stride * count;
+        void* mem = Prealloc::carve(bytes);
+        if (!mem) {
+            mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) return false;
+            g_mapped = bytes;
+        }
+        if (!g_pool.init(mem, sizeof(RecvBuf), count)) {
+            if (g_mapped) munmap(mem, g_mapped);
+            g_mapped = 0;
+            return false;
+        }
+        g_base = (char*)mem;
+        g_stride = g_pool.slotSize();
+        return true;
+    }
+
+    void shutdown() {
+        if (g_mapped) munmap(g_base, g_mapped);
+        g_base = nullptr;
+        g_stride = 0;
+        g_mapped = 0;
+    }
+
+    bool active() {
+        return g_base != nullptr;
+    }
+
+    RecvBuf* acquire() {
+        if (!g_base) return nullptr;
+        void* p = g_pool.alloc();
+        if (!p) return nullptr;
+        RecvBuf* b = (RecvBuf*)p;
+        b->refs.store(1, std::memory_order_relaxed);
+        b->index = (uint32_t)(((char*)p - g_base) / g_stride);
+        return b;
+    }
+
+    void release(RecvBuf* b) {
+        if (b->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) g_pool.free(b);
+    }
+
+    RecvBuf* at(uint32_t index) {
+        return (RecvBuf*)(g_base + (size_t)index * g_stride);
+    }
+
+    size_t capacity() {
+        return g_pool.capacity();
+    }
+
+    size_t available() {
+        return g_pool.capacity() - g_pool.used();
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define BUFPOOL_BUF_SIZE 4096       // 单个接收缓冲大小
+#define BUFPOOL_DEFAULT_COUNT 512   // 默认缓冲数，需大于 io_uring 提供缓冲环的容量
+
+// 接收缓冲：定长、带引用计数，最后一个引用释放时回到池中。
+// recv 直接写入缓冲，分帧与解析在缓冲上原地进行；需要跨事件保留的数据用 BufSlice 持有引用，不再拷贝。
+struct RecvBuf {
+    std::atomic<uint32_t> refs;
+    uint32_t index;  // 池内编号，io_uring 后端用作提供缓冲的 bid
+    char data[BUFPOOL_BUF_SIZE];
+};
+
+namespace BufPool {
+
+    // 预分配模式下从预分配区域切分，否则单独 mmap；重复调用直接返回 true
+    bool init(size_t count);
+    void shutdown();
+    bool active();
+
+    // 取一个缓冲，引用计数为 1；池耗尽返回 nullptr（调用方应暂缓读取）
+    RecvBuf* acquire();
+    inline void retain(RecvBuf* b) { b->refs.fetch_add(1, std::memory_order_relaxed); }
+    // 可在任意线程调用
+    void release(RecvBuf* b);
+    RecvBuf* at(uint32_t index);
+
+    size_t capacity();
+    size_t available();
+}
+
+// 缓冲片段：引用某个接收缓冲中的一段数据，拷贝时增加引用，析构时释放
+class BufSlice {
+public:
+    BufSlice() : buf_(nullptr), data_(nullptr), len_(0) {}
+    BufSlice(RecvBuf* buf, const char* data, size_t len) : buf_(buf), data_(data), len_(len) {
+        if (buf_) BufPool::retain(buf_);
+    }
+    BufSlice(const BufSlice& o) : buf_(o.buf_), data_(o.data_), len_(o.len_) {
+        if (buf_) BufPool::retain(buf_);
+    }
+    BufSlice(BufSlice&& o) : buf_(o.buf_), data_(o.data_), len_(o.len_) {
+        o.buf_ = nullptr;
+        o.data_ = nullptr;
+        o.len_ = 0;
+    }
+    BufSlice& operator=(BufSlice o) {
+        std::swap(buf_, o.buf_);
+        std::swap(data_, o.data_);
+        std::swap(len_, o.len_);
+        return *this;
+    }
+    ~BufSlice() { reset(); }
+
+    void reset() {
+        if (buf_) BufPool::release(buf_);
+        buf_ = nullptr;
+        data_ = nullptr;
+        len_ = 0;
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return len_; }
+    bool empty() const { return len_ == 0; }
+    std::string str() const { return std::string(data_, len_); }
+
+private:
+    RecvBuf* buf_;
+    const char* data_;
+    size_t len_;
+};
@@ -0,0 +1,91 @@
+#include "clock.h"
+#include <thread>
+#include <chrono>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+namespace Clock {
+
+    FineState g_fine = {Source::CLOCK_GETTIME, 0, 0, 0};
+    std::atomic<int64_t> g_wall_offset_ns(0);
+    std::atomic<int64_t> g_coarse_ms(0);
+
+    static int64_t realtimeNs() {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+
+#if defined(__x86_64__)
+    // 仅在 TSC 不变（不随频率/休眠变化）时使用
+    static bool invariantTsc() {
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) return false;
+        __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        return (edx & (1u << 8)) != 0;
+    }
+
+    // 对照 CLOCK_MONOTONIC 测量 TSC 频率
+    static uint64_t calibrateTicksPerSec() {
+        int64_t t0 = monotonicSyscallNs();
+        uint64_t c0 = readTicks();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        int64_t t1 = monotonicSyscallNs();
+        uint64_t c1 = readTicks();
+        if (t1 <= t0 || c1 <= c0) return 0;
+        return (uint64_t)((unsigned __int128)(c1 - c0) * 1000000000ULL / (uint64_t)(t1 - t0));
+    }
+#endif
+
+#if defined(__aarch64__)
+    // 通用定时器频率由 cntfrq_el0 给出，无需校准
+    static uint64_t readCntfrq() {
+        uint64_t v;
+        __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(v));
+        return v;
+    }
+#endif
+
+    void init() {
+        uint64_t freq = 0;
+        Source source = Source::CLOCK_GETTIME;
+#if defined(__x86_64__)
+        if (invariantTsc()) {
+            freq = calibrateTicksPerSec();
+            source = Source::TSC;
+        }
+#elif defined(__aarch64__)
+        freq = readCntfrq();
+        source = Source::CNTVCT;
+#endif
+        if (freq == 0) {
+            g_fine.source = Source::CLOCK_GETTIME;
+        } else {
+            g_fine.base_ns = monotonicSyscallNs();
+            g_fine.base_ticks = readTicks();
+            g_fine.mult = (uint64_t)(((unsigned __int128)1000000000ULL << 32) / freq);
+            g_fine.source = source;
+        }
+        tick();
+    }
+
+    int64_t refreshWallOffset() {
+        int64_t offset = realtimeNs() - nowNs();
+        g_wall_offset_ns.store(offset, std::memory_order_relaxed);
+        return offset;
+    }
+
+    void tick() {
+        int64_t offset = refreshWallOffset();
+        g_coarse_ms.store((nowNs() + offset) / 1000000, std::memory_order_relaxed);
+    }
+
+    const char* sourceName() {
+        switch (g_fine.source) {
+            case Source::TSC:    return "tsc";
+            case Source::CNTVCT: return "cntvct";
+            default:             return "clock_gettime";
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <time.h>
+
+// 统一时钟：热路径上避免反复调用 system_clock::now()
+//  - 细粒度单调时钟 nowNs()：x86_64 用不变 TSC，aarch64 用 cntvct_el0，init() 校准后无需系统调用；
+//    不支持或未校准时退回 clock_gettime(CLOCK_MONOTONIC)
+//  - 墙钟 wallNs()/wallMs()：细粒度时钟加偏移，偏移在 tick() 中用 CLOCK_REALTIME 刷新
+//  - 粗粒度时钟 coarseMs()：事件循环每轮 tick() 一次更新的缓存值，读取只是一次原子加载
+namespace Clock {
+
+    enum class Source { CLOCK_GETTIME, TSC, CNTVCT };
+
+    struct FineState {
+        Source source;
+        uint64_t base_ticks;
+        int64_t base_ns;
+        uint64_t mult;  // 每 tick 的纳秒数，32 位定点
+    };
+    extern FineState g_fine;
+    extern std::atomic<int64_t> g_wall_offset_ns;
+    extern std::atomic<int64_t> g_coarse_ms;
+
+    // 校准细粒度时钟；应在启动其他线程之前调用一次（x86 上约耗时 20ms）
+    void init();
+    // 刷新粗粒度时钟和墙钟偏移，由事件循环每轮调用一次
+    void tick();
+    // 重新计算墙钟偏移并返回
+    int64_t refreshWallOffset();
+    const char* sourceName();
+
+    inline int64_t monotonicSyscallNs() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+
+    inline uint64_t readTicks() {
+#if defined(__x86_64__)
+        uint32_t lo, hi;
+        __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+        return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+        uint64_t v;
+        __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(v) :: "memory");
+        return v;
+#else
+        return 0;
+#endif
+    }
+
+    // 单调时钟，纳秒
+    inline int64_t nowNs() {
+#if defined(__x86_64__) || defined(__aarch64__)
+        if (g_fine.source != Source::CLOCK_GETTIME) {
+            uint64_t delta = readTicks() - g_fine.base_ticks;
+            return g_fine.base_ns + (int64_t)(((unsigned __int128)delta * g_fine.mult) >> 32);
+        }
+#endif
+        return monotonicSyscallNs();
+    }
+
+    // 墙钟（Unix 纪元），纳秒/毫秒
+    inline int64_t wallNs() {
+        int64_t offset = g_wall_offset_ns.load(std::memory_order_relaxed);
+        if (offset == 0) offset = refreshWallOffset();
+        return nowNs() + offset;
+    }
+
+    inline int64_t wallMs() {
+        return wallNs() / 1000000;
+    }
+
+    // 粗粒度墙钟毫秒；尚未 tick 过时退回 wallMs()
+    inline int64_t coarseMs() {
+        int64_t v = g_coarse_ms.load(std::memory_order_relaxed);
+        return v ? v : wallMs();
+    }
+}
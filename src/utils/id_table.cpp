@@ -0,0 +1,70 @@
+#include "id_table.h"
+#include "prealloc.h"
+
+static size_t slot_count(size_t capacity) {
+    size_t n = 16;
+    while (n < capacity * 2) n <<= 1;
+    return n;
+}
+
+IdTable::~IdTable() {
+    Prealloc::freeTable(slots_, mapped_);
+}
+
+size_t IdTable::bytesFor(size_t capacity) {
+    return slot_count(capacity) * sizeof(Slot);
+}
+
+bool IdTable::init(size_t capacity) {
+    if (slots_ || capacity == 0) return false;
+    size_t n = slot_count(capacity);
+    slots_ = (Slot*)Prealloc::allocTable(n * sizeof(Slot), mapped_);
+    if (!slots_) return false;
+    mask_ = n - 1;
+    size_ = 0;
+    capacity_ = capacity;
+    return true;
+}
+
+size_t IdTable::probe(uint64_t key) const {
+    size_t i = mix(key) & mask_;
+    while (slots_[i].key != 0 && slots_[i].key != key) i = (i + 1) & mask_;
+    return i;
+}
+
+uint32_t IdTable::find(uint64_t key) const {
+    if (!slots_ || key == 0) return NIL;
+    const Slot& s = slots_[probe(key)];
+    return s.key == key ? s.value : NIL;
+}
+
+bool IdTable::insert(uint64_t key, uint32_t value) {
+    if (!slots_ || key == 0) return false;
+    Slot& s = slots_[probe(key)];
+    if (s.key != key) {
+        if (size_ >= capacity_) return false;
+        s.key = key;
+        size_++;
+    }
+    s.value = value;
+    return true;
+}
+
+bool IdTable::erase(uint64_t key) {
+    if (!slots_ || key == 0) return false;
+    size_t i = probe(key);
+    if (slots_[i].key != key) return false;
+    // 回移：其后同一探测链上、起始位置不在 (i, j] 之间的键前移填补空位
+    for (size_t j = i;;) {
+        j = (j + 1) & mask_;
+        if (slots_[j].key == 0) break;
+        size_t home = mix(slots_[j].key) & mask_;
+        bool between = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (between) continue;
+        slots_[i] = slots_[j];
+        i = j;
+    }
+    slots_[i].key = 0;
+    size_--;
+    return true;
+}
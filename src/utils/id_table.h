@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64 位 id -> 32 位值的定长哈希表：开放寻址、线性探测，删除时把后继回移，不留墓碑。
+// 槽数组在 init 时一次性申请（预分配模式下从预分配区域切分，见 Prealloc::allocTable），
+// 运行中插入删除都不分配内存。槽数取 2 的幂且不少于容量的两倍，探测链保持很短。
+// 键 0 表示空槽，不能作为 id 使用（RequestId 生成的 id 不为 0）。不加锁，由调用方同步
+class IdTable {
+public:
+    static const uint32_t NIL = 0xffffffffu;
+
+    IdTable() : slots_(nullptr), mask_(0), size_(0), capacity_(0), mapped_(0) {}
+    ~IdTable();
+    IdTable(const IdTable&) = delete;
+    IdTable& operator=(const IdTable&) = delete;
+
+    // 最多容纳 capacity 个键
+    bool init(size_t capacity);
+    // init(capacity) 占用的字节数，供预分配区域预算
+    static size_t bytesFor(size_t capacity);
+
+    // 不存在时返回 NIL
+    uint32_t find(uint64_t key) const;
+    // 插入或覆盖；键为 0 或已有 capacity 个键时返回 false
+    bool insert(uint64_t key, uint32_t value);
+    bool erase(uint64_t key);
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct Slot {
+        uint64_t key;
+        uint32_t value;
+    };
+
+    // 连续的 id 只在低位不同，先打散再取模
+    static uint64_t mix(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+    size_t probe(uint64_t key) const;  // key 所在槽或应插入的空槽
+
+    Slot* slots_;
+    size_t mask_;
+    size_t size_;
+    size_t capacity_;
+    size_t mapped_;  // 自行 mmap 的字节数，从预分配区域切分时为 0
+};
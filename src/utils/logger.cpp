@@ -1,14 +1,291 @@
 #include "logger.h"
-#include <iostream>
+#include "clock.h"
+#include "thread_topology.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define LOGGER_OUT_BUF_SIZE 65536  // 后台线程批量输出缓冲
 
 namespace Logger {
-    void info(const std::string& msg) {
-        std::cout << "[INFO] " << msg << std::endl;
+
+    // 定长记录：时间戳在生产者侧获取，格式化在后台线程完成
+    struct Record {
+        int64_t ts_ns;   // CLOCK_REALTIME，纳秒
+        uint32_t tid;
+        uint16_t len;
+        uint8_t level;
+        uint8_t reserved;
+        char msg[LOGGER_RECORD_SIZE - 16];
+    };
+    static_assert(sizeof(Record) == LOGGER_RECORD_SIZE, "Record size mismatch");
+    static_assert((LOGGER_RING_RECORDS & (LOGGER_RING_RECORDS - 1)) == 0, "ring size must be power of 2");
+
+    // 单生产者单消费者环；head 由生产者推进，tail 由后台线程推进
+    struct Ring {
+        alignas(64) std::atomic<uint32_t> head;
+        alignas(64) std::atomic<uint32_t> tail;
+        alignas(64) bool shared;  // 溢出环由多个线程共用，写入时加锁
+        std::mutex lock;
+        Record records[LOGGER_RING_RECORDS];
+    };
+
+    static Ring* g_rings[LOGGER_MAX_THREADS];
+    static std::atomic<int> g_ring_count(0);
+    static Ring* g_overflow_ring = nullptr;
+    static std::atomic<unsigned long long> g_dropped(0);
+
+    static int g_out_fd = STDOUT_FILENO;
+    static int g_err_fd = STDERR_FILENO;
+    static bool g_own_fd = false;
+    static std::atomic<bool> g_running(false);
+    static std::atomic<bool> g_stopped(false);
+    static std::thread g_thread;
+    static std::once_flag g_start_once;
+    static std::mutex g_drain_mutex;  // 后台线程与 flush() 互斥消费
+
+    static void backgroundLoop();
+
+    static void startBackground() {
+        std::call_once(g_start_once, []() {
+            g_running = true;
+            g_thread = std::thread(backgroundLoop);
+            atexit(shutdown);
+        });
+    }
+
+    static Ring* allocRing(bool shared) {
+        void* mem = nullptr;
+        if (posix_memalign(&mem, 64, sizeof(Ring)) != 0) return nullptr;
+        Ring* ring = new (mem) Ring();
+        ring->head.store(0, std::memory_order_relaxed);
+        ring->tail.store(0, std::memory_order_relaxed);
+        ring->shared = shared;
+        return ring;
+    }
+
+    static Ring* overflowRing() {
+        static Ring* ring = allocRing(true);
+        reinterpret_cast<std::atomic<Ring*>*>(&g_overflow_ring)->store(ring, std::memory_order_release);
+        return ring;
+    }
+
+    static Ring* registerRing() {
+        startBackground();
+        int idx = g_ring_count.fetch_add(1);
+        if (idx >= LOGGER_MAX_THREADS) {
+            g_ring_count.store(LOGGER_MAX_THREADS);
+            return overflowRing();
+        }
+        Ring* ring = allocRing(false);
+        if (!ring) return overflowRing();
+        reinterpret_cast<std::atomic<Ring*>*>(&g_rings[idx])->store(ring, std::memory_order_release);
+        return ring;
     }
-    void debug(const std::string& msg) {
-        std::cout << "[DEBUG] " << msg << std::endl;
+
+    static inline Ring* threadRing() {
+        static thread_local Ring* ring = nullptr;
+        if (!ring) ring = registerRing();
+        return ring;
+    }
+
+    static inline uint32_t threadId() {
+        static thread_local uint32_t tid = (uint32_t)syscall(SYS_gettid);
+        return tid;
+    }
+
+
+    // 预留一个槽位；环满返回 nullptr
+    static inline Record* reserve(Ring* ring, uint32_t& head) {
+        head = ring->head.load(std::memory_order_relaxed);
+        uint32_t tail = ring->tail.load(std::memory_order_acquire);
+        if (head - tail >= LOGGER_RING_RECORDS) return nullptr;
+        return &ring->records[head & (LOGGER_RING_RECORDS - 1)];
+    }
+
+    static inline void commit(Ring* ring, uint32_t head) {
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    template<typename Fill>
+    static void submit(Level level, Fill fill) {
+        if (g_stopped.load(std::memory_order_relaxed)) return;
+        Ring* ring = threadRing();
+        if (!ring) return;
+        std::unique_lock<std::mutex> guard;
+        if (ring->shared) guard = std::unique_lock<std::mutex>(ring->lock);
+        uint32_t head;
+        Record* rec = reserve(ring, head);
+        if (!rec) {
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        rec->ts_ns = Clock::wallNs();
+        rec->tid = threadId();
+        rec->level = (uint8_t)level;
+        rec->len = (uint16_t)fill(rec->msg, sizeof(rec->msg));
+        commit(ring, head);
+    }
+
+    void write(Level level, const char* msg, size_t len) {
+        submit(level, [&](char* dst, size_t cap) {
+            size_t n = len < cap ? len : cap;
+            memcpy(dst, msg, n);
+            return n;
+        });
     }
-    void error(const std::string& msg) {
-        std::cerr << "[ERROR] " << msg << std::endl;
+
+    void writef(Level level, const char* fmt, ...) {
+        va_list ap;
+        va_start(ap, fmt);
+        submit(level, [&](char* dst, size_t cap) {
+            int n = vsnprintf(dst, cap, fmt, ap);
+            if (n < 0) return (size_t)0;
+            return (size_t)n < cap ? (size_t)n : cap - 1;
+        });
+        va_end(ap);
+    }
+
+    // ---- 后台格式化与批量输出 ----
+
+    struct OutBuf {
+        size_t len;
+        char data[LOGGER_OUT_BUF_SIZE];
+    };
+    static OutBuf g_out_buf;
+    static OutBuf g_err_buf;
+
+    static void flushBuf(OutBuf& b) {
+        int fd = (&b == &g_err_buf) ? g_err_fd : g_out_fd;
+        size_t off = 0;
+        while (off < b.len) {
+            ssize_t n = ::write(fd, b.data + off, b.len - off);
+            if (n <= 0) break;
+            off += (size_t)n;
+        }
+        b.len = 0;
+    }
+
+    static const char* levelName(uint8_t level) {
+        switch (level) {
+            case LOGGER_LEVEL_DEBUG: return "DEBUG";
+            case LOGGER_LEVEL_INFO:  return "INFO";
+            case LOGGER_LEVEL_WARN:  return "WARN";
+            default:                 return "ERROR";
+        }
+    }
+
+    // 同一秒内复用已格式化的日期前缀，避免每条记录调用 localtime_r
+    static void formatRecord(const Record& rec) {
+        static time_t cached_sec = -1;
+        static char cached_prefix[32];
+        time_t sec = (time_t)(rec.ts_ns / 1000000000LL);
+        if (sec != cached_sec) {
+            tm t;
+            localtime_r(&sec, &t);
+            strftime(cached_prefix, sizeof(cached_prefix), "%Y-%m-%d %H:%M:%S", &t);
+            cached_sec = sec;
+        }
+        OutBuf& b = (rec.level == LOGGER_LEVEL_ERROR && !g_own_fd) ? g_err_buf : g_out_buf;
+        if (b.len + LOGGER_RECORD_SIZE + 64 > LOGGER_OUT_BUF_SIZE) flushBuf(b);
+        int n = snprintf(b.data + b.len, LOGGER_OUT_BUF_SIZE - b.len, "%s.%06d [%s] [%u] ",
+                         cached_prefix, (int)((rec.ts_ns % 1000000000LL) / 1000), levelName(rec.level), rec.tid);
+        if (n > 0) b.len += (size_t)n;
+        memcpy(b.data + b.len, rec.msg, rec.len);
+        b.len += rec.len;
+        b.data[b.len++] = '\n';
+    }
+
+    static size_t drainRing(Ring* ring) {
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+        size_t n = head - tail;
+        for (; tail != head; ++tail) {
+            formatRecord(ring->records[tail & (LOGGER_RING_RECORDS - 1)]);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+        return n;
+    }
+
+    static size_t drainAll() {
+        std::lock_guard<std::mutex> lock(g_drain_mutex);
+        static unsigned long long reported_dropped = 0;
+        size_t total = 0;
+        int count = g_ring_count.load(std::memory_order_acquire);
+        if (count > LOGGER_MAX_THREADS) count = LOGGER_MAX_THREADS;
+        for (int i = 0; i < count; ++i) {
+            Ring* ring = reinterpret_cast<std::atomic<Ring*>*>(&g_rings[i])->load(std::memory_order_acquire);
+            if (ring) total += drainRing(ring);
+        }
+        Ring* overflow = reinterpret_cast<std::atomic<Ring*>*>(&g_overflow_ring)->load(std::memory_order_acquire);
+        if (overflow) total += drainRing(overflow);
+
+        unsigned long long dropped_now = g_dropped.load(std::memory_order_relaxed);
+        if (dropped_now != reported_dropped) {
+            Record rec;
+            rec.ts_ns = Clock::wallNs();
+            rec.tid = threadId();
+            rec.level = LOGGER_LEVEL_WARN;
+            int n = snprintf(rec.msg, sizeof(rec.msg), "logger dropped %llu records (ring full)",
+                             dropped_now - reported_dropped);
+            rec.len = (uint16_t)(n > 0 ? n : 0);
+            formatRecord(rec);
+            reported_dropped = dropped_now;
+        }
+        flushBuf(g_out_buf);
+        flushBuf(g_err_buf);
+        return total;
+    }
+
+    static void backgroundLoop() {
+        ThreadTopology::apply(ThreadTopology::Role::LOGGER);
+        while (g_running.load()) {
+            // 空闲时短暂休眠；生产者不做唤醒，保持热路径无系统调用
+            if (drainAll() == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+        drainAll();
+    }
+
+    bool init(const char* path) {
+        if (path && path[0]) {
+            int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (fd < 0) return false;
+            g_out_fd = fd;
+            g_own_fd = true;
+        }
+        startBackground();
+        return true;
+    }
+
+    void flush() {
+        drainAll();
+    }
+
+    void shutdown() {
+        if (g_stopped.exchange(true)) return;
+        if (g_running.exchange(false) && g_thread.joinable()) g_thread.join();
+        drainAll();
+        if (g_own_fd) {
+            close(g_out_fd);
+            g_out_fd = STDOUT_FILENO;
+            g_own_fd = false;
+        }
+    }
+
+    unsigned long long dropped() {
+        return g_dropped.load(std::memory_order_relaxed);
     }
-} 
\ No newline at end of file
+}
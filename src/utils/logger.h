@@ -1,9 +1,73 @@
 #pragma once
 
 #include <string>
+#include <cstddef>
 
+// 日志级别
+#define LOGGER_LEVEL_DEBUG 0
+#define LOGGER_LEVEL_INFO  1
+#define LOGGER_LEVEL_WARN  2
+#define LOGGER_LEVEL_ERROR 3
+#define LOGGER_LEVEL_OFF   4
+
+// 编译期级别过滤：低于该级别的 LOG_xxx 语句整体编译掉（embedded 目标设为 INFO）
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL LOGGER_LEVEL_DEBUG
+#endif
+
+#define LOGGER_RECORD_SIZE 256    // 每条记录固定大小（含头部），超长消息截断
+#define LOGGER_RING_RECORDS 1024  // 每线程环形缓冲的记录数（2的幂）
+#define LOGGER_MAX_THREADS 64     // 独立环的线程数，超出的线程共用一个加锁环
+
+// 异步日志：生产者把定长记录写入本线程的无锁环（SPSC），
+// 后台线程统一格式化并批量 write，热路径上没有锁和系统调用。
+// 环满时丢弃记录并计数，不阻塞调用线程。
 namespace Logger {
-    void info(const std::string& msg);
-    void debug(const std::string& msg);
-    void error(const std::string& msg);
-} 
\ No newline at end of file
+    enum class Level { DEBUG = LOGGER_LEVEL_DEBUG, INFO, WARN, ERROR };
+
+    // 可选：指定输出文件（默认 stdout，ERROR 同时写 stderr），需在首条日志前调用
+    bool init(const char* path = nullptr);
+    // 同步刷出所有已提交的记录
+    void flush();
+    // 停止后台线程并刷出剩余记录
+    void shutdown();
+    // 因环满丢弃的记录数
+    unsigned long long dropped();
+
+    void write(Level level, const char* msg, size_t len);
+    void writef(Level level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    inline void info(const std::string& msg) { write(Level::INFO, msg.data(), msg.size()); }
+    inline void debug(const std::string& msg) {
+#if LOGGER_MIN_LEVEL <= LOGGER_LEVEL_DEBUG
+        write(Level::DEBUG, msg.data(), msg.size());
+#else
+        (void)msg;
+#endif
+    }
+    inline void error(const std::string& msg) { write(Level::ERROR, msg.data(), msg.size()); }
+}
+
+#if LOGGER_MIN_LEVEL <= LOGGER_LEVEL_DEBUG
+#define LOG_DEBUG(...) Logger::writef(Logger::Level::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#if LOGGER_MIN_LEVEL <= LOGGER_LEVEL_INFO
+#define LOG_INFO(...) Logger::writef(Logger::Level::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOGGER_MIN_LEVEL <= LOGGER_LEVEL_WARN
+#define LOG_WARN(...) Logger::writef(Logger::Level::WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOGGER_MIN_LEVEL <= LOGGER_LEVEL_ERROR
+#define LOG_ERROR(...) Logger::writef(Logger::Level::ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
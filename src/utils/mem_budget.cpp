@@ -0,0 +1,66 @@
+#include "mem_budget.h"
+#include "metrics.h"
+
+namespace MemBudget {
+
+    std::atomic<int64_t> g_used[NUM_CATEGORIES];
+    std::atomic<int64_t> g_total(0);
+
+    // 配置在反应器线程上因 SIGHUP 改写，管理端线程同时在读：每项单独发布为原子量，
+    // 水位线换算成字节一并发布，读取方不会看到撕裂的值
+    static std::atomic<size_t> g_global_limit(64 * 1024 * 1024);
+    static std::atomic<size_t> g_per_client_limit(1024 * 1024);
+    static std::atomic<size_t> g_per_stream_limit(256 * 1024);
+    static std::atomic<int> g_high_pct(90);
+    static std::atomic<int> g_low_pct(75);
+    static std::atomic<int64_t> g_high_bytes((int64_t)(64 * 1024 * 1024) / 100 * 90);
+    static std::atomic<int64_t> g_low_bytes((int64_t)(64 * 1024 * 1024) / 100 * 75);
+    static std::atomic<bool> g_paused(false);
+
+    void configure(const Config& cfg) {
+        int low_pct = cfg.low_watermark_pct > cfg.high_watermark_pct ? cfg.high_watermark_pct : cfg.low_watermark_pct;
+        g_global_limit.store(cfg.global_limit, std::memory_order_relaxed);
+        g_per_client_limit.store(cfg.per_client_limit, std::memory_order_relaxed);
+        g_per_stream_limit.store(cfg.per_stream_limit, std::memory_order_relaxed);
+        g_high_pct.store(cfg.high_watermark_pct, std::memory_order_relaxed);
+        g_low_pct.store(low_pct, std::memory_order_relaxed);
+        g_high_bytes.store((int64_t)(cfg.global_limit / 100 * cfg.high_watermark_pct), std::memory_order_relaxed);
+        g_low_bytes.store((int64_t)(cfg.global_limit / 100 * low_pct), std::memory_order_relaxed);
+    }
+
+    Config config() {
+        Config c;
+        c.global_limit = g_global_limit.load(std::memory_order_relaxed);
+        c.per_client_limit = g_per_client_limit.load(std::memory_order_relaxed);
+        c.per_stream_limit = g_per_stream_limit.load(std::memory_order_relaxed);
+        c.high_watermark_pct = g_high_pct.load(std::memory_order_relaxed);
+        c.low_watermark_pct = g_low_pct.load(std::memory_order_relaxed);
+        return c;
+    }
+
+    bool underPressure() {
+        int64_t u = used();
+        int64_t high = g_high_bytes.load(std::memory_order_relaxed);
+        int64_t low = g_low_bytes.load(std::memory_order_relaxed);
+        bool p = g_paused.load(std::memory_order_relaxed);
+        if (!p && u >= high) {
+            g_paused.store(true, std::memory_order_relaxed);
+            Metrics::add(Metrics::Counter::BACKPRESSURE_PAUSES);
+            return true;
+        }
+        if (p && u <= low) {
+            g_paused.store(false, std::memory_order_relaxed);
+            return false;
+        }
+        return p;
+    }
+
+    bool paused() {
+        return g_paused.load(std::memory_order_relaxed);
+    }
+
+    const char* categoryName(Category c) {
+        static const char* names[NUM_CATEGORIES] = {"request", "task", "token"};
+        return names[static_cast<int>(c)];
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 全局内存预算：统计在途请求、任务、token 占用的字节数，超过高水位时
+// 由 reactor 暂停读取客户端（不再接收新请求），降到低水位后恢复。NPU 链路始终照常读取：
+// 积压要靠读到结束消息、失败或取消才能释放，暂停节点读取会让水位永远降不下来。
+// 另有单客户端、单流配额，用于隔离慢客户端。
+namespace MemBudget {
+
+    enum class Category {
+        REQUEST,  // 待下发请求（输入队列中的副本）
+        TASK,     // 任务缓存中的 TaskContext
+        TOKEN,    // token 链表节点
+        COUNT
+    };
+    static const int NUM_CATEGORIES = static_cast<int>(Category::COUNT);
+
+    struct Config {
+        size_t global_limit;      // 全局上限（字节）
+        size_t per_client_limit;  // 单客户端未发送 token 上限，超过后暂停读取该客户端
+        size_t per_stream_limit;  // 单个流未发送 token 上限，超过后取消该流
+        int high_watermark_pct;   // 达到该比例开始背压
+        int low_watermark_pct;    // 降到该比例解除背压
+    };
+
+    // 运行中可重新配置（反应器线程），各项以原子量发布；config() 在任意线程返回当前值的副本
+    void configure(const Config& cfg);
+    Config config();
+
+    extern std::atomic<int64_t> g_used[NUM_CATEGORIES];
+    extern std::atomic<int64_t> g_total;
+
+    inline void charge(Category c, size_t bytes) {
+        g_used[static_cast<int>(c)].fetch_add((int64_t)bytes, std::memory_order_relaxed);
+        g_total.fetch_add((int64_t)bytes, std::memory_order_relaxed);
+    }
+
+    inline void release(Category c, size_t bytes) {
+        g_used[static_cast<int>(c)].fetch_sub((int64_t)bytes, std::memory_order_relaxed);
+        g_total.fetch_sub((int64_t)bytes, std::memory_order_relaxed);
+    }
+
+    inline int64_t used() { return g_total.load(std::memory_order_relaxed); }
+    inline int64_t used(Category c) { return g_used[static_cast<int>(c)].load(std::memory_order_relaxed); }
+
+    // 是否处于背压状态（带迟滞，避免在水位线附近抖动）
+    bool underPressure();
+    // 当前是否已暂停（不重新计算）
+    bool paused();
+
+    const char* categoryName(Category c);
+}
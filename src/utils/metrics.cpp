@@ -0,0 +1,124 @@
+#include "metrics.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace Metrics {
+
+    std::atomic<int64_t> g_gauges[NUM_GAUGES];
+
+    // 分片在首次使用时 malloc，线程退出后保留（线程数量固定且长期存活）
+    // 分片指针由注册线程 release 发布，读者 acquire 读取
+    static std::atomic<ThreadSlot*> g_slots[MAX_THREADS];
+    static std::atomic<int> g_slot_count(0);
+    static std::atomic<ThreadSlot*> g_overflow_slot(nullptr);
+
+    static ThreadSlot* allocSlot(bool shared) {
+        void* mem = nullptr;
+        if (posix_memalign(&mem, 64, sizeof(ThreadSlot)) != 0) return nullptr;
+        memset(mem, 0, sizeof(ThreadSlot));
+        ThreadSlot* slot = new (mem) ThreadSlot();
+        slot->shared = shared;
+        return slot;
+    }
+
+    static ThreadSlot* overflowSlot() {
+        static ThreadSlot* slot = allocSlot(true);
+        g_overflow_slot.store(slot, std::memory_order_release);
+        return slot;
+    }
+
+    ThreadSlot* registerThread() {
+        int idx = g_slot_count.fetch_add(1);
+        if (idx >= MAX_THREADS) {
+            g_slot_count.store(MAX_THREADS);
+            return overflowSlot();
+        }
+        ThreadSlot* slot = allocSlot(false);
+        if (!slot) return overflowSlot();
+        g_slots[idx].store(slot, std::memory_order_release);
+        return slot;
+    }
+
+    template<typename Fn>
+    static void forEachSlot(Fn fn) {
+        int n = g_slot_count.load(std::memory_order_acquire);
+        if (n > MAX_THREADS) n = MAX_THREADS;
+        for (int i = 0; i < n; ++i) {
+            ThreadSlot* slot = g_slots[i].load(std::memory_order_acquire);
+            if (slot) fn(slot);
+        }
+        ThreadSlot* overflow = g_overflow_slot.load(std::memory_order_acquire);
+        if (overflow) fn(overflow);
+    }
+
+    uint64_t counter(Counter c) {
+        uint64_t total = 0;
+        forEachSlot([&](ThreadSlot* slot) {
+            total += slot->counters[static_cast<int>(c)].load(std::memory_order_relaxed);
+        });
+        return total;
+    }
+
+    void snapshot(Histogram h, HistogramSnapshot& out) {
+        memset(&out, 0, sizeof(out));
+        forEachSlot([&](ThreadSlot* slot) {
+            HistogramData& d = slot->histograms[static_cast<int>(h)];
+            out.count += d.count.load(std::memory_order_relaxed);
+            out.sum += d.sum.load(std::memory_order_relaxed);
+            uint64_t m = d.max.load(std::memory_order_relaxed);
+            if (m > out.max) out.max = m;
+            for (int i = 0; i < NUM_BUCKETS; ++i) {
+                out.buckets[i] += d.buckets[i].load(std::memory_order_relaxed);
+            }
+        });
+    }
+
+    uint64_t HistogramSnapshot::percentile(double p) const {
+        // 各分片的 count 与桶读取时间不同，以桶总数为准
+        uint64_t total = 0;
+        for (int i = 0; i < NUM_BUCKETS; ++i) total += buckets[i];
+        if (total == 0) return 0;
+        uint64_t rank = (uint64_t)(p / 100.0 * total);
+        if (rank >= total) rank = total - 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < NUM_BUCKETS; ++i) {
+            seen += buckets[i];
+            if (seen > rank) {
+                uint64_t v = bucketLowerBound(i);
+                return v < max ? v : max;
+            }
+        }
+        return max;
+    }
+
+    const char* counterName(Counter c) {
+        static const char* names[NUM_COUNTERS] = {
+            "client_accepted", "client_rejected", "client_closed",
+            "request_parsed", "request_parse_error",
+            "task_created", "task_coalesced", "task_promoted", "task_dispatched",
+            "npu_messages", "tokens_received", "tokens_delivered",
+            "task_completed", "task_failed",
+            "backpressure_pauses", "streams_over_quota",
+            "client_idle_timeout", "client_write_timeout", "npu_liveness_timeout",
+            "request_rate_limited", "config_reloaded", "client_handed_off",
+            "task_stolen", "request_routed_warm", "request_routed_cold", "request_unroutable",
+            "stream_node_lost", "stream_idle_timeout"
+        };
+        return names[static_cast<int>(c)];
+    }
+
+    const char* histogramName(Histogram h) {
+        static const char* names[NUM_HISTOGRAMS] = {
+            "parse_ns", "queue_wait_ns", "dispatch_ns", "ttft_ns", "token_delivery_ns", "completion_ns"
+        };
+        return names[static_cast<int>(h)];
+    }
+
+    const char* gaugeName(Gauge g) {
+        static const char* names[NUM_GAUGES] = {
+            "clients_connected", "client_streams", "npu_nodes_connected"
+        };
+        return names[static_cast<int>(g)];
+    }
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "clock.h"
+
+// 指标子系统：每线程分片计数器 + 对数分桶延迟直方图
+// 写入只操作本线程的分片（无锁、无共享缓存行），读取时汇总所有分片
+namespace Metrics {
+
+    // 计数器
+    enum class Counter {
+        CLIENT_ACCEPTED,      // 接受的客户端连接
+        CLIENT_REJECTED,      // 超过上限被拒绝的连接
+        CLIENT_CLOSED,        // 断开的客户端连接
+        REQUEST_PARSED,       // 解析成功的请求
+        REQUEST_PARSE_ERROR,  // 解析失败的请求
+        TASK_CREATED,         // 创建的任务
+        TASK_COALESCED,       // 合并到在途请求的任务
+        TASK_PROMOTED,        // leader 断开或失败后接替为 leader 的 follower
+        TASK_DISPATCHED,      // 下发到NPU的任务
+        NPU_MESSAGES,         // 收到的NPU消息
+        TOKENS_RECEIVED,      // 收到的token
+        TOKENS_DELIVERED,     // 发给客户端的token
+        TASK_COMPLETED,       // 完成的任务
+        TASK_FAILED,          // 失败的任务
+        BACKPRESSURE_PAUSES,  // 内存超过高水位进入背压的次数
+        STREAMS_OVER_QUOTA,   // 因未发送 token 超过单流配额被取消的流
+        CLIENT_IDLE_TIMEOUT,  // 空闲超时被回收的客户端连接
+        CLIENT_WRITE_TIMEOUT, // 写停滞超时被断开的客户端连接
+        NPU_LIVENESS_TIMEOUT, // 超过失联时间没有消息被断开的NPU节点
+        REQUEST_RATE_LIMITED, // 超过单客户端速率或并发流上限被拒绝的请求
+        CONFIG_RELOADED,      // SIGHUP 成功重新加载配置的次数
+        CLIENT_HANDED_OFF,    // 热重启时移交给新进程的客户端连接
+        TASK_STOLEN,          // 下发工作池中被空闲线程窃取执行的客户端队列
+        REQUEST_ROUTED_WARM,  // 下发到已加载所请求模型的节点
+        REQUEST_ROUTED_COLD,  // 下发到尚未加载该模型的节点（节点需加载模型）
+        REQUEST_UNROUTABLE,   // 没有可用节点或发送失败
+        STREAM_NODE_LOST,     // 所在节点断开或失联而失败的在途流
+        STREAM_IDLE_TIMEOUT,  // 超过 stream_idle_ms 没有 token 到达而失败的在途流
+        COUNT
+    };
+
+    // 延迟直方图（单位纳秒）
+    enum class Histogram {
+        PARSE,           // 请求解析耗时
+        QUEUE_WAIT,      // 进入下发池到被下发线程取出的排队时间
+        DISPATCH,        // 下发到NPU的发送耗时
+        TTFT,            // 请求受理到首个token到达
+        TOKEN_DELIVERY,  // token到达网关到发给客户端
+        COMPLETION,      // 请求受理到生成结束
+        COUNT
+    };
+
+    // 瞬时值，由状态的拥有者线程写入
+    enum class Gauge {
+        CLIENTS_CONNECTED,    // 当前客户端连接数
+        CLIENT_STREAMS,       // 等待 token 下发的客户端请求数
+        NPU_NODES_CONNECTED,  // 已连接的NPU节点数
+        COUNT
+    };
+
+    static const int NUM_COUNTERS = static_cast<int>(Counter::COUNT);
+    static const int NUM_HISTOGRAMS = static_cast<int>(Histogram::COUNT);
+    static const int NUM_GAUGES = static_cast<int>(Gauge::COUNT);
+
+    // 对数-线性分桶：每个2的幂区间分为 2^SUB_BUCKET_BITS 个子桶，相对误差约 12.5%
+    static const int SUB_BUCKET_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_EXPONENT = 40;  // 最大约 2^40 ns ≈ 18 分钟，更大的值计入最后一个桶
+    static const int NUM_BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+    static const int MAX_THREADS = 64;  // 独立分片的线程数，超出的线程共用一个原子分片
+
+    inline int bucketIndex(uint64_t v) {
+        if (v < (uint64_t)SUB_BUCKETS) return (int)v;
+        int exp = 63 - __builtin_clzll(v);
+        if (exp > MAX_EXPONENT) return NUM_BUCKETS - 1;
+        int sub = (int)((v >> (exp - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+        return (exp - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+    }
+
+    // 桶下界，用于估算百分位
+    inline uint64_t bucketLowerBound(int idx) {
+        if (idx < SUB_BUCKETS) return (uint64_t)idx;
+        int exp = idx / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+        int sub = idx % SUB_BUCKETS;
+        return ((uint64_t)SUB_BUCKETS + sub) << (exp - SUB_BUCKET_BITS);
+    }
+
+    struct HistogramData {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> max;
+        std::atomic<uint64_t> buckets[NUM_BUCKETS];
+    };
+
+    // 每线程分片，按缓存行对齐
+    struct alignas(64) ThreadSlot {
+        bool shared;  // 溢出分片由多个线程共用，需要原子加
+        std::atomic<uint64_t> counters[NUM_COUNTERS];
+        HistogramData histograms[NUM_HISTOGRAMS];
+    };
+
+    // 获取当前线程的分片（首次调用时注册）
+    ThreadSlot* registerThread();
+
+    inline ThreadSlot* threadSlot() {
+        static thread_local ThreadSlot* slot = nullptr;
+        if (!slot) slot = registerThread();
+        return slot;
+    }
+
+    // 单写者分片用 load+store 即可，避免带锁的原子指令
+    inline void bump(ThreadSlot* slot, std::atomic<uint64_t>& cell, uint64_t v) {
+        if (slot->shared) cell.fetch_add(v, std::memory_order_relaxed);
+        else cell.store(cell.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    }
+
+    inline void add(Counter c, uint64_t v = 1) {
+        ThreadSlot* slot = threadSlot();
+        bump(slot, slot->counters[static_cast<int>(c)], v);
+    }
+
+    inline void record(Histogram h, uint64_t ns) {
+        ThreadSlot* slot = threadSlot();
+        HistogramData& d = slot->histograms[static_cast<int>(h)];
+        bump(slot, d.buckets[bucketIndex(ns)], 1);
+        bump(slot, d.count, 1);
+        bump(slot, d.sum, ns);
+        uint64_t cur = d.max.load(std::memory_order_relaxed);
+        while (ns > cur && !d.max.compare_exchange_weak(cur, ns, std::memory_order_relaxed)) {}
+    }
+
+    // 单调时钟，纳秒（见 Clock::nowNs）
+    inline long long nowNs() {
+        return Clock::nowNs();
+    }
+
+    // 记录 start_ns 到现在的耗时；start_ns 为0时忽略
+    inline void recordSince(Histogram h, long long start_ns) {
+        if (start_ns <= 0) return;
+        long long d = nowNs() - start_ns;
+        record(h, d > 0 ? (uint64_t)d : 0);
+    }
+
+    // 瞬时值：全局原子变量，写入频率低（连接建立/断开时），无需分片
+    extern std::atomic<int64_t> g_gauges[NUM_GAUGES];
+
+    inline void setGauge(Gauge g, int64_t v) {
+        g_gauges[static_cast<int>(g)].store(v, std::memory_order_relaxed);
+    }
+
+    inline int64_t gauge(Gauge g) {
+        return g_gauges[static_cast<int>(g)].load(std::memory_order_relaxed);
+    }
+
+    // 直方图汇总快照
+    struct HistogramSnapshot {
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+        uint64_t buckets[NUM_BUCKETS];
+
+        double mean() const { return count ? (double)sum / count : 0.0; }
+        // 百分位估算（取桶下界），p 取值 0~100
+        uint64_t percentile(double p) const;
+    };
+
+    // 读取接口：汇总所有线程分片，不阻塞写者
+    uint64_t counter(Counter c);
+    void snapshot(Histogram h, HistogramSnapshot& out);
+
+    const char* counterName(Counter c);
+    const char* histogramName(Histogram h);
+    const char* gaugeName(Gauge g);
+}
@@ -0,0 +1,141 @@
+#include "prealloc.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+
+#define PREALLOC_HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+#define PREALLOC_ALIGN 64
+
+namespace Prealloc {
+
+    static char* g_region = nullptr;
+    static size_t g_region_size = 0;
+    static size_t g_region_used = 0;
+    static bool g_huge = false;
+    static bool g_locked = false;
+
+    static size_t roundUp(size_t v, size_t align) {
+        return (v + align - 1) / align * align;
+    }
+
+    bool init(size_t bytes, bool huge_pages, bool lock_memory) {
+        if (g_region) return false;
+        void* mem = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (huge_pages) {
+            size_t size = roundUp(bytes, PREALLOC_HUGE_PAGE_SIZE);
+            mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+            if (mem != MAP_FAILED) {
+                g_region_size = size;
+                g_huge = true;
+            }
+        }
+#endif
+        if (mem == MAP_FAILED) {
+            // 未预留 hugetlbfs 页时退回普通页，并建议内核使用透明大页
+            size_t size = roundUp(bytes, (size_t)sysconf(_SC_PAGESIZE));
+            mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+            if (mem == MAP_FAILED) {
+                perror("prealloc mmap");
+                return false;
+            }
+#ifdef MADV_HUGEPAGE
+            if (huge_pages) madvise(mem, size, MADV_HUGEPAGE);
+#endif
+            g_region_size = size;
+        }
+        g_region = (char*)mem;
+        g_region_used = 0;
+        // MAP_POPULATE 在部分内核上可能不生效，逐页写一次确保已分配物理页
+        memset(g_region, 0, g_region_size);
+
+        if (lock_memory) {
+            // 锁定当前全部映射（含 .bss 中的静态表和收发缓冲）以及之后的新映射
+            if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+                g_locked = true;
+            } else {
+                perror("prealloc mlockall");
+            }
+        }
+        return true;
+    }
+
+    void* carve(size_t bytes) {
+        if (!g_region) return nullptr;
+        size_t size = roundUp(bytes, PREALLOC_ALIGN);
+        if (g_region_used + size > g_region_size) return nullptr;
+        void* p = g_region + g_region_used;
+        g_region_used += size;
+        return p;
+    }
+
+    void shutdown() {
+        if (g_locked) munlockall();
+        if (g_region) munmap(g_region, g_region_size);
+        g_region = nullptr;
+        g_region_size = g_region_used = 0;
+        g_huge = g_locked = false;
+    }
+
+    void* allocTable(size_t bytes, size_t& mapped) {
+        mapped = 0;
+        void* p = carve(bytes);
+        if (p) {
+            memset(p, 0, bytes);
+            return p;
+        }
+        p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return nullptr;
+        mapped = bytes;
+        return p;
+    }
+
+    void freeTable(void* p, size_t mapped) {
+        if (p && mapped) munmap(p, mapped);
+    }
+
+    bool active() { return g_region != nullptr; }
+    bool usingHugePages() { return g_huge; }
+    bool memoryLocked() { return g_locked; }
+    size_t regionSize() { return g_region_size; }
+    size_t regionUsed() { return g_region_used; }
+}
+
+bool SlabPool::init(void* mem, size_t slot_size, size_t count) {
+    if (!mem || count == 0) return false;
+    slot_size_ = (slot_size + PREALLOC_ALIGN - 1) / PREALLOC_ALIGN * PREALLOC_ALIGN;
+    if (slot_size_ < sizeof(FreeNode)) slot_size_ = sizeof(FreeNode);
+    base_ = (char*)mem;
+    end_ = base_ + slot_size_ * count;
+    capacity_ = count;
+    used_.store(0, std::memory_order_relaxed);
+    free_list_ = nullptr;
+    for (size_t i = count; i > 0; --i) {
+        FreeNode* n = (FreeNode*)(base_ + (i - 1) * slot_size_);
+        n->next = free_list_;
+        free_list_ = n;
+    }
+    return true;
+}
+
+void* SlabPool::alloc() {
+    lock();
+    FreeNode* n = free_list_;
+    if (n) free_list_ = n->next;
+    unlock();
+    if (n) used_.fetch_add(1, std::memory_order_relaxed);
+    return n;
+}
+
+void SlabPool::free(void* p) {
+    if (!p) return;
+    FreeNode* n = (FreeNode*)p;
+    lock();
+    n->next = free_list_;
+    free_list_ = n;
+    unlock();
+    used_.fetch_sub(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 预分配模式：启动时一次性申请一块内存区域（优先大页），预先触碰所有页并 mlock，
+// 各对象池从该区域切分。进入稳态后热路径对象（token 节点、任务上下文）只从池中取，
+// 不再触发缺页和 malloc。池耗尽时退回 malloc，保证功能不受影响。
+namespace Prealloc {
+
+    struct Config {
+        size_t token_slots;  // token 节点池容量
+        size_t token_text_slots;  // 长 token 文本池容量（超出节点内联长度的 token，见 TOKEN_TEXT_SLOT_SIZE）
+        size_t task_slots;   // 任务上下文池容量
+        size_t recv_bufs;    // 接收缓冲池容量（BufPool）
+        bool huge_pages;     // 尝试使用 2MB 大页
+        bool lock_memory;    // mlockall，防止换出并锁定后续分配
+    };
+
+    // 申请区域（bytes 会向上取整到页/大页），失败返回 false
+    bool init(size_t bytes, bool huge_pages, bool lock_memory);
+    // 从区域中切出一段（64 字节对齐）；区域不足返回 nullptr
+    void* carve(size_t bytes);
+    void shutdown();
+
+    // 启动期分配的定长表：优先从区域中切分，未启用或区域不足时单独 mmap，都不经过 malloc。
+    // 返回的内存已清零；mapped 返回需由 freeTable 归还的字节数（切分所得为 0）
+    void* allocTable(size_t bytes, size_t& mapped);
+    void freeTable(void* p, size_t mapped);
+
+    bool active();
+    bool usingHugePages();
+    bool memoryLocked();
+    size_t regionSize();
+    size_t regionUsed();
+}
+
+// 定长对象池：空闲链表 + 自旋锁，临界区只有几条指令
+class SlabPool {
+public:
+    SlabPool() : base_(nullptr), end_(nullptr), free_list_(nullptr), slot_size_(0), capacity_(0), used_(0) {}
+
+    // mem 至少 slot_size * count 字节
+    bool init(void* mem, size_t slot_size, size_t count);
+    // 池耗尽或未初始化时返回 nullptr
+    void* alloc();
+    void free(void* p);
+    bool owns(const void* p) const { return p >= base_ && p < end_; }
+
+    size_t capacity() const { return capacity_; }
+    size_t used() const { return used_.load(std::memory_order_relaxed); }
+    size_t slotSize() const { return slot_size_; }
+
+private:
+    struct FreeNode { FreeNode* next; };
+
+    void lock() { while (lock_.test_and_set(std::memory_order_acquire)) {} }
+    void unlock() { lock_.clear(std::memory_order_release); }
+
+    char* base_;
+    char* end_;
+    FreeNode* free_list_;
+    size_t slot_size_;
+    size_t capacity_;
+    std::atomic<size_t> used_;
+    std::atomic_flag lock_ = ATOMIC_FLAG_INIT;
+};
@@ -0,0 +1,68 @@
+#include "request_id.h"
+#include "clock.h"
+#include <atomic>
+#include <mutex>
+
+namespace RequestId {
+
+    struct ThreadState {
+        bool ready;
+        uint32_t shard;
+        uint32_t epoch;
+        uint32_t counter;
+    };
+
+    static thread_local ThreadState t_state = {false, 0, 0, 0};
+    // 自动分配的 shard 从高位往下取，避免与 reactor 显式指定的低位 shard 冲突
+    static std::atomic<uint32_t> g_auto_shards(0);
+
+    static const uint32_t EPOCH_MASK = (1u << EPOCH_BITS) - 1;
+    // 各线程从同一个起始 epoch 开始（shard 不同），counter 回绕时从 g_next_epoch 取新的
+    static uint32_t g_base_epoch = 0;
+    static std::atomic<uint32_t> g_next_epoch(0);
+    static std::once_flag g_epoch_once;
+
+    static void initEpoch(uint32_t epoch) {
+        g_base_epoch = epoch & EPOCH_MASK;
+        g_next_epoch.store(g_base_epoch + 1, std::memory_order_relaxed);
+    }
+
+    static uint32_t baseEpoch() {
+        std::call_once(g_epoch_once, []() { initEpoch((uint32_t)(Clock::wallMs() / 1000)); });
+        return g_base_epoch;
+    }
+
+    void setBaseEpoch(uint32_t epoch) {
+        std::call_once(g_epoch_once, [epoch]() { initEpoch(epoch); });
+    }
+
+    uint32_t lastEpoch() {
+        baseEpoch();
+        return (g_next_epoch.load(std::memory_order_relaxed) - 1) & EPOCH_MASK;
+    }
+
+    static void initThread(ThreadState& st, uint32_t shard) {
+        st.shard = shard & (MAX_SHARDS - 1);
+        st.epoch = baseEpoch();
+        st.counter = 0;
+        st.ready = true;
+    }
+
+    void setThreadShard(uint32_t shard) {
+        initThread(t_state, shard);
+    }
+
+    uint64_t next() {
+        ThreadState& st = t_state;
+        if (!st.ready) {
+            uint32_t n = g_auto_shards.fetch_add(1, std::memory_order_relaxed);
+            initThread(st, MAX_SHARDS - 1 - (n % MAX_SHARDS));
+        }
+        if (++st.counter == 0) {
+            st.epoch = g_next_epoch.fetch_add(1, std::memory_order_relaxed) & EPOCH_MASK;
+        }
+        return ((uint64_t)st.shard << (EPOCH_BITS + COUNTER_BITS)) |
+               ((uint64_t)st.epoch << COUNTER_BITS) |
+               st.counter;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64 位请求 id：| shard 10 位 | epoch 22 位 | counter 32 位 |
+//  - shard：每个生成线程独占一个，reactor 可显式指定，其余线程自动分配
+//  - epoch：进程级，启动时取墙钟秒数（22 位约 48 天回绕）；线程的 counter 回绕时从进程内再分配一个新 epoch。
+//    热重启时旧进程把 lastEpoch() + 1 经热重启通道交给新进程，新进程由 setBaseEpoch 从它开始分配，
+//    新旧进程同时在线（shard 分配相同）也不会生成相同的 id
+//  - counter：线程内递增
+// 生成只操作线程局部状态，无锁、无原子操作；只在协议边界渲染为 16 位十六进制文本。
+namespace RequestId {
+
+    static const int SHARD_BITS = 10;
+    static const int EPOCH_BITS = 22;
+    static const int COUNTER_BITS = 32;
+    static const uint32_t MAX_SHARDS = 1u << SHARD_BITS;
+    static const size_t TEXT_SIZE = 17;  // 16 位十六进制 + '\0'
+
+    // 设定进程的起始 epoch，需在生成任何 id（含 setThreadShard）之前调用；未调用时取墙钟秒数
+    void setBaseEpoch(uint32_t epoch);
+    // 进程已分配的最大 epoch
+    uint32_t lastEpoch();
+    // 为当前线程指定 shard（需在该线程首次生成 id 之前调用）
+    void setThreadShard(uint32_t shard);
+    // 生成下一个 id（线程安全，无竞争）
+    uint64_t next();
+
+    inline uint32_t shardOf(uint64_t id) { return (uint32_t)(id >> (EPOCH_BITS + COUNTER_BITS)); }
+    inline uint32_t epochOf(uint64_t id) { return (uint32_t)(id >> COUNTER_BITS) & ((1u << EPOCH_BITS) - 1); }
+    inline uint32_t counterOf(uint64_t id) { return (uint32_t)id; }
+
+    // 渲染为定长十六进制文本，buf 至少 TEXT_SIZE 字节，返回长度 16
+    inline size_t format(uint64_t id, char* buf) {
+        static const char hex[] = "0123456789abcdef";
+        for (int i = 15; i >= 0; --i) {
+            buf[i] = hex[id & 0xf];
+            id >>= 4;
+        }
+        buf[16] = '\0';
+        return 16;
+    }
+
+    // 解析 format 生成的文本；非本格式的 id（客户端自带）返回 false
+    inline bool parse(const char* s, size_t len, uint64_t& out) {
+        if (len != 16) return false;
+        uint64_t v = 0;
+        for (size_t i = 0; i < len; ++i) {
+            char c = s[i];
+            uint64_t d;
+            if (c >= '0' && c <= '9') d = (uint64_t)(c - '0');
+            else if (c >= 'a' && c <= 'f') d = (uint64_t)(c - 'a' + 10);
+            else return false;
+            v = (v << 4) | d;
+        }
+        out = v;
+        return true;
+    }
+
+    inline std::string toString(uint64_t id) {
+        char buf[TEXT_SIZE];
+        return std::string(buf, format(id, buf));
+    }
+}
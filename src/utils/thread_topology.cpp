@@ -0,0 +1,205 @@
+#include "thread_topology.h"
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+namespace ThreadTopology {
+
+    static cpu_set_t g_process_cpus;  // 进程启动时的 CPU 集合，未绑定的角色恢复为它
+    static cpu_set_t g_big;
+    static cpu_set_t g_little;
+    static std::once_flag g_init_once;
+    static Placement g_roles[NUM_ROLES];
+
+    // 读取 sysfs 中的一个整数，不存在时返回 -1
+    static long readSysLong(const char* fmt, int cpu) {
+        char path[128];
+        snprintf(path, sizeof(path), fmt, cpu);
+        FILE* f = fopen(path, "r");
+        if (!f) return -1;
+        long v = -1;
+        if (fscanf(f, "%ld", &v) != 1) v = -1;
+        fclose(f);
+        return v;
+    }
+
+    // 大核为 capacity（或最高频率）最大的一组，其余为小核；读不到时视为同构
+    static void detectClusters() {
+        long cap[CPU_SETSIZE];
+        long best = -1;
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            cap[c] = -1;
+            if (!CPU_ISSET(c, &g_process_cpus)) continue;
+            cap[c] = readSysLong("/sys/devices/system/cpu/cpu%d/cpu_capacity", c);
+            if (cap[c] < 0) cap[c] = readSysLong("/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", c);
+            if (cap[c] > best) best = cap[c];
+        }
+        CPU_ZERO(&g_big);
+        CPU_ZERO(&g_little);
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (!CPU_ISSET(c, &g_process_cpus)) continue;
+            if (cap[c] == best) CPU_SET(c, &g_big);
+            else CPU_SET(c, &g_little);
+        }
+        if (CPU_COUNT(&g_little) == 0) g_little = g_big;
+    }
+
+    static void initOnce() {
+        CPU_ZERO(&g_process_cpus);
+        if (sched_getaffinity(0, sizeof(g_process_cpus), &g_process_cpus) != 0) {
+            for (int c = 0; c < CPU_SETSIZE && c < (int)sysconf(_SC_NPROCESSORS_CONF); ++c) CPU_SET(c, &g_process_cpus);
+        }
+        detectClusters();
+        for (auto& r : g_roles) {
+            r.pinned = false;
+            CPU_ZERO(&r.cpus);
+            r.policy = Policy::DEFAULT;
+            r.priority = 0;
+        }
+    }
+
+    // 线程安全：未在 main 中提前调用时，最先启动的线程负责初始化
+    void init() {
+        std::call_once(g_init_once, initOnce);
+    }
+
+    void configure(Role role, const Placement& placement) {
+        init();
+        g_roles[static_cast<int>(role)] = placement;
+    }
+
+    const Placement& placement(Role role) {
+        init();
+        return g_roles[static_cast<int>(role)];
+    }
+
+    // 集合中的第 index 个核心（按集合大小取模）
+    static int nthCpu(const cpu_set_t& set, int index) {
+        int count = CPU_COUNT(&set);
+        if (count == 0) return -1;
+        index %= count;
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set) && index-- == 0) return c;
+        }
+        return -1;
+    }
+
+    bool apply(Role role, int index) {
+        init();
+        const Placement& p = g_roles[static_cast<int>(role)];
+        char name[16];
+        if (index >= 0) snprintf(name, sizeof(name), "gw-%s%d", roleName(role), index);
+        else snprintf(name, sizeof(name), "gw-%s", roleName(role));
+        pthread_setname_np(pthread_self(), name);
+
+        cpu_set_t set = p.pinned ? p.cpus : g_process_cpus;
+        if (p.pinned && index >= 0) {
+            int cpu = nthCpu(p.cpus, index);
+            CPU_ZERO(&set);
+            if (cpu >= 0) CPU_SET(cpu, &set);
+        }
+        bool ok = sched_setaffinity(0, sizeof(set), &set) == 0;
+
+        if (p.policy == Policy::FIFO || p.policy == Policy::RR) {
+            sched_param sp{};
+            sp.sched_priority = p.priority;
+            int policy = p.policy == Policy::FIFO ? SCHED_FIFO : SCHED_RR;
+            ok &= pthread_setschedparam(pthread_self(), policy, &sp) == 0;
+        } else {
+            // 显式回到 SCHED_OTHER：线程可能继承了创建者的实时策略（或之前按实时角色放置过）
+            sched_param sp{};
+            ok &= pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp) == 0;
+            // nice 值按线程（tid）生效
+            if (p.priority != 0) ok &= setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), p.priority) == 0;
+        }
+        return ok;
+    }
+
+    bool parseCpus(const char* spec, Placement& out) {
+        init();
+        CPU_ZERO(&out.cpus);
+        out.pinned = false;
+        if (!spec || !*spec) return true;
+        if (strcmp(spec, "all") == 0) out.cpus = g_process_cpus;
+        else if (strcmp(spec, "big") == 0) out.cpus = g_big;
+        else if (strcmp(spec, "little") == 0) out.cpus = g_little;
+        else {
+            const char* s = spec;
+            while (*s) {
+                char* end;
+                long lo = strtol(s, &end, 10);
+                if (end == s || lo < 0 || lo >= CPU_SETSIZE) return false;
+                long hi = lo;
+                s = end;
+                if (*s == '-') {
+                    hi = strtol(s + 1, &end, 10);
+                    if (end == s + 1 || hi < lo || hi >= CPU_SETSIZE) return false;
+                    s = end;
+                }
+                for (long c = lo; c <= hi; ++c) CPU_SET((int)c, &out.cpus);
+                if (*s == ',') ++s;
+                else if (*s) return false;
+            }
+        }
+        // 只保留进程可用的核心
+        CPU_AND(&out.cpus, &out.cpus, &g_process_cpus);
+        out.pinned = true;
+        return CPU_COUNT(&out.cpus) > 0;
+    }
+
+    bool parsePolicy(const char* name, Policy& out) {
+        if (!name || !*name || strcmp(name, "default") == 0 || strcmp(name, "other") == 0) out = Policy::DEFAULT;
+        else if (strcmp(name, "fifo") == 0) out = Policy::FIFO;
+        else if (strcmp(name, "rr") == 0) out = Policy::RR;
+        else return false;
+        return true;
+    }
+
+    std::string formatCpus(const Placement& p) {
+        if (!p.pinned) return "all";
+        std::string out;
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (!CPU_ISSET(c, &p.cpus)) continue;
+            int hi = c;
+            while (hi + 1 < CPU_SETSIZE && CPU_ISSET(hi + 1, &p.cpus)) ++hi;
+            if (!out.empty()) out += ",";
+            out += std::to_string(c);
+            if (hi > c) out += "-" + std::to_string(hi);
+            c = hi;
+        }
+        return out;
+    }
+
+    const char* roleName(Role role) {
+        static const char* names[NUM_ROLES] = {"reactor", "dispatch", "response", "admin", "logger"};
+        return names[static_cast<int>(role)];
+    }
+
+    const char* policyName(Policy policy) {
+        switch (policy) {
+        case Policy::FIFO: return "fifo";
+        case Policy::RR: return "rr";
+        default: return "default";
+        }
+    }
+
+    bool samePlacement(const Placement& a, const Placement& b) {
+        if (a.pinned != b.pinned || a.policy != b.policy || a.priority != b.priority) return false;
+        return !a.pinned || CPU_EQUAL(&a.cpus, &b.cpus);
+    }
+
+    const cpu_set_t& bigCores() {
+        init();
+        return g_big;
+    }
+
+    const cpu_set_t& littleCores() {
+        init();
+        return g_little;
+    }
+}
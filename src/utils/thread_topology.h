@@ -0,0 +1,53 @@
+#pragma once
+
+#include <sched.h>
+#include <string>
+
+// 线程拓扑：按角色把线程固定到指定核心/簇，并可设置实时调度。
+// 每个线程在启动后、第一次分配线程私有数据（日志环、指标槽、接收缓冲）之前调用 apply()，
+// 这些数据按首次触碰落在所固定核心的本地内存上；big.LITTLE 板上可把反应器放到大核、日志与管理放到小核。
+// 未配置的角色恢复为进程启动时的 CPU 集合（不继承创建者的绑定），调度策略不变。
+namespace ThreadTopology {
+
+    enum class Role {
+        REACTOR,        // 主事件循环（客户端与 NPU 收发）
+        TASK_DISPATCH,  // TaskManager 任务下发
+        TASK_RESPONSE,  // TaskManager 响应处理
+        ADMIN,          // 管理端点
+        LOGGER,         // 日志后台线程
+        COUNT
+    };
+    static const int NUM_ROLES = static_cast<int>(Role::COUNT);
+
+    enum class Policy { DEFAULT, FIFO, RR };  // SCHED_OTHER / SCHED_FIFO / SCHED_RR
+
+    struct Placement {
+        bool pinned;       // false 时不限制核心
+        cpu_set_t cpus;
+        Policy policy;
+        int priority;      // FIFO/RR 的实时优先级（1~99）；DEFAULT 时为 nice 值（-20~19，0 不修改），策略总会重置为 SCHED_OTHER
+    };
+
+    // 记录进程启动时允许的 CPU 集合并探测大小核，应在启动其他线程前调用
+    void init();
+    void configure(Role role, const Placement& placement);
+    const Placement& placement(Role role);
+
+    // 由线程自身调用：设置核心绑定、调度策略与线程名（gw-<role>）。
+    // index >= 0 时只绑定到集合中的第 index 个核心（按集合大小取模），用于同一角色的多个线程各占一核。
+    // 实时调度需要 CAP_SYS_NICE，失败时核心绑定仍然生效，返回 false
+    bool apply(Role role, int index = -1);
+
+    // 解析核心列表："0-3,6"、"big"、"little"、"all"，空串表示不绑定；无效或为空集时返回 false
+    bool parseCpus(const char* spec, Placement& out);
+    bool parsePolicy(const char* name, Policy& out);
+    // 格式化为 "0-3,6" 形式，未绑定时为 "all"
+    std::string formatCpus(const Placement& p);
+    const char* roleName(Role role);
+    const char* policyName(Policy policy);
+    bool samePlacement(const Placement& a, const Placement& b);
+
+    // 大小核：按 cpu_capacity（arm）或最高频率分组，同构系统上二者均为全部核心
+    const cpu_set_t& bigCores();
+    const cpu_set_t& littleCores();
+}
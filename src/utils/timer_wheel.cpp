@@ -0,0 +1,76 @@
+#include "timer_wheel.h"
+#include <cstdlib>
+
+TimerWheel::~TimerWheel() {
+    free(nodes_);
+    free(heads_);
+}
+
+bool TimerWheel::init(uint32_t capacity, uint32_t tick_ms, uint32_t slots, int64_t now_ms) {
+    if (nodes_ || capacity == 0 || tick_ms == 0 || slots == 0 || (slots & (slots - 1)) != 0) return false;
+    nodes_ = (Node*)malloc(sizeof(Node) * capacity);
+    heads_ = (uint32_t*)malloc(sizeof(uint32_t) * (slots + 1));
+    if (!nodes_ || !heads_) {
+        free(nodes_);
+        free(heads_);
+        nodes_ = nullptr;
+        heads_ = nullptr;
+        return false;
+    }
+    for (uint32_t i = 0; i < capacity; ++i) nodes_[i] = {0, NIL, NIL, NIL};
+    for (uint32_t i = 0; i <= slots; ++i) heads_[i] = NIL;
+    capacity_ = capacity;
+    slots_ = slots;
+    tick_ms_ = tick_ms;
+    cur_tick_ = now_ms / tick_ms;
+    count_ = 0;
+    return true;
+}
+
+void TimerWheel::link(uint32_t id, uint32_t bucket) {
+    Node& n = nodes_[id];
+    n.bucket = bucket;
+    n.prev = NIL;
+    n.next = heads_[bucket];
+    if (n.next != NIL) nodes_[n.next].prev = id;
+    heads_[bucket] = id;
+    ++count_;
+}
+
+void TimerWheel::unlink(uint32_t id) {
+    Node& n = nodes_[id];
+    if (n.prev != NIL) nodes_[n.prev].next = n.next;
+    else heads_[n.bucket] = n.next;
+    if (n.next != NIL) nodes_[n.next].prev = n.prev;
+    n.prev = n.next = n.bucket = NIL;
+    --count_;
+}
+
+uint32_t TimerWheel::bucketFor(int64_t deadline_ms) const {
+    // 已过期的截止时间落到下一个 tick
+    int64_t tick = deadline_ms / tick_ms_;
+    if (tick <= cur_tick_) tick = cur_tick_ + 1;
+    return (uint32_t)(tick & (slots_ - 1));
+}
+
+void TimerWheel::schedule(uint32_t id, int64_t deadline_ms) {
+    if (id >= capacity_) return;
+    if (nodes_[id].bucket != NIL) unlink(id);
+    nodes_[id].deadline = deadline_ms;
+    link(id, bucketFor(deadline_ms));
+}
+
+void TimerWheel::cancel(uint32_t id) {
+    if (id < capacity_ && nodes_[id].bucket != NIL) unlink(id);
+}
+
+int TimerWheel::nextTimeoutMs(int64_t now_ms) const {
+    if (count_ == 0) return -1;
+    for (uint32_t i = 1; i <= slots_; ++i) {
+        int64_t tick = cur_tick_ + i;
+        if (heads_[tick & (slots_ - 1)] == NIL) continue;
+        int64_t wait = tick * tick_ms_ - now_ms;
+        return wait > 0 ? (int)wait : 0;
+    }
+    return -1;
+}
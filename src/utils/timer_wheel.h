@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 哈希时间轮：按 id（通常是连接槽号）挂定时器，调度/取消/到期均为 O(1)
+// 节点侵入式双向链表存放在预分配数组中，不在运行期分配内存。
+// 超出轮一圈的截止时间照常落桶，触发时未到期则重新入桶（多圈）。
+// 热路径上的活动（收发数据）只需更新调用方自己的时间戳，不必重排定时器：
+// 到期回调里按最新时间戳算出真正的截止时间，未到则重新调度。
+class TimerWheel {
+public:
+    static const uint32_t NIL = 0xffffffffu;
+
+    TimerWheel() : nodes_(nullptr), heads_(nullptr), capacity_(0), slots_(0), tick_ms_(1), cur_tick_(0), count_(0) {}
+    ~TimerWheel();
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // capacity 个 id（0..capacity-1），slots 个桶（2 的幂），每桶 tick_ms 毫秒
+    bool init(uint32_t capacity, uint32_t tick_ms, uint32_t slots, int64_t now_ms);
+    // 设定（或移动）id 的截止时间
+    void schedule(uint32_t id, int64_t deadline_ms);
+    void cancel(uint32_t id);
+    bool scheduled(uint32_t id) const { return id < capacity_ && nodes_[id].bucket != NIL; }
+    // 已调度 id 的截止时间，未调度时返回 -1
+    int64_t deadline(uint32_t id) const { return scheduled(id) ? nodes_[id].deadline : -1; }
+    size_t size() const { return count_; }
+
+    // 推进到 now_ms，对每个到期的 id 调用 on_expire(id)；回调内可重新调度或取消任意 id
+    template <class F>
+    size_t advance(int64_t now_ms, F&& on_expire);
+
+    // 距下一个非空桶到期的毫秒数，用作事件循环的等待超时；没有定时器时返回 -1
+    int nextTimeoutMs(int64_t now_ms) const;
+
+private:
+    struct Node {
+        int64_t deadline;
+        uint32_t prev;
+        uint32_t next;
+        uint32_t bucket;  // 所在链表：0..slots-1 为桶，slots 为正在触发的临时链表，NIL 表示未调度
+    };
+
+    void link(uint32_t id, uint32_t bucket);
+    void unlink(uint32_t id);
+    uint32_t bucketFor(int64_t deadline_ms) const;
+
+    Node* nodes_;
+    uint32_t* heads_;  // slots_ + 1 个链表头
+    uint32_t capacity_;
+    uint32_t slots_;
+    uint32_t tick_ms_;
+    int64_t cur_tick_;  // 已处理到的 tick（含）
+    size_t count_;
+};
+
+template <class F>
+size_t TimerWheel::advance(int64_t now_ms, F&& on_expire) {
+    if (!nodes_) return 0;
+    int64_t target = now_ms / tick_ms_;
+    size_t fired = 0;
+    // 时间跳过超过一圈时每个桶只需检查一次
+    int64_t steps = target - cur_tick_;
+    if (steps > (int64_t)slots_) cur_tick_ = target - slots_;
+    while (cur_tick_ < target) {
+        ++cur_tick_;
+        uint32_t b = (uint32_t)(cur_tick_ & (slots_ - 1));
+        // 整桶移到临时链表，回调中新调度到同一桶的 id 留到下一圈
+        uint32_t firing = slots_;
+        while (heads_[b] != NIL) {
+            uint32_t id = heads_[b];
+            unlink(id);
+            link(id, firing);
+        }
+        while (heads_[firing] != NIL) {
+            uint32_t id = heads_[firing];
+            unlink(id);
+            if (nodes_[id].deadline <= now_ms) {
+                ++fired;
+                on_expire(id);
+            } else {
+                link(id, bucketFor(nodes_[id].deadline));
+            }
+        }
+    }
+    return fired;
+}
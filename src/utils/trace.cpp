@@ -0,0 +1,138 @@
+#include "trace.h"
+#include "metrics.h"
+#include "request_id.h"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <cstdio>
+#include <cstring>
+
+namespace Trace {
+
+    // 采样阈值：每 10000 个请求中追踪的个数
+    static const uint32_t SAMPLE_SCALE = 10000;
+    static std::atomic<uint32_t> g_threshold(0);
+
+    static std::mutex g_mutex;
+    static std::unordered_map<uint64_t, Record> g_active;
+    static Record g_completed[TRACE_MAX_COMPLETED];
+    static size_t g_completed_next = 0;
+    static size_t g_completed_count = 0;
+
+    void setSampleRate(double rate) {
+        if (rate < 0) rate = 0;
+        if (rate > 1) rate = 1;
+        g_threshold.store((uint32_t)(rate * SAMPLE_SCALE + 0.5), std::memory_order_relaxed);
+    }
+
+    double getSampleRate() {
+        return (double)g_threshold.load(std::memory_order_relaxed) / SAMPLE_SCALE;
+    }
+
+    // 按 request_id 做整数混洗（splitmix64 末段），各模块对同一请求的采样结论一致，无需传递状态；
+    // id 的低位是线程内递增的计数，混洗后取模才均匀
+    bool isSampled(uint64_t request_id) {
+        uint32_t threshold = g_threshold.load(std::memory_order_relaxed);
+        if (threshold == 0 || request_id == 0) return false;
+        if (threshold >= SAMPLE_SCALE) return true;
+        uint64_t h = request_id;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return h % SAMPLE_SCALE < threshold;
+    }
+
+    void begin(uint64_t request_id, int64_t recv_ns) {
+        if (!isSampled(request_id)) return;
+        int64_t now = Metrics::nowNs();
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (g_active.size() >= TRACE_MAX_ACTIVE) return;
+        Record& rec = g_active[request_id];
+        memset(&rec, 0, sizeof(rec));
+        rec.request_id = request_id;
+        rec.ts_ns[static_cast<int>(Stage::RECV)] = recv_ns ? recv_ns : now;
+        rec.ts_ns[static_cast<int>(Stage::PARSE)] = now;
+    }
+
+    void mark(uint64_t request_id, Stage stage) {
+        if (!isSampled(request_id)) return;
+        int64_t now = Metrics::nowNs();
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_active.find(request_id);
+        if (it == g_active.end()) return;
+        int64_t& ts = it->second.ts_ns[static_cast<int>(stage)];
+        if (ts == 0) ts = now;  // 同一阶段只记第一次
+        if (stage != Stage::FLUSH) return;
+        g_completed[g_completed_next] = it->second;
+        g_completed_next = (g_completed_next + 1) % TRACE_MAX_COMPLETED;
+        if (g_completed_count < TRACE_MAX_COMPLETED) g_completed_count++;
+        g_active.erase(it);
+    }
+
+    void abort(uint64_t request_id) {
+        if (!isSampled(request_id)) return;
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_active.erase(request_id);
+    }
+
+    const char* stageName(Stage s) {
+        static const char* names[NUM_STAGES] = {
+            "recv", "parse", "enqueue", "dispatch", "first_token", "last_token", "flush"
+        };
+        return names[static_cast<int>(s)];
+    }
+
+    // 阶段之间的区间名，以区间结束的阶段为下标
+    static const char* spanName(int stage) {
+        static const char* names[NUM_STAGES] = {
+            "", "parse", "enqueue", "queue_wait", "first_token", "generate", "flush"
+        };
+        return names[stage];
+    }
+
+    static void appendEvent(std::string& out, bool& first, const char* name, size_t tid,
+                            int64_t start_ns, int64_t end_ns, uint64_t request_id) {
+        char id[RequestId::TEXT_SIZE];
+        RequestId::format(request_id, id);
+        char buf[192];
+        snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"id\":\"%s\"}}",
+                 first ? "" : ",\n", name, tid, start_ns / 1000.0, (end_ns - start_ns) / 1000.0, id);
+        out += buf;
+        first = false;
+    }
+
+    // 每个请求占一行（tid），整体区间 request 下嵌套各阶段区间
+    std::string renderChrome() {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        std::string out;
+        out.reserve(g_completed_count * 7 * 192 + 64);
+        out += "{\"traceEvents\":[\n";
+        bool first = true;
+        size_t start = (g_completed_next + TRACE_MAX_COMPLETED - g_completed_count) % TRACE_MAX_COMPLETED;
+        for (size_t k = 0; k < g_completed_count; ++k) {
+            const Record& rec = g_completed[(start + k) % TRACE_MAX_COMPLETED];
+            int64_t begin_ns = rec.ts_ns[static_cast<int>(Stage::RECV)];
+            int64_t end_ns = rec.ts_ns[static_cast<int>(Stage::FLUSH)];
+            size_t tid = k + 1;
+            appendEvent(out, first, "request", tid, begin_ns, end_ns, rec.request_id);
+            int64_t prev = begin_ns;
+            for (int s = 1; s < NUM_STAGES; ++s) {
+                int64_t ts = rec.ts_ns[s];
+                if (ts == 0) continue;  // 未经过的阶段（如合并请求没有 dispatch）并入下一个区间
+                appendEvent(out, first, spanName(s), tid, prev, ts, rec.request_id);
+                prev = ts;
+            }
+        }
+        out += "\n],\"displayTimeUnit\":\"ns\"}\n";
+        return out;
+    }
+
+    bool dumpChrome(const char* path) {
+        FILE* f = fopen(path, "w");
+        if (!f) return false;
+        std::string out = renderChrome();
+        bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+        fclose(f);
+        return ok;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#define TRACE_MAX_ACTIVE 1024     // 同时在途的采样请求上限，超出的不再追踪
+#define TRACE_MAX_COMPLETED 4096  // 保留最近完成的追踪记录数
+
+// 请求级追踪：按网关分配的 64 位 request_id 哈希确定性采样，各阶段用单调时钟（纳秒）打点，
+// 请求结束（FLUSH）后转入完成队列，可导出为 Chrome trace-event 格式（chrome://tracing、Perfetto）。
+// 未采样的请求只付出一次哈希的代价，不进入任何锁。
+namespace Trace {
+
+    enum class Stage {
+        RECV,         // 网关收到客户端数据
+        PARSE,        // 请求解析完成
+        ENQUEUE,      // 进入任务队列
+        DISPATCH,     // 下发到NPU节点
+        FIRST_TOKEN,  // 首个token到达网关
+        LAST_TOKEN,   // 结束消息到达网关
+        FLUSH,        // 最后一帧发回客户端
+        COUNT
+    };
+    static const int NUM_STAGES = static_cast<int>(Stage::COUNT);
+
+    struct Record {
+        uint64_t request_id;
+        int64_t ts_ns[NUM_STAGES];  // 0 表示该阶段未打点
+    };
+
+    // 采样率 0~1，0 关闭追踪
+    void setSampleRate(double rate);
+    double getSampleRate();
+    bool isSampled(uint64_t request_id);
+
+    // 开始追踪：recv_ns 为收到数据的时间，同时记录 PARSE 阶段
+    void begin(uint64_t request_id, int64_t recv_ns);
+    // 阶段打点；FLUSH 结束追踪
+    void mark(uint64_t request_id, Stage stage);
+    // 放弃追踪（如客户端断开）
+    void abort(uint64_t request_id);
+
+    // 导出已完成的追踪（Chrome trace-event JSON）
+    std::string renderChrome();
+    bool dumpChrome(const char* path);
+
+    const char* stageName(Stage s);
+}